@@ -0,0 +1,22 @@
+#pragma once
+
+/**@file
+ *
+ * @brief Host simulation overrides for the pca10056 sdk_config.h.
+ *
+ * @details Pulled in through USE_APP_CONFIG, by the simulation and the crypto benchmark. Only
+ *          settings that have no meaning on the host are changed here, so the simulated
+ *          firmware keeps the on-target configuration.
+ */
+
+// Logging goes through RTT/UART backends that do not exist on the host.
+#define NRF_LOG_ENABLED 0
+
+// The CC310 backend needs the nRF52840 hardware, the software backends are used instead.
+// Oberon is only shipped as Cortex-M libraries, which leaves ChaCha20-Poly1305 and Ed25519
+// without a host backend.
+#define NRF_CRYPTO_BACKEND_CC310_ENABLED    0
+#define NRF_CRYPTO_BACKEND_MBEDTLS_ENABLED  1
+
+// C dynamic memory
+#define NRF_CRYPTO_ALLOCATOR                3
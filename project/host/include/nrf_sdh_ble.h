@@ -0,0 +1,27 @@
+#ifndef SIM_NRF_SDH_BLE_H__
+#define SIM_NRF_SDH_BLE_H__
+
+/**@file
+ *
+ * @brief Host simulation wrapper for nrf_sdh_ble.h.
+ *
+ * @details The SDK registers BLE observers in linker sections that are laid out by
+ *          flash_placement.xml. Here observers are placed in a section with a C identifier
+ *          name instead, so the host linker provides the start/stop symbols and
+ *          sim_softdevice.c can dispatch events to them in priority order.
+ */
+
+#include_next "nrf_sdh_ble.h"
+#include "sim_softdevice.h"
+
+#undef NRF_SDH_BLE_OBSERVER
+#define NRF_SDH_BLE_OBSERVER(_name, _prio, _handler, _context)                   \
+static sim_ble_observer_t _name __attribute__((section("sim_ble_observers"), used)) = \
+{                                                                                \
+    .p_name    = #_name,                                                         \
+    .prio      = _prio,                                                          \
+    .handler   = _handler,                                                       \
+    .p_context = _context                                                        \
+}
+
+#endif // SIM_NRF_SDH_BLE_H__
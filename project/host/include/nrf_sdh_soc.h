@@ -0,0 +1,22 @@
+#ifndef SIM_NRF_SDH_SOC_H__
+#define SIM_NRF_SDH_SOC_H__
+
+/**@file
+ *
+ * @brief Host simulation wrapper for nrf_sdh_soc.h.
+ *
+ * @details The simulated SoftDevice raises no SoC events (flash, clock, power), so SoC
+ *          observers are compiled but never registered.
+ */
+
+#include_next "nrf_sdh_soc.h"
+
+#undef NRF_SDH_SOC_OBSERVER
+#define NRF_SDH_SOC_OBSERVER(_name, _prio, _handler, _context)                   \
+static nrf_sdh_soc_evt_observer_t const _name __attribute__((unused)) =          \
+{                                                                                \
+    .handler   = _handler,                                                       \
+    .p_context = _context                                                        \
+}
+
+#endif // SIM_NRF_SDH_SOC_H__
@@ -0,0 +1,72 @@
+/** @file
+ *
+ * @brief Unlock authentication crypto benchmark, host build.
+ *
+ * @details Runs the same benchmark as CRYPTO_BENCH_ENABLED does at boot on the target, with
+ *          nrf_crypto on the software backends selected in config/app_config.h, and
+ *          prints the latency of every candidate token verification primitive:
+ *
+ *          door_lock_crypto_bench -n 1000
+ *
+ *          Primitives without a host backend are reported as unsupported. Code size is
+ *          measured by the crypto-size make target, which links one binary per primitive.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "diag_service/crypto_bench.h"
+
+
+#define DEFAULT_ITERATIONS 1000
+
+
+int main(int argc, char* argv[]) {
+    uint32_t iterations = DEFAULT_ITERATIONS;
+    int      opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                iterations = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-n iterations]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    const ret_code_t err_code = crypto_bench_run(iterations);
+    if (err_code != NRF_SUCCESS) {
+        fprintf(stderr, "nrf_crypto_init failed: 0x%x\n", (unsigned int)err_code);
+        return EXIT_FAILURE;
+    }
+
+    int failures = 0;
+
+    printf("Token verification latency (%u iterations, " PROBE_UNIT ")\n", (unsigned int)iterations);
+    for (unsigned int id = 0; id < CRYPTO_BENCH_COUNT; ++id) {
+        const crypto_bench_result_t* p_result = crypto_bench_result_get((crypto_bench_id_t)id);
+        const char*                  p_name   = crypto_bench_name_get((crypto_bench_id_t)id);
+
+        if (p_result->status == NRF_ERROR_NOT_SUPPORTED) {
+            printf("%-20s not supported by the host backends\n", p_name);
+        }
+        else if (p_result->status != NRF_SUCCESS) {
+            printf("%-20s failed: 0x%x after %u runs\n", p_name, (unsigned int)p_result->status,
+                   (unsigned int)p_result->runs);
+            ++failures;
+        }
+        else if (p_result->runs > 0) {
+            printf("%-20s mean=%llu min=%u max=%u\n",
+                   p_name,
+                   (unsigned long long)(p_result->total / p_result->runs),
+                   (unsigned int)p_result->min,
+                   (unsigned int)p_result->max);
+        }
+    }
+
+    return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
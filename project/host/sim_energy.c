@@ -0,0 +1,166 @@
+#include "sim_energy.h"
+
+#include "config.h"
+#include "sdk_config.h"
+
+
+// nRF52840 at 3 V, 0 dBm. Radio event charges are for the DC/DC regulator.
+#define SYSTEM_ON_UA        3.0     /**< System ON idle, full RAM retention, RTC on the LFXO. */
+#define ADV_EVENT_UC        11.0    /**< Connectable advertising event on 3 channels, including scan request listening. */
+#define ADV_DELAY_MS        5.0     /**< Mean random advDelay added to every advertising interval. */
+#define DIRECT_EVENT_UC     4.0     /**< Directed advertising event on 3 channels, no scan requests. */
+#define DIRECT_HIGH_MS      3.75    /**< High duty directed advertising interval, at most 3.75 ms in the specification. */
+#define DIRECT_HIGH_S       1.28    /**< High duty directed advertising duration, fixed by the SoftDevice. */
+#define CONN_EVENT_UC       3.0     /**< Connection event with empty packets. */
+#define CONN_DATA_EVENT_UC  6.0     /**< Connection event with data in both directions. */
+#define CONN_ACTIVE_MS      1000.0  /**< Start of a transaction with data in every event: discovery, encryption, write. */
+#define LDO_FACTOR          1.9     /**< Radio event charge with the LDO regulator relative to DC/DC. */
+#define LOG_ACTIVE_UA       3300.0  /**< CPU and UARTE while a log line is sent, deferred or not. */
+#define LOG_LINE_CHARS      48.0    /**< Mean log line length, including the prefix. */
+#define SCAN_RX_UA          4700.0  /**< Radio receiving at 1M while the scan window is open. */
+
+#define SECONDS_PER_DAY     86400.0
+
+
+void sim_energy_config_default(sim_energy_config_t* p_config) {
+    p_config->adv_directed_interval_ms   = APP_ADV_DIRECTED_INTERVAL * 0.625;
+    p_config->adv_directed_duration_s    = DIRECT_HIGH_S + APP_ADV_DIRECTED_DURATION / 100.0;
+    p_config->adv_interval_ms            = APP_ADV_INTERVAL * 0.625;
+    p_config->adv_duration_s             = APP_ADV_DURATION / 100.0;
+    p_config->adv_slow_interval_ms       = APP_ADV_SLOW_INTERVAL * 0.625;
+    p_config->adv_slow_duration_s        = APP_ADV_SLOW_DURATION / 100.0;
+    p_config->adv_ultra_slow_interval_ms = APP_ADV_ULTRA_SLOW_INTERVAL * 0.625;
+    p_config->first_conn_interval_ms = CONN_POLICY_FAST_MAX_INTERVAL * 1.25;
+    p_config->conn_interval_ms       = MIN_CONN_INTERVAL * 1.25;
+    p_config->conn_update_delay_s    = (CONN_ACTIVE_MS + CONN_POLICY_IDLE_TIMEOUT_MS) / 1000.0;
+    p_config->slave_latency          = SLAVE_LATENCY;
+#if PROXIMITY_SCAN_ENABLED
+    const double active_share = (PROXIMITY_ACTIVE_TO_HOUR - PROXIMITY_ACTIVE_FROM_HOUR) / 24.0;
+    p_config->scan_duty       = active_share * PROXIMITY_SCAN_WINDOW_MS / PROXIMITY_ACTIVE_INTERVAL_MS +
+                                (1.0 - active_share) * PROXIMITY_SCAN_WINDOW_MS / PROXIMITY_QUIET_INTERVAL_MS;
+    p_config->scan_boost_duty = (double)PROXIMITY_SCAN_WINDOW_MS / PROXIMITY_BOOST_INTERVAL_MS;
+    p_config->scan_boost_s    = PROXIMITY_BOOST_S;
+#else
+    p_config->scan_duty       = 0.0;
+    p_config->scan_boost_duty = 0.0;
+    p_config->scan_boost_s    = 0.0;
+#endif
+    p_config->dcdc                   = POWER_CONFIG_DEFAULT_DCDCEN;
+    p_config->log_uart               = NRF_LOG_ENABLED && NRF_LOG_BACKEND_UART_ENABLED;
+
+    // The BAUDRATE register value is the baud rate in units of 16 MHz / 2^32
+    p_config->log_baudrate = (uint32_t)((NRF_LOG_BACKEND_UART_BAUDRATE * 16000000.0) / 4294967296.0);
+    p_config->budget_ua    = POWER_BUDGET_UA;
+}
+
+
+/**@brief Function for computing the connection event charge of one transaction.
+ *
+ * @return Charge in microcoulombs.
+ */
+static double connection_charge_uc(const sim_energy_config_t* p_config, double connection_ms) {
+    const double update_ms = p_config->conn_update_delay_s * 1000.0;
+    const double active_ms = (connection_ms < CONN_ACTIVE_MS) ? connection_ms : CONN_ACTIVE_MS;
+
+    // Data in every event at the fast interval
+    double charge = (active_ms / p_config->first_conn_interval_ms) * CONN_DATA_EVENT_UC;
+
+    // Then idle, without slave latency until the parameter update and with it after
+    const double idle_first_ms = ((connection_ms < update_ms) ? connection_ms : update_ms) - active_ms;
+    const double idle_next_ms  = (connection_ms > update_ms) ? connection_ms - update_ms : 0.0;
+    const double skip          = 1.0 + p_config->slave_latency;
+
+    if (idle_first_ms > 0) {
+        charge += (idle_first_ms / p_config->first_conn_interval_ms) * CONN_EVENT_UC;
+    }
+    charge += (idle_next_ms / (p_config->conn_interval_ms * skip)) * CONN_EVENT_UC;
+
+    return charge;
+}
+
+
+void sim_energy_estimate(const sim_energy_config_t* p_config,
+                         const sim_energy_usage_t* p_usage,
+                         sim_energy_result_t* p_result) {
+    const double radio_factor = p_config->dcdc ? 1.0 : LDO_FACTOR;
+    const double transactions = p_usage->unlocks_per_day;
+
+    // Time per day in each state, in seconds
+    const double connected_s = transactions * p_usage->connection_ms / 1000.0;
+    double       directed_s  = transactions * p_config->adv_directed_duration_s;
+    double       fast_s      = transactions * p_config->adv_duration_s;
+    double       slow_s      = transactions * p_config->adv_slow_duration_s;
+
+    if (directed_s > SECONDS_PER_DAY - connected_s) {
+        directed_s = SECONDS_PER_DAY - connected_s;
+    }
+    if (fast_s > SECONDS_PER_DAY - connected_s - directed_s) {
+        fast_s = SECONDS_PER_DAY - connected_s - directed_s;
+    }
+    if (slow_s > SECONDS_PER_DAY - connected_s - directed_s - fast_s) {
+        slow_s = SECONDS_PER_DAY - connected_s - directed_s - fast_s;
+    }
+    double       ultra_slow_s = SECONDS_PER_DAY - connected_s - directed_s - fast_s - slow_s;
+    double       habitual_s   = p_usage->habitual_hours * 3600.0;
+
+    if (habitual_s > ultra_slow_s) {
+        habitual_s = ultra_slow_s;
+    }
+    ultra_slow_s -= habitual_s;
+
+    // High duty first, then low duty for the rest of the directed phase
+    const double high_s       = (directed_s < transactions * DIRECT_HIGH_S) ? directed_s : transactions * DIRECT_HIGH_S;
+    const double low_s        = directed_s - high_s;
+
+    // Charge per day, in microcoulombs
+    const double event_uc   = ADV_EVENT_UC * radio_factor;
+    const double direct_uc  = DIRECT_EVENT_UC * radio_factor * (high_s * 1000.0 / DIRECT_HIGH_MS +
+                                                                low_s * 1000.0 / (p_config->adv_directed_interval_ms + ADV_DELAY_MS));
+    const double fast_uc    = event_uc * fast_s * 1000.0 / (p_config->adv_interval_ms + ADV_DELAY_MS);
+    const double slow_uc    = event_uc * slow_s * 1000.0 / (p_config->adv_slow_interval_ms + ADV_DELAY_MS);
+    const double habit_uc   = event_uc * habitual_s * 1000.0 / (p_config->adv_interval_ms + ADV_DELAY_MS);
+    const double ultra_uc   = event_uc * ultra_slow_s * 1000.0 / (p_config->adv_ultra_slow_interval_ms + ADV_DELAY_MS);
+    const double on_uc      = SECONDS_PER_DAY * SYSTEM_ON_UA;
+    const double conn_uc    = transactions * connection_charge_uc(p_config, p_usage->connection_ms) * radio_factor;
+    const double boost_s    = (transactions * p_config->scan_boost_s < SECONDS_PER_DAY) ? transactions * p_config->scan_boost_s
+                                                                                        : SECONDS_PER_DAY;
+    const double scan_uc    = ((SECONDS_PER_DAY - boost_s) * p_config->scan_duty + boost_s * p_config->scan_boost_duty) *
+                              SCAN_RX_UA * radio_factor;
+    double       log_uc     = 0;
+
+    if (p_config->log_uart && p_config->log_baudrate > 0) {
+        // 10 bits per character, the UART backend blocks until the line is out
+        const double line_s = (LOG_LINE_CHARS * 10.0) / p_config->log_baudrate;
+        log_uc = transactions * p_usage->log_lines_per_unlock * line_s * LOG_ACTIVE_UA;
+    }
+
+    p_result->system_on_ua      = on_uc / SECONDS_PER_DAY;
+    p_result->directed_ua       = direct_uc / SECONDS_PER_DAY;
+    p_result->fast_ua           = fast_uc / SECONDS_PER_DAY;
+    p_result->slow_ua           = slow_uc / SECONDS_PER_DAY;
+    p_result->habitual_ua       = habit_uc / SECONDS_PER_DAY;
+    p_result->ultra_slow_ua     = ultra_uc / SECONDS_PER_DAY;
+    p_result->connection_ua     = conn_uc / SECONDS_PER_DAY;
+    p_result->log_ua            = log_uc / SECONDS_PER_DAY;
+    p_result->scanning_ua       = scan_uc / SECONDS_PER_DAY;
+    p_result->total_ua          = p_result->system_on_ua + p_result->directed_ua + p_result->fast_ua + p_result->slow_ua +
+                                  p_result->habitual_ua + p_result->ultra_slow_ua + p_result->connection_ua + p_result->log_ua +
+                                  p_result->scanning_ua;
+    p_result->fast_share        = fast_s / SECONDS_PER_DAY;
+    p_result->slow_share        = slow_s / SECONDS_PER_DAY;
+    p_result->connected_share   = connected_s / SECONDS_PER_DAY;
+
+    // A phone scanning continuously sees the next advertisement half an interval away on average
+    const double share = (habitual_s > 0) ? p_usage->habitual_share : 0.0;
+    p_result->habitual_latency_ms = (p_config->adv_interval_ms + ADV_DELAY_MS) / 2.0;
+    p_result->idle_latency_ms     = (p_config->adv_ultra_slow_interval_ms + ADV_DELAY_MS) / 2.0;
+    p_result->arrival_latency_ms  = share * p_result->habitual_latency_ms + (1.0 - share) * p_result->idle_latency_ms;
+}
+
+
+double sim_energy_battery_days(double average_ua, double capacity_mah) {
+    if (average_ua <= 0) {
+        return 0;
+    }
+    return (capacity_mah * 1000.0 / average_ua) / 24.0;
+}
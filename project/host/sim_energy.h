@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Firmware configuration relevant to power consumption. */
+typedef struct {
+    double   adv_directed_interval_ms;  /**< Low duty directed advertising interval, APP_ADV_DIRECTED_INTERVAL. */
+    double   adv_directed_duration_s;   /**< Directed advertising duration after every transaction, high duty plus APP_ADV_DIRECTED_DURATION. */
+    double   adv_interval_ms;           /**< Fast advertising interval, APP_ADV_INTERVAL. */
+    double   adv_duration_s;            /**< Fast advertising duration, APP_ADV_DURATION. */
+    double   adv_slow_interval_ms;      /**< Slow advertising interval, APP_ADV_SLOW_INTERVAL. */
+    double   adv_slow_duration_s;       /**< Slow advertising duration, APP_ADV_SLOW_DURATION. */
+    double   adv_ultra_slow_interval_ms; /**< Advertising interval the rest of the time, APP_ADV_ULTRA_SLOW_INTERVAL. */
+    double   first_conn_interval_ms;    /**< Connection interval until the link goes idle, CONN_POLICY_FAST_MAX_INTERVAL. */
+    double   conn_interval_ms;          /**< Connection interval once idle, MIN_CONN_INTERVAL. */
+    double   conn_update_delay_s;       /**< Time until the idle parameter update, the transaction plus CONN_POLICY_IDLE_TIMEOUT_MS. */
+    uint16_t slave_latency;             /**< Slave latency, SLAVE_LATENCY. */
+    double   scan_duty;                 /**< Mean scan window over interval across the day, from the local time, 0 with PROXIMITY_SCAN_ENABLED off. */
+    double   scan_boost_duty;           /**< Scan window over interval while boosted for an approaching wearable. */
+    double   scan_boost_s;              /**< Boost length, PROXIMITY_BOOST_S. */
+    bool     dcdc;                      /**< DC/DC regulator enabled, POWER_CONFIG_DEFAULT_DCDCEN. */
+    bool     log_uart;                  /**< Logging through the UART backend, NRF_LOG_BACKEND_UART_ENABLED. */
+    uint32_t log_baudrate;              /**< UART baud rate, NRF_LOG_BACKEND_UART_BAUDRATE. */
+    double   budget_ua;                 /**< Average current not to exceed, POWER_BUDGET_UA. */
+} sim_energy_config_t;
+
+/**@brief Lock usage. */
+typedef struct {
+    double unlocks_per_day;         /**< Unlock transactions per day. */
+    double connection_ms;           /**< Mean connection length of a transaction. */
+    double log_lines_per_unlock;    /**< Log lines printed per transaction. */
+    double habitual_hours;          /**< Hours per day in the habitual arrival windows learned by the usage schedule. */
+    double habitual_share;          /**< Fraction of arrivals that fall in a habitual arrival window. */
+} sim_energy_usage_t;
+
+/**@brief Average current per activity, in microamperes. */
+typedef struct {
+    double system_on_ua;            /**< System-on sleep floor. */
+    double directed_ua;             /**< Directed advertising events. */
+    double fast_ua;                 /**< Fast advertising events. */
+    double slow_ua;                 /**< Slow advertising events. */
+    double habitual_ua;             /**< Advertising events in habitual arrival windows. */
+    double ultra_slow_ua;           /**< Ultra-slow advertising events. */
+    double connection_ua;           /**< Connection events. */
+    double log_ua;                  /**< UART logging. */
+    double scanning_ua;             /**< Proximity scanning. */
+    double total_ua;                /**< Sum of the above. */
+    double fast_share;              /**< Fraction of the day spent in fast advertising. */
+    double slow_share;              /**< Fraction of the day spent in slow advertising. */
+    double connected_share;         /**< Fraction of the day spent connected. */
+    double habitual_latency_ms;     /**< Mean time to the first advertisement for a phone arriving in a habitual arrival window. */
+    double idle_latency_ms;         /**< Mean time to the first advertisement for a phone arriving outside of one. */
+    double arrival_latency_ms;      /**< Mean time to the first advertisement over all arrivals after the slow phase. */
+} sim_energy_result_t;
+
+
+/**@brief Function for getting the configuration the firmware is built with.
+ *
+ * @details Taken from src/config.h and the target sdk_config.h.
+ *
+ * @param[out] p_config  Configuration.
+ */
+void sim_energy_config_default(sim_energy_config_t* p_config);
+
+
+/**@brief Function for estimating the average current of a configuration under a usage.
+ *
+ * @details The lock never sleeps. Each transaction is modelled as the connection, then the
+ *          full directed, fast and slow advertising phases, the phone being bonded. The lock
+ *          advertises at the fast interval for habitual_hours, and at the ultra-slow interval
+ *          the rest of the day. Transactions are assumed far enough apart not to share a phase,
+ *          which overestimates busy days; the phases are capped at the time left in the day.
+ *          The scanner listens at scan_duty whatever the phase, and at scan_boost_duty for
+ *          scan_boost_s per transaction, every arrival being taken as a wearable walking up to
+ *          the door. Charges per radio event are approximations of the nRF52840 Online Power
+ *          Profiler figures at 3 V and 0 dBm.
+ *
+ * @param[in]  p_config  Configuration.
+ * @param[in]  p_usage   Usage.
+ * @param[out] p_result  Average current per activity.
+ */
+void sim_energy_estimate(const sim_energy_config_t* p_config,
+                         const sim_energy_usage_t* p_usage,
+                         sim_energy_result_t* p_result);
+
+
+/**@brief Function for converting an average current to battery life.
+ *
+ * @param[in] average_ua    Average current.
+ * @param[in] capacity_mah  Usable battery capacity.
+ *
+ * @return Battery life in days.
+ */
+double sim_energy_battery_days(double average_ua, double capacity_mah);
+
+
+#ifdef __cplusplus
+}
+#endif
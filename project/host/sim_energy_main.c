@@ -0,0 +1,175 @@
+/** @file
+ *
+ * @brief Door lock energy estimator.
+ *
+ * @details Estimates the average current and battery life of the door lock from the timing
+ *          and logging configuration it is built with (src/config.h and the pca10056
+ *          sdk_config.h) and a usage profile. Every configuration value can be overridden on
+ *          the command line, so policies can be compared before building firmware:
+ *
+ *          door_lock_energy -u 40 -c 1500
+ *          door_lock_energy -u 40 -c 1500 -U 2000 -L 0
+ *          door_lock_energy -H 0
+ *
+ *          The usage is either given as unlocks per day and mean connection length, or read
+ *          from a file with the connection length in ms of every transaction of a day, one
+ *          per line. The exit status is a failure if the average current exceeds the budget.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_energy.h"
+
+
+#define DEFAULT_UNLOCKS_PER_DAY   20
+#define DEFAULT_CONNECTION_MS     2000
+#define DEFAULT_LOG_LINES         12
+#define DEFAULT_CAPACITY_MAH      2400    /**< Two AA alkaline cells. */
+#define DEFAULT_HABITUAL_HOURS    2       /**< Morning departure and evening arrival. */
+#define DEFAULT_HABITUAL_SHARE    0.8     /**< Most arrivals follow the habit. */
+
+
+/**@brief Function for reading a usage file.
+ */
+static int usage_load(const char* p_path, sim_energy_usage_t* p_usage) {
+    FILE* p_file = fopen(p_path, "r");
+    if (p_file == NULL) {
+        perror(p_path);
+        return -1;
+    }
+
+    char         line[64];
+    unsigned int count = 0;
+    double       total = 0;
+    while (fgets(line, sizeof(line), p_file) != NULL) {
+        char* p_line = line + strspn(line, " \t");
+        if (*p_line == '#' || *p_line == '\n' || *p_line == '\0') {
+            continue;
+        }
+        total += strtod(p_line, NULL);
+        ++count;
+    }
+    fclose(p_file);
+
+    p_usage->unlocks_per_day = count;
+    p_usage->connection_ms   = (count > 0) ? total / count : 0;
+    return 0;
+}
+
+
+static void report_print(const sim_energy_config_t* p_config,
+                         const sim_energy_usage_t* p_usage,
+                         const sim_energy_result_t* p_result,
+                         double capacity_mah) {
+    printf("Configuration\n");
+    printf("advertising directed for %.2f s, %.1f ms for %.0f s, %.1f ms for %.0f s, then %.1f ms\n",
+           p_config->adv_directed_duration_s, p_config->adv_interval_ms, p_config->adv_duration_s, p_config->adv_slow_interval_ms,
+           p_config->adv_slow_duration_s, p_config->adv_ultra_slow_interval_ms);
+    printf("connection %.1f ms then %.1f ms after %.0f s, slave latency %u\n",
+           p_config->first_conn_interval_ms, p_config->conn_interval_ms, p_config->conn_update_delay_s,
+           (unsigned int)p_config->slave_latency);
+    printf("proximity scan duty cycle %.2f %%, boosted to %.2f %% for %.0f s per unlock\n",
+           100.0 * p_config->scan_duty, 100.0 * p_config->scan_boost_duty, p_config->scan_boost_s);
+    printf("regulator %s, UART logging %s (%u baud)\n",
+           p_config->dcdc ? "DC/DC" : "LDO", p_config->log_uart ? "on" : "off", (unsigned int)p_config->log_baudrate);
+
+    printf("\nUsage\n");
+    printf("%.1f unlocks per day, %.0f ms connections, %.0f log lines per unlock\n",
+           p_usage->unlocks_per_day, p_usage->connection_ms, p_usage->log_lines_per_unlock);
+    printf("%.1f habitual hours per day, %.0f %% of arrivals in them\n",
+           p_usage->habitual_hours, 100.0 * p_usage->habitual_share);
+    printf("fast advertising %.2f %% of the day, slow %.2f %%, connected %.3f %%\n",
+           100.0 * p_result->fast_share, 100.0 * p_result->slow_share, 100.0 * p_result->connected_share);
+
+    printf("\nAverage current\n");
+    printf("%-14s %10.3f uA\n", "system-on", p_result->system_on_ua);
+    printf("%-14s %10.3f uA\n", "directed adv", p_result->directed_ua);
+    printf("%-14s %10.3f uA\n", "fast adv", p_result->fast_ua);
+    printf("%-14s %10.3f uA\n", "slow adv", p_result->slow_ua);
+    printf("%-14s %10.3f uA\n", "habitual adv", p_result->habitual_ua);
+    printf("%-14s %10.3f uA\n", "ultra-slow adv", p_result->ultra_slow_ua);
+    printf("%-14s %10.3f uA\n", "connections", p_result->connection_ua);
+    printf("%-14s %10.3f uA\n", "logging", p_result->log_ua);
+    printf("%-14s %10.3f uA\n", "scanning", p_result->scanning_ua);
+    printf("%-14s %10.3f uA, budget %.0f uA%s\n", "total", p_result->total_ua, p_config->budget_ua,
+           (p_result->total_ua > p_config->budget_ua) ? ", EXCEEDED" : "");
+
+    printf("\nTime to the first advertisement after the slow phase\n");
+    printf("%.0f ms in a habitual arrival window, %.0f ms outside, %.0f ms over all arrivals\n",
+           p_result->habitual_latency_ms, p_result->idle_latency_ms, p_result->arrival_latency_ms);
+
+    printf("\nBattery life %.0f days on %.0f mAh\n",
+           sim_energy_battery_days(p_result->total_ua, capacity_mah), capacity_mah);
+}
+
+
+int main(int argc, char* argv[]) {
+    sim_energy_config_t config;
+    sim_energy_usage_t  usage = {
+        .unlocks_per_day      = DEFAULT_UNLOCKS_PER_DAY,
+        .connection_ms        = DEFAULT_CONNECTION_MS,
+        .log_lines_per_unlock = DEFAULT_LOG_LINES,
+        .habitual_hours       = DEFAULT_HABITUAL_HOURS,
+        .habitual_share       = DEFAULT_HABITUAL_SHARE
+    };
+    double capacity_mah = DEFAULT_CAPACITY_MAH;
+    int    opt;
+
+    sim_energy_config_default(&config);
+
+    while ((opt = getopt(argc, argv, "u:c:n:H:R:f:b:a:t:A:T:U:i:l:r:L:s:S:p:")) != -1) {
+        switch (opt) {
+            // Usage
+            case 'u': usage.unlocks_per_day      = strtod(optarg, NULL); break;
+            case 'c': usage.connection_ms        = strtod(optarg, NULL); break;
+            case 'n': usage.log_lines_per_unlock = strtod(optarg, NULL); break;
+            case 'H': usage.habitual_hours       = strtod(optarg, NULL);         break;
+            case 'R': usage.habitual_share       = strtod(optarg, NULL) / 100.0; break;
+            case 'b': capacity_mah               = strtod(optarg, NULL); break;
+            case 'f':
+                if (usage_load(optarg, &usage) != 0) {
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            // Configuration overrides
+            case 'a': config.adv_interval_ms            = strtod(optarg, NULL);              break;
+            case 't': config.adv_duration_s             = strtod(optarg, NULL);              break;
+            case 'A': config.adv_slow_interval_ms       = strtod(optarg, NULL);              break;
+            case 'T': config.adv_slow_duration_s        = strtod(optarg, NULL);              break;
+            case 'U': config.adv_ultra_slow_interval_ms = strtod(optarg, NULL);              break;
+            case 'i': config.conn_interval_ms           = strtod(optarg, NULL);              break;
+            case 'l': config.slave_latency              = (uint16_t)strtoul(optarg, NULL, 0); break;
+            case 'r': config.dcdc                       = strtoul(optarg, NULL, 0) != 0;     break;
+            case 'L': config.log_uart                   = strtoul(optarg, NULL, 0) != 0;     break;
+            case 's': config.scan_duty                  = strtod(optarg, NULL) / 100.0;      break;
+            case 'S': config.scan_boost_duty            = strtod(optarg, NULL) / 100.0;      break;
+            case 'p': config.budget_ua                  = strtod(optarg, NULL);              break;
+
+            default:
+                fprintf(stderr,
+                        "usage: %s [-u unlocks_per_day] [-c connection_ms] [-f usage_file]\n"
+                        "       [-n log_lines_per_unlock] [-H habitual_hours] [-R habitual_arrival_percent]\n"
+                        "       [-b capacity_mah] [-a adv_interval_ms] [-t adv_duration_s]\n"
+                        "       [-A adv_slow_interval_ms] [-T adv_slow_duration_s] [-U adv_ultra_slow_interval_ms]\n"
+                        "       [-i conn_interval_ms] [-l slave_latency] [-r dcdc 0|1] [-L uart_log 0|1]\n"
+                        "       [-s scan_duty_percent] [-S scan_boost_duty_percent] [-p budget_ua]\n",
+                        argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (config.adv_directed_interval_ms <= 0 || config.adv_interval_ms <= 0 || config.adv_slow_interval_ms <= 0 ||
+        config.adv_ultra_slow_interval_ms <= 0 || config.conn_interval_ms <= 0 || config.first_conn_interval_ms <= 0) {
+        fprintf(stderr, "intervals must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    sim_energy_result_t result;
+    sim_energy_estimate(&config, &usage, &result);
+    report_print(&config, &usage, &result, capacity_mah);
+    return (result.total_ua > config.budget_ua) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
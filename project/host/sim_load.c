@@ -0,0 +1,233 @@
+#include "sim_load.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "sdk_config.h"
+#include "boards.h"
+#include "ble_srv_common.h"
+#include "auth_service/unlock_auth.h"
+
+#include "sim_softdevice.h"
+#include "sim_sdk.h"
+#include "sim_scheduler.h"
+#include "sim_phone.h"
+
+
+#define ADV_DELAY_MAX_MS 10     /**< Random advDelay added by the advertiser to every interval. */
+
+
+/**@brief Phone progress. */
+typedef enum {
+    PHONE_WAITING,      /**< Scanning for the lock. */
+    PHONE_CONNECTED,    /**< Link up, discovering. */
+    PHONE_UNLOCKED,     /**< Unlock written and actuated. */
+    PHONE_GAVE_UP       /**< Could not unlock in SIM_LOAD_GIVE_UP_MS. */
+} phone_state_t;
+
+/**@brief Simulated phone. */
+typedef struct {
+    phone_state_t state;
+    uint64_t      arrived_at;   /**< Virtual time the phone started scanning. */
+    uint64_t      connected_at; /**< Virtual time the link came up. */
+    uint64_t      unlocked_at;  /**< Virtual time the lock actuated. */
+    uint32_t      attempts;     /**< Connection attempts. */
+} phone_t;
+
+
+static phone_t* m_phones;
+static uint32_t m_rand_state;
+static uint16_t m_command_handle;
+static uint16_t m_cccd_handle;
+static uint16_t m_ack_cccd_handle;
+static uint32_t m_rejected;
+
+
+/**@brief Function for getting a pseudo random number, xorshift32.
+ */
+static uint32_t rand_next(void) {
+    m_rand_state ^= m_rand_state << 13;
+    m_rand_state ^= m_rand_state >> 17;
+    m_rand_state ^= m_rand_state << 5;
+    return m_rand_state;
+}
+
+
+static void phone_connect(void* p_context, uint32_t arg);
+
+
+/**@brief Function for finishing service discovery and unlocking.
+ *
+ * @param[in] p_context  Unused.
+ * @param[in] arg        Phone index.
+ */
+static void phone_unlock(void* p_context, uint32_t arg) {
+    static const uint8_t cccd_notify[BLE_CCCD_VALUE_LEN] = {BLE_GATT_HVX_NOTIFICATION, 0x00};
+    uint8_t  command[UNLOCK_AUTH_COMMAND_LEN];
+    phone_t* p_phone = &m_phones[arg];
+
+    if (!sim_gap_is_connected()) {
+        // Link lost during discovery, start over
+        p_phone->state = PHONE_WAITING;
+        phone_connect(NULL, arg);
+        return;
+    }
+
+    sim_gatts_write(m_cccd_handle, cccd_notify, sizeof(cccd_notify));
+    sim_gatts_write(m_ack_cccd_handle, cccd_notify, sizeof(cccd_notify));
+    sim_phone_command_build(command, UNLOCK_AUTH_OP_UNLOCK);
+    sim_gatts_write(m_command_handle, command, sizeof(command));
+
+    p_phone->state       = PHONE_UNLOCKED;
+    p_phone->unlocked_at = sim_rtc_ticks();
+    if (bsp_board_led_state_get(DOOR_LOCK_LED)) {
+        fprintf(stderr, "phone %u: unlock write did not actuate the lock\n", (unsigned int)arg);
+    }
+}
+
+
+/**@brief Function for attempting to connect, retrying on the next advertising interval.
+ *
+ * @param[in] p_context  Unused.
+ * @param[in] arg        Phone index.
+ */
+static void phone_connect(void* p_context, uint32_t arg) {
+    static const ble_gap_addr_t base_addr = {
+        .addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC,
+        .addr      = {0x00, 0x00, 0x03, 0x04, 0x05, 0xC6}
+    };
+    phone_t* p_phone = &m_phones[arg];
+    const uint64_t now = sim_rtc_ticks();
+
+    if (now - p_phone->arrived_at >= sim_rtc_ms_to_ticks(SIM_LOAD_GIVE_UP_MS)) {
+        p_phone->state = PHONE_GAVE_UP;
+        return;
+    }
+
+    ble_gap_addr_t addr = base_addr;
+    addr.addr[0] = (uint8_t)arg;
+    addr.addr[1] = (uint8_t)(arg >> 8);
+
+    p_phone->attempts += 1;
+    if (sim_gap_connect(&addr)) {
+        p_phone->state        = PHONE_CONNECTED;
+        p_phone->connected_at = now;
+        sim_sched_add(now + sim_rtc_ms_to_ticks(SIM_LOAD_DISCOVERY_EVENTS * SIM_LOAD_CONN_INTERVAL_MS),
+                      phone_unlock, NULL, arg);
+        return;
+    }
+
+    // Busy or not advertising, catch a later advertising packet
+    m_rejected += 1;
+    const uint64_t retry_ms = (uint64_t)sim_adv_interval_ms() + rand_next() % (ADV_DELAY_MAX_MS + 1);
+    sim_sched_add(now + sim_rtc_ms_to_ticks(retry_ms), phone_connect, NULL, arg);
+}
+
+
+static int u64_compare(const void* p_a, const void* p_b) {
+    const uint64_t a = *(const uint64_t*)p_a;
+    const uint64_t b = *(const uint64_t*)p_b;
+    return (a > b) - (a < b);
+}
+
+
+/**@brief Function for printing percentiles of a set of tick durations.
+ */
+static void percentiles_print(const char* p_name, uint64_t* p_ticks, uint32_t count) {
+    if (count == 0) {
+        printf("%-16s no samples\n", p_name);
+        return;
+    }
+
+    qsort(p_ticks, count, sizeof(p_ticks[0]), u64_compare);
+
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        total += p_ticks[i];
+    }
+
+    printf("%-16s mean %9.1f ms, p50 %9.1f ms, p99 %9.1f ms, max %9.1f ms\n",
+           p_name,
+           sim_rtc_ticks_to_ms((int64_t)(total / count)),
+           sim_rtc_ticks_to_ms((int64_t)p_ticks[count / 2]),
+           sim_rtc_ticks_to_ms((int64_t)p_ticks[(count * 99) / 100]),
+           sim_rtc_ticks_to_ms((int64_t)p_ticks[count - 1]));
+}
+
+
+int sim_load_run(uint32_t phones,
+                 uint32_t window_ms,
+                 uint32_t seed,
+                 uint16_t command_handle,
+                 uint16_t cccd_handle,
+                 uint16_t ack_cccd_handle) {
+    if (phones == 0 || phones > SIM_LOAD_MAX_PHONES) {
+        fprintf(stderr, "1 to %u phones supported\n", SIM_LOAD_MAX_PHONES);
+        return -1;
+    }
+
+    m_phones = calloc(phones, sizeof(m_phones[0]));
+    uint64_t* p_queueing = calloc(phones, sizeof(uint64_t));
+    uint64_t* p_unlock   = calloc(phones, sizeof(uint64_t));
+    if (m_phones == NULL || p_queueing == NULL || p_unlock == NULL) {
+        return -1;
+    }
+
+    m_rand_state      = (seed != 0) ? seed : 1;
+    m_command_handle  = command_handle;
+    m_cccd_handle     = cccd_handle;
+    m_ack_cccd_handle = ack_cccd_handle;
+
+    const uint64_t start = sim_rtc_ticks();
+    for (uint32_t i = 0; i < phones; ++i) {
+        const uint64_t offset_ms = (window_ms > 0) ? rand_next() % window_ms : 0;
+        m_phones[i].arrived_at = start + sim_rtc_ms_to_ticks(offset_ms);
+        sim_sched_add(m_phones[i].arrived_at, phone_connect, NULL, i);
+    }
+
+    // Run until every phone is done; the autolock and advertising timers keep running
+    uint32_t done = 0;
+    uint64_t last_done_at = start;
+    while (done < phones && sim_sched_run_next(UINT64_MAX)) {
+        done = 0;
+        for (uint32_t i = 0; i < phones; ++i) {
+            done += (m_phones[i].state == PHONE_UNLOCKED || m_phones[i].state == PHONE_GAVE_UP) ? 1 : 0;
+        }
+        last_done_at = sim_rtc_ticks();
+    }
+
+    uint32_t unlocked = 0;
+    uint32_t gave_up  = 0;
+    uint32_t connects = 0;
+    for (uint32_t i = 0; i < phones; ++i) {
+        const phone_t* p_phone = &m_phones[i];
+        if (p_phone->state == PHONE_UNLOCKED) {
+            p_queueing[unlocked] = p_phone->connected_at - p_phone->arrived_at;
+            p_unlock[unlocked]   = p_phone->unlocked_at - p_phone->arrived_at;
+            unlocked += 1;
+        }
+        else {
+            gave_up += 1;
+        }
+        connects += p_phone->attempts;
+    }
+
+    printf("Load: %u phones arriving over %u ms, link count %u, advertising interval %.1f ms\n",
+           (unsigned int)phones, (unsigned int)window_ms, (unsigned int)NRF_SDH_BLE_PERIPHERAL_LINK_COUNT,
+           APP_ADV_INTERVAL * 0.625);
+    printf("unlocked %u, gave up after %u ms %u, burst cleared in %.1f ms\n",
+           (unsigned int)unlocked, (unsigned int)SIM_LOAD_GIVE_UP_MS, (unsigned int)gave_up,
+           sim_rtc_ticks_to_ms((int64_t)(last_done_at - start)));
+    printf("connection attempts %u, rejected %u (%.1f %%)\n",
+           (unsigned int)connects, (unsigned int)m_rejected,
+           (connects > 0) ? (100.0 * m_rejected) / connects : 0.0);
+    percentiles_print("queueing delay", p_queueing, unlocked);
+    percentiles_print("time-to-unlock", p_unlock, unlocked);
+
+    free(p_unlock);
+    free(p_queueing);
+    free(m_phones);
+    return (gave_up == 0) ? 0 : 1;
+}
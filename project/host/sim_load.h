@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define SIM_LOAD_MAX_PHONES       200     /**< Each waiting phone holds one scheduler slot. */
+#define SIM_LOAD_CONN_INTERVAL_MS 30      /**< Connection interval phones pick before any parameter update. */
+#define SIM_LOAD_DISCOVERY_EVENTS 8       /**< Connection events spent on service discovery and CCCD setup. */
+#define SIM_LOAD_GIVE_UP_MS       60000   /**< Time after which a phone that could not unlock gives up. */
+
+
+/**@brief Function for running a burst of phones against the lock in virtual time.
+ *
+ * @details Phones arrive at random times, uniformly spread over the arrival window. Each one
+ *          connects as soon as it sees the lock advertising, discovers the Door Lock Service,
+ *          enables notifications and writes a signed unlock command. The firmware terminates
+ *          the link once the acknowledgement of the unlock is transmitted, and the next phone
+ *          can connect once advertising resumes. A phone that finds the lock busy scans again
+ *          and retries on the next advertising interval.
+ *
+ *          Reports the queueing delay (arrival to connection), time-to-unlock (arrival to
+ *          actuation) percentiles, rejected connection attempts and phones that gave up.
+ *
+ * @param[in] phones           Number of phones, at most SIM_LOAD_MAX_PHONES.
+ * @param[in] window_ms        Arrival window, 0 for all at once.
+ * @param[in] seed             Random seed for the arrival times.
+ * @param[in] command_handle   Value handle of the command characteristic.
+ * @param[in] cccd_handle      CCCD handle of the lock state characteristic.
+ * @param[in] ack_cccd_handle  CCCD handle of the acknowledgement characteristic.
+ *
+ * @return 0 if every phone unlocked, otherwise non-zero.
+ */
+int sim_load_run(uint32_t phones,
+                 uint32_t window_ms,
+                 uint32_t seed,
+                 uint16_t command_handle,
+                 uint16_t cccd_handle,
+                 uint16_t ack_cccd_handle);
+
+
+#ifdef __cplusplus
+}
+#endif
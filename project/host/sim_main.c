@@ -0,0 +1,549 @@
+/** @file
+ *
+ * @brief Door lock host simulation driver.
+ *
+ * @details Runs the door lock firmware on top of the simulated SoftDevice and drives unlock
+ *          transactions through it: connect, enable notifications, write a signed unlock command,
+ *          wait for the acknowledgement and the disconnection, and autolock. Reports the cost of
+ *          every BLE observer per event type and the write-to-actuation latency, i.e. the time
+ *          from BLE_GATTS_EVT_WRITE on the command characteristic until the door lock LED
+ *          changes. A replayed command is checked to be rejected at the end, followed by a
+ *          wearable walking up to the door, a batch of credentials enrolled in one long write
+ *          and an unlock by a phone that never subscribes.
+ *
+ *          Exits with a non-zero status if the firmware does not behave as expected, so it can
+ *          be used as a regression test as well as a benchmark.
+ *
+ *          With -s, a scripted scenario is replayed in virtual time instead, see sim_scenario.h.
+ *          With -r, a BLE event trace captured on the target is replayed, see sim_replay.h.
+ *          With -l, a burst of phones is run against the lock, see sim_load.h.
+ *          With -t, the BLE event trace the firmware writes is saved to a file, in the format
+ *          -r reads.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "boards.h"
+#include "ble_hci.h"
+#include "ble_service/ble_dls/ble_dls.h"
+#include "ble_service/adv_policy.h"
+#include "ble_service/conn_policy.h"
+#include "ble_service/gatt_cache.h"
+#include "ble_service/proximity_scan.h"
+#include "auth_service/unlock_auth.h"
+#include "auth_service/auth_prefetch.h"
+#include "diag_service/probe.h"
+#include "diag_service/evt_trace.h"
+#include "diag_service/unlock_retry.h"
+
+#include "sim_softdevice.h"
+#include "sim_sdk.h"
+#include "sim_phone.h"
+#include "sim_scenario.h"
+#include "sim_replay.h"
+#include "sim_load.h"
+#include "sim_scheduler.h"
+
+
+#define DEFAULT_ITERATIONS 10000        /**< Default number of unlock transactions. */
+#define DEFAULT_PERIOD_MS  86400000     /**< Default scenario period, one day. */
+
+
+int door_lock_main(void);
+
+
+static unsigned int m_iterations = DEFAULT_ITERATIONS;
+static uint16_t     m_command_handle;
+static uint16_t     m_ack_handle;
+static uint16_t     m_ack_cccd_handle;
+static uint16_t     m_long_command_handle;
+static uint16_t     m_response_handle;
+static const char*  m_scenario_path;
+static const char*  m_replay_path;
+static uint32_t     m_load_phones;
+static uint32_t     m_load_window_ms;
+static uint32_t     m_load_seed = 1;
+static uint64_t     m_scenario_period_ms = DEFAULT_PERIOD_MS;
+static uint32_t     m_scenario_periods   = 1;
+static uint64_t*    m_latencies;
+static unsigned int m_failures;
+
+
+/**@brief Function for recording a failed expectation.
+ */
+static void expect(bool condition, const char* p_what, unsigned int iteration) {
+    if (!condition) {
+        if (m_failures < 10) {
+            fprintf(stderr, "iteration %u: %s\n", iteration, p_what);
+        }
+        ++m_failures;
+    }
+}
+
+
+static int u64_compare(const void* p_a, const void* p_b) {
+    const uint64_t a = *(const uint64_t*)p_a;
+    const uint64_t b = *(const uint64_t*)p_b;
+    return (a > b) - (a < b);
+}
+
+
+static const ble_gap_addr_t m_peer_addr = {
+    .addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC,
+    .addr      = {0x01, 0x02, 0x03, 0x04, 0x05, 0xC6}
+};
+
+
+static const ble_gap_addr_t m_wearable_addr = {
+    .addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC,
+    .addr      = {0x11, 0x12, 0x13, 0x14, 0x15, 0xC7}
+};
+
+
+/**@brief Function for getting the result of the last acknowledgement.
+ */
+static uint8_t ack_result_get(void) {
+    uint8_t           ack[BLE_DLS_ACK_LEN];
+    ble_gatts_value_t value = {
+        .len     = sizeof(ack),
+        .offset  = 0,
+        .p_value = ack
+    };
+
+    if (sd_ble_gatts_value_get(BLE_CONN_HANDLE_INVALID, m_ack_handle, &value) != NRF_SUCCESS ||
+        value.len != BLE_DLS_ACK_LEN) {
+        return 0xFF;
+    }
+    return ack[2];
+}
+
+
+/**@brief Function for running one unlock transaction.
+ *
+ * @return Write-to-actuation latency in nanoseconds.
+ */
+static uint64_t unlock_transaction(unsigned int iteration, uint16_t cccd_handle) {
+    static const uint8_t cccd_notify[BLE_CCCD_VALUE_LEN] = {BLE_GATT_HVX_NOTIFICATION, 0x00};
+    uint8_t              command[UNLOCK_AUTH_COMMAND_LEN];
+
+    // Signed before the clock starts, the phone does that before connecting
+    sim_phone_command_build(command, UNLOCK_AUTH_OP_UNLOCK);
+
+    expect(sim_gap_connect(&m_peer_addr), "connection rejected", iteration);
+    sim_gatts_write(cccd_handle, cccd_notify, sizeof(cccd_notify));
+    sim_gatts_write(m_ack_cccd_handle, cccd_notify, sizeof(cccd_notify));
+
+    const uint64_t write_ns = sim_now_ns();
+    sim_gatts_write(m_command_handle, command, sizeof(command));
+    const uint64_t actuation_ns = sim_board_led_changed_ns(DOOR_LOCK_LED);
+
+    expect(actuation_ns >= write_ns, "unlock write did not actuate the lock", iteration);
+    expect(!bsp_board_led_state_get(DOOR_LOCK_LED), "door lock LED still on after unlock", iteration);
+    expect(ack_result_get() == BLE_DLS_ACK_OK, "unlock not acknowledged", iteration);
+
+    // The firmware terminates the link once the acknowledgement is out
+    sim_ble_evt_pump();
+    expect(!sim_gap_is_connected(), "link not terminated after the acknowledgement", iteration);
+
+    sim_app_timers_fire();
+    expect(bsp_board_led_state_get(DOOR_LOCK_LED), "autolock did not engage", iteration);
+
+    return (actuation_ns >= write_ns) ? (actuation_ns - write_ns) : 0;
+}
+
+
+/**@brief Function for checking that a command is not accepted twice.
+ */
+static void replay_check(void) {
+    static const uint8_t cccd_notify[BLE_CCCD_VALUE_LEN] = {BLE_GATT_HVX_NOTIFICATION, 0x00};
+    uint8_t              command[UNLOCK_AUTH_COMMAND_LEN];
+
+    // The counter of the last transaction
+    sim_phone_command_sign(command, UNLOCK_AUTH_OP_UNLOCK, m_iterations);
+
+    expect(sim_gap_connect(&m_peer_addr), "connection rejected", m_iterations);
+    sim_gatts_write(m_ack_cccd_handle, cccd_notify, sizeof(cccd_notify));
+    sim_gatts_write(m_command_handle, command, sizeof(command));
+    expect(bsp_board_led_state_get(DOOR_LOCK_LED), "replayed command unlocked the door", m_iterations);
+
+    // Rejected with a reason, and the link is left up for another try
+    sim_ble_evt_pump();
+    expect(ack_result_get() == BLE_DLS_ACK_REPLAYED, "replayed command not acknowledged as such", m_iterations);
+    expect(sim_gap_is_connected(), "link terminated after a rejected command", m_iterations);
+
+    sim_gap_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    sim_ble_evt_pump();
+}
+
+
+/**@brief Function for checking that a wearable walking up to the door unlocks it once.
+ */
+static void proximity_check(void) {
+    uint8_t adv_data[3 + 4 + UNLOCK_AUTH_COMMAND_LEN];
+    uint8_t len = 0;
+
+    // Flags, then the signed command as manufacturer specific data
+    adv_data[len++] = 2;
+    adv_data[len++] = BLE_GAP_AD_TYPE_FLAGS;
+    adv_data[len++] = BLE_GAP_ADV_FLAG_BR_EDR_NOT_SUPPORTED;
+    adv_data[len++] = 3 + UNLOCK_AUTH_COMMAND_LEN;
+    adv_data[len++] = BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA;
+    len += uint16_encode(ADV_COMPANY_IDENTIFIER, &adv_data[len]);
+    sim_phone_command_build(&adv_data[len], UNLOCK_AUTH_OP_UNLOCK);
+    len += UNLOCK_AUTH_COMMAND_LEN;
+
+    expect(bsp_board_led_state_get(DOOR_LOCK_LED), "door unlocked before the wearable came", m_iterations);
+
+    // Every advertisement a little closer, the average crosses the threshold a few steps late
+    for (int rssi = -90; rssi <= -45; rssi += 5) {
+        expect(sim_gap_adv_report(&m_wearable_addr, (int8_t)rssi, adv_data, len), "not scanning", m_iterations);
+        if (rssi < PROXIMITY_UNLOCK_RSSI_DBM) {
+            expect(bsp_board_led_state_get(DOOR_LOCK_LED), "wearable unlocked before it came close", m_iterations);
+        }
+    }
+
+    // The first advertisement boosted the scanner, once
+    double scan_interval_ms;
+    double scan_window_ms;
+    expect(sim_gap_scan_get(&scan_interval_ms, &scan_window_ms) && scan_interval_ms == PROXIMITY_BOOST_INTERVAL_MS,
+           "scanner not boosted for the wearable", m_iterations);
+    expect(proximity_scan_stats_get()->boost_periods == 1, "wearable boost not counted once", m_iterations);
+    expect(!bsp_board_led_state_get(DOOR_LOCK_LED), "wearable did not unlock", m_iterations);
+
+    // Standing at the door after the autolock does not unlock again
+    sim_app_timers_fire();
+    for (unsigned int i = 0; i < 2 * PROXIMITY_RSSI_WINDOW; ++i) {
+        sim_gap_adv_report(&m_wearable_addr, -45, adv_data, len);
+    }
+    expect(bsp_board_led_state_get(DOOR_LOCK_LED), "wearable unlocked twice without walking away", m_iterations);
+    expect(proximity_scan_stats_get()->unlocks == 1, "wearable unlock not counted once", m_iterations);
+}
+
+
+/**@brief Function for checking that a batch of credentials is enrolled in one long write.
+ */
+static void enrollment_check(void) {
+    static const uint8_t cccd_notify[BLE_CCCD_VALUE_LEN] = {BLE_GATT_HVX_NOTIFICATION, 0x00};
+    static const uint16_t cred_ids[] = {0x0002, 0x0003, 0x0004};
+    uint8_t               batch[1 + UNLOCK_AUTH_COMMAND_LEN + ARRAY_SIZE(cred_ids) * (2 + UNLOCK_AUTH_KEY_LEN)];
+    uint8_t               response[3];
+    uint16_t              len = 0;
+
+    // Opcode, enroll command, then every credential ID and key
+    batch[len++] = BLE_DLS_LONG_OP_CREDENTIALS_ADD;
+    sim_phone_command_build(&batch[len], UNLOCK_AUTH_OP_ENROLL);
+    len += UNLOCK_AUTH_COMMAND_LEN;
+    for (unsigned int i = 0; i < ARRAY_SIZE(cred_ids); ++i) {
+        len += uint16_encode(cred_ids[i], &batch[len]);
+        memset(&batch[len], (int)cred_ids[i], UNLOCK_AUTH_KEY_LEN);
+        len += UNLOCK_AUTH_KEY_LEN;
+    }
+
+    expect(sim_gap_connect(&m_peer_addr), "connection rejected", m_iterations);
+    sim_gatts_write(sim_gatts_cccd_handle_find(m_response_handle), cccd_notify, sizeof(cccd_notify));
+    expect(sim_gatts_long_write(m_long_command_handle, batch, len), "credential batch not accepted", m_iterations);
+
+    ble_gatts_value_t value = {
+        .len     = sizeof(response),
+        .offset  = 0,
+        .p_value = response
+    };
+    expect(sd_ble_gatts_value_get(BLE_CONN_HANDLE_INVALID, m_response_handle, &value) == NRF_SUCCESS &&
+           value.len == sizeof(response) && response[0] == BLE_DLS_LONG_OP_CREDENTIALS_ADD &&
+           response[1] == BLE_DLS_ACK_OK && response[2] == ARRAY_SIZE(cred_ids),
+           "credential batch not answered", m_iterations);
+    for (unsigned int i = 0; i < ARRAY_SIZE(cred_ids); ++i) {
+        expect(unlock_auth_credential_exists(cred_ids[i]), "credential not enrolled", m_iterations);
+    }
+
+    sim_gap_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    sim_ble_evt_pump();
+}
+
+
+/**@brief Function for checking that a phone that never subscribes can still unlock.
+ *
+ * @details The phone is not bonded and writes no CCCD, so every notification fails with
+ *          BLE_ERROR_GATTS_SYS_ATTR_MISSING. It reads the acknowledgement instead.
+ */
+static void unsubscribed_check(void) {
+    uint8_t command[UNLOCK_AUTH_COMMAND_LEN];
+
+    sim_phone_command_build(command, UNLOCK_AUTH_OP_UNLOCK);
+
+    expect(sim_gap_connect(&m_peer_addr), "connection rejected", m_iterations);
+    sim_gatts_write(m_command_handle, command, sizeof(command));
+    expect(ack_result_get() == BLE_DLS_ACK_OK, "unsubscribed unlock not acknowledged", m_iterations);
+
+    sim_gap_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    sim_ble_evt_pump();
+}
+
+
+/**@brief Function for unlocking from the benchmark peer without waiting for the autolock.
+ */
+static void unlock_once(void) {
+    uint8_t command[UNLOCK_AUTH_COMMAND_LEN];
+
+    sim_phone_command_build(command, UNLOCK_AUTH_OP_UNLOCK);
+
+    expect(sim_gap_connect(&m_peer_addr), "connection rejected", m_iterations);
+    sim_gatts_write(m_command_handle, command, sizeof(command));
+    expect(ack_result_get() == BLE_DLS_ACK_OK, "unlock not acknowledged", m_iterations);
+
+    sim_gap_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    sim_ble_evt_pump();
+}
+
+
+/**@brief Function for checking that only an unlock soon after the previous one is a retry.
+ *
+ * @details The last unlock comes one period of the 24-bit RTC counter after the previous one,
+ *          when the counter reads the same again.
+ */
+static void retry_check(void) {
+    sim_app_timers_fire();
+    const uint32_t retries = unlock_retry_stats_get()->retries;
+
+    unlock_once();
+    unlock_once();
+    expect(unlock_retry_stats_get()->retries == retries + 1, "unlock within the window not counted as a retry", m_iterations);
+
+    sim_sched_run_until(sim_rtc_ticks() + (1ull << 24));
+    unlock_once();
+    expect(unlock_retry_stats_get()->retries == retries + 1, "unlock a counter period later counted as a retry", m_iterations);
+}
+
+
+/**@brief Function for checking that opening the idle phase to everybody runs the slow phase,
+ *        and that it times out into the idle phase again.
+ */
+static void whitelist_off_check(void) {
+    sim_sched_run_until(sim_rtc_ticks() + sim_rtc_ms_to_ticks((APP_ADV_DURATION + APP_ADV_SLOW_DURATION) * 10 + 1000));
+    expect(adv_policy_phase_get() == ADV_POLICY_PHASE_ULTRA_SLOW, "advertising not ultra-slow once idle", m_iterations);
+
+    sim_bsp_evt_send(BSP_EVENT_WHITELIST_OFF);
+    expect(adv_policy_phase_get() == ADV_POLICY_PHASE_SLOW && sim_adv_interval_ms() == APP_ADV_SLOW_INTERVAL * 0.625,
+           "whitelist off from ultra-slow not in the slow phase", m_iterations);
+
+    sim_sched_run_until(sim_rtc_ticks() + sim_rtc_ms_to_ticks(APP_ADV_SLOW_DURATION * 10 + 1000));
+    expect(adv_policy_phase_get() == ADV_POLICY_PHASE_ULTRA_SLOW, "slow phase did not time out into ultra-slow", m_iterations);
+}
+
+
+/**@brief Function for printing the benchmark report.
+ */
+static void report_print(void) {
+    printf("BLE observer cost per event (%u unlock transactions)\n", m_iterations);
+    sim_handler_stats_print();
+
+    qsort(m_latencies, m_iterations, sizeof(m_latencies[0]), u64_compare);
+
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < m_iterations; ++i) {
+        total += m_latencies[i];
+    }
+
+    printf("\nWrite-to-actuation latency\n");
+    printf("mean %llu ns, p50 %llu ns, p99 %llu ns, max %llu ns\n",
+           (unsigned long long)(total / m_iterations),
+           (unsigned long long)m_latencies[m_iterations / 2],
+           (unsigned long long)m_latencies[(m_iterations * 99) / 100],
+           (unsigned long long)m_latencies[m_iterations - 1]);
+    printf("notifications sent: %u, failures: %u\n", (unsigned int)sim_gatts_hvx_count(), m_failures);
+
+    const conn_policy_stats_t* p_policy = conn_policy_stats_get();
+    printf("\nConnection parameter policy\n");
+    printf("requests: %u fast, %u idle, %u errors; updates: %u, %u fast, %u rejected\n",
+           (unsigned int)p_policy->fast_requests, (unsigned int)p_policy->idle_requests,
+           (unsigned int)p_policy->request_errors, (unsigned int)p_policy->updates,
+           (unsigned int)p_policy->fast_updates, (unsigned int)p_policy->rejected);
+
+    const unlock_retry_stats_t* p_retry = unlock_retry_stats_get();
+    printf("\nUnlock acknowledgements\n");
+    printf("unlocks %u, retries %u; acks %u sent, %u delivered, %u linger timeouts\n",
+           (unsigned int)p_retry->unlocks, (unsigned int)p_retry->retries,
+           (unsigned int)p_retry->acks_sent, (unsigned int)p_retry->acks_delivered,
+           (unsigned int)p_retry->linger_timeouts);
+
+    const proximity_scan_stats_t* p_proximity = proximity_scan_stats_get();
+    double                        scan_interval_ms = 0.0;
+    double                        scan_window_ms   = 0.0;
+    sim_gap_scan_get(&scan_interval_ms, &scan_window_ms);
+    printf("\nProximity unlock\n");
+    printf("wearable reports %u, unlocks %u, rejected %u, boosts %u; scanning %.0f ms every %.0f ms\n",
+           (unsigned int)p_proximity->reports, (unsigned int)p_proximity->unlocks,
+           (unsigned int)p_proximity->rejected, (unsigned int)p_proximity->boost_periods,
+           scan_window_ms, scan_interval_ms);
+
+    const gatt_cache_stats_t* p_cache = gatt_cache_stats_get();
+    printf("\nGATT caching\n");
+    printf("connections %u, discovery skipped %u\n",
+           (unsigned int)p_cache->connections, (unsigned int)p_cache->discovery_skipped);
+
+    const auth_prefetch_stats_t* p_prefetch = auth_prefetch_stats_get();
+    printf("\nAuthentication prefetch\n");
+    printf("connections %u, prefetches %u, errors %u; commands %u on the prepared credential, %u not\n",
+           (unsigned int)p_prefetch->connections, (unsigned int)p_prefetch->prefetches,
+           (unsigned int)p_prefetch->errors, (unsigned int)p_prefetch->hits, (unsigned int)p_prefetch->misses);
+
+    printf("\nFirmware probes (" PROBE_UNIT ", log2 buckets)\n");
+    for (unsigned int id = 0; id < PROBE_COUNT; ++id) {
+        const probe_histogram_t* p_hist = probe_histogram_get((probe_id_t)id);
+        if (p_hist->count == 0) {
+            continue;
+        }
+
+        printf("%-20s n=%u min=%u mean=%llu max=%u\n",
+               probe_name_get((probe_id_t)id),
+               (unsigned int)p_hist->count,
+               (unsigned int)p_hist->min,
+               (unsigned long long)(p_hist->total / p_hist->count),
+               (unsigned int)p_hist->max);
+        for (unsigned int b = 0; b < PROBE_HISTOGRAM_BUCKETS; ++b) {
+            if (p_hist->buckets[b] != 0) {
+                printf("%20s < 2^%-2u %u\n", "", b, (unsigned int)p_hist->buckets[b]);
+            }
+        }
+    }
+}
+
+
+void sim_idle(void) {
+    const ble_uuid_t lock_state_uuid = {
+        .uuid = DLS_UUID_LOCK_STATE_CHAR,
+        .type = BLE_UUID_TYPE_VENDOR_BEGIN
+    };
+
+    const ble_uuid_t command_uuid = {
+        .uuid = DLS_UUID_COMMAND_CHAR,
+        .type = BLE_UUID_TYPE_VENDOR_BEGIN
+    };
+
+    const ble_uuid_t ack_uuid = {
+        .uuid = DLS_UUID_ACK_CHAR,
+        .type = BLE_UUID_TYPE_VENDOR_BEGIN
+    };
+
+    const ble_uuid_t long_command_uuid = {
+        .uuid = DLS_UUID_LONG_COMMAND_CHAR,
+        .type = BLE_UUID_TYPE_VENDOR_BEGIN
+    };
+
+    const ble_uuid_t response_uuid = {
+        .uuid = DLS_UUID_RESPONSE_CHAR,
+        .type = BLE_UUID_TYPE_VENDOR_BEGIN
+    };
+
+    const uint16_t lock_state_handle = sim_gatts_value_handle_find(&lock_state_uuid);
+    const uint16_t cccd_handle       = sim_gatts_cccd_handle_find(lock_state_handle);
+    m_command_handle                 = sim_gatts_value_handle_find(&command_uuid);
+    m_ack_handle                     = sim_gatts_value_handle_find(&ack_uuid);
+    m_ack_cccd_handle                = sim_gatts_cccd_handle_find(m_ack_handle);
+    m_long_command_handle            = sim_gatts_value_handle_find(&long_command_uuid);
+    m_response_handle                = sim_gatts_value_handle_find(&response_uuid);
+    if (lock_state_handle == BLE_GATT_HANDLE_INVALID || cccd_handle == BLE_GATT_HANDLE_INVALID ||
+        m_command_handle == BLE_GATT_HANDLE_INVALID || m_ack_cccd_handle == BLE_GATT_HANDLE_INVALID ||
+        m_long_command_handle == BLE_GATT_HANDLE_INVALID || m_response_handle == BLE_GATT_HANDLE_INVALID) {
+        fprintf(stderr, "Door Lock Service not found in the attribute table\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (m_load_phones > 0) {
+        exit((sim_load_run(m_load_phones, m_load_window_ms, m_load_seed,
+                           m_command_handle, cccd_handle, m_ack_cccd_handle) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (m_replay_path != NULL) {
+        exit((sim_replay_run(m_replay_path, m_scenario_periods) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (m_scenario_path != NULL) {
+        exit((sim_scenario_run(m_scenario_path, m_scenario_period_ms, m_scenario_periods,
+                               m_command_handle, cccd_handle, m_ack_cccd_handle) == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    // Only measure the transactions, not initialization
+    sim_handler_stats_reset();
+    probe_init();
+
+    for (unsigned int i = 0; i < m_iterations; ++i) {
+        m_latencies[i] = unlock_transaction(i, cccd_handle);
+    }
+    replay_check();
+    proximity_check();
+    enrollment_check();
+    unsubscribed_check();
+    retry_check();
+    whitelist_off_check();
+
+    report_print();
+    exit((m_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+
+int main(int argc, char* argv[]) {
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:p:d:r:t:l:w:S:")) != -1) {
+        switch (opt) {
+            case 'n':
+                m_iterations = (unsigned int)strtoul(optarg, NULL, 0);
+                break;
+
+            case 's':
+                m_scenario_path = optarg;
+                break;
+
+            case 'p':
+                m_scenario_period_ms = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'd':
+                m_scenario_periods = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 'r':
+                m_replay_path = optarg;
+                break;
+
+            case 'l':
+                m_load_phones = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 'w':
+                m_load_window_ms = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 'S':
+                m_load_seed = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+
+            case 't':
+                if (!sim_rtt_capture_open(EVT_TRACE_RTT_CHANNEL, optarg)) {
+                    return EXIT_FAILURE;
+                }
+                break;
+
+            default:
+                fprintf(stderr, "usage: %s [-t trace_out] [-n iterations | -s scenario [-p period_ms] [-d periods] | -r trace [-d passes] |\n"
+                                "          -l phones [-w window_ms] [-S seed]]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (m_iterations == 0) {
+        m_iterations = 1;
+    }
+    m_latencies = calloc(m_iterations, sizeof(m_latencies[0]));
+    if (m_latencies == NULL) {
+        return EXIT_FAILURE;
+    }
+
+    // Boots the firmware, which calls sim_idle() once it reaches its main loop
+    return door_lock_main();
+}
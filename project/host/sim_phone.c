@@ -0,0 +1,45 @@
+#include "sim_phone.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "config.h"
+#include "app_util.h"
+#include "auth_service/unlock_auth.h"
+
+#include "sim_sdk.h"
+
+
+static uint32_t m_counter;  /**< Counter of the last command built. */
+
+
+void sim_phone_command_sign(uint8_t* p_command, uint8_t opcode, uint32_t counter) {
+    static uint8_t key[UNLOCK_AUTH_KEY_LEN] = UNLOCK_AUTH_DEV_KEY;
+    const uint8_t* p_challenge;
+
+    // The challenge leads the record, the status follows it with extended advertising
+    if (sim_adv_manuf_data_get(&p_challenge) < UNLOCK_AUTH_CHALLENGE_LEN) {
+        fprintf(stderr, "no unlock challenge in the scan response\n");
+        exit(EXIT_FAILURE);
+    }
+
+    p_command[0] = opcode;
+    uint16_encode(UNLOCK_AUTH_DEV_CRED_ID, &p_command[1]);
+    uint32_encode(counter, &p_command[3]);
+    if (unlock_auth_mac_compute(key, p_command, p_challenge, &p_command[UNLOCK_AUTH_SIGNED_LEN]) != NRF_SUCCESS) {
+        fprintf(stderr, "command MAC failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (counter > m_counter) {
+        m_counter = counter;
+    }
+}
+
+
+uint32_t sim_phone_command_build(uint8_t* p_command, uint8_t opcode) {
+    const uint32_t counter = m_counter + 1;
+
+    sim_phone_command_sign(p_command, opcode, counter);
+    return counter;
+}
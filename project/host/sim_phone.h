@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Function for building a command signed with the development credential, as a phone
+ *        would, over the challenge the lock advertises.
+ *
+ * @details Every phone of the simulation shares the development credential, so the commands take
+ *          the next counter in the order they are built and the lock accepts them in that order.
+ *          Exits the simulation if the lock advertises no challenge.
+ *
+ * @param[out] p_command  Command, UNLOCK_AUTH_COMMAND_LEN bytes.
+ * @param[in]  opcode     Command opcode, see unlock_auth_opcode_t.
+ *
+ * @return Counter of the command.
+ */
+uint32_t sim_phone_command_build(uint8_t* p_command, uint8_t opcode);
+
+
+/**@brief Function for building a command with a given counter, such as a replayed one.
+ *
+ * @param[out] p_command  Command, UNLOCK_AUTH_COMMAND_LEN bytes.
+ * @param[in]  opcode     Command opcode, see unlock_auth_opcode_t.
+ * @param[in]  counter    Counter of the command.
+ */
+void sim_phone_command_sign(uint8_t* p_command, uint8_t opcode, uint32_t counter);
+
+
+#ifdef __cplusplus
+}
+#endif
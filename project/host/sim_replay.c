@@ -0,0 +1,195 @@
+#include "sim_replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_util.h"
+#include "app_timer.h"
+#include "diag_service/evt_trace.h"
+
+#include "sim_softdevice.h"
+#include "sim_scheduler.h"
+
+
+#define TRACE_TICKS_MASK 0x00FFFFFF     /**< The target timestamps come from a 24-bit RTC counter. */
+
+
+/**@brief Replay statistics. */
+typedef struct {
+    uint32_t events;        /**< Events dispatched. */
+    uint32_t unknown;       /**< Records with an event ID of no known BLE module. */
+    uint32_t boots;         /**< Boot records. */
+    uint32_t dropped;       /**< Records lost on the target, as reported by the trace. */
+    uint64_t dispatch_ns;   /**< Time spent dispatching events. */
+    uint64_t traced_ticks;  /**< Target time covered by one pass of the trace. */
+} replay_stats_t;
+
+
+static uint8_t*       m_trace;
+static size_t         m_trace_len;
+static uint16_t       m_trace_tick_hz;
+static replay_stats_t m_stats;
+
+
+/**@brief Function for loading a trace file and checking its boot record.
+ */
+static int trace_load(const char* p_path) {
+    FILE* p_file = fopen(p_path, "rb");
+    if (p_file == NULL) {
+        perror(p_path);
+        return -1;
+    }
+
+    fseek(p_file, 0, SEEK_END);
+    const long len = ftell(p_file);
+    fseek(p_file, 0, SEEK_SET);
+
+    m_trace = malloc((len > 0) ? (size_t)len : 1);
+    if (m_trace == NULL || fread(m_trace, 1, (size_t)len, p_file) != (size_t)len) {
+        fprintf(stderr, "%s: read failed\n", p_path);
+        fclose(p_file);
+        return -1;
+    }
+    fclose(p_file);
+    m_trace_len = (size_t)len;
+
+    // The trace must start at a boot record of a compatible firmware
+    const uint8_t* p_boot = m_trace + EVT_TRACE_RECORD_HDR_LEN;
+    if (m_trace_len < EVT_TRACE_RECORD_HDR_LEN + EVT_TRACE_BOOT_PARAMS_LEN ||
+        uint16_decode(&m_trace[4]) != EVT_TRACE_ID_BOOT ||
+        uint32_decode(&p_boot[0]) != EVT_TRACE_MAGIC) {
+        fprintf(stderr, "%s: not a BLE event trace\n", p_path);
+        return -1;
+    }
+    if (p_boot[4] != EVT_TRACE_VERSION || p_boot[5] != NRF_SD_BLE_API_VERSION) {
+        fprintf(stderr, "%s: trace version %u, SoftDevice API %u not supported\n", p_path, p_boot[4], p_boot[5]);
+        return -1;
+    }
+
+    m_trace_tick_hz = uint16_decode(&p_boot[6]);
+    if (m_trace_tick_hz == 0) {
+        fprintf(stderr, "%s: invalid timer frequency\n", p_path);
+        return -1;
+    }
+    return 0;
+}
+
+
+/**@brief Function for rebuilding a BLE event from a trace record.
+ *
+ * @return True if the event belongs to a known BLE module.
+ */
+static bool evt_build(ble_evt_t* p_evt, uint16_t evt_id, uint16_t conn_handle, const uint8_t* p_params, uint16_t params_len) {
+    const uint8_t* p_dst;
+    uint16_t       max_len;
+
+    memset(p_evt, 0, SIM_EVT_BUF_SIZE);
+    p_evt->header.evt_id = evt_id;
+
+    uint16_t* p_conn_handle = (uint16_t*)evt_trace_params_locate(p_evt, &p_dst, &max_len);
+    if (p_conn_handle == NULL) {
+        return false;
+    }
+
+    if (params_len > max_len) {
+        params_len = max_len;
+    }
+    *p_conn_handle = conn_handle;
+    memcpy((uint8_t*)p_dst, p_params, params_len);
+    p_evt->header.evt_len = (uint16_t)((p_dst - (const uint8_t*)p_evt) + params_len);
+    return true;
+}
+
+
+/**@brief Function for replaying the trace once.
+ *
+ * @param[in] start  Virtual time the pass starts at.
+ *
+ * @return Virtual time of the last event.
+ */
+static uint64_t pass_run(uint64_t start) {
+    static uint32_t evt_buf[(SIM_EVT_BUF_SIZE + 3) / 4];
+    ble_evt_t* p_evt = (ble_evt_t*)evt_buf;
+
+    uint64_t elapsed    = 0;
+    uint32_t last_ticks = 0;
+    size_t   pos        = 0;
+
+    while (pos + EVT_TRACE_RECORD_HDR_LEN <= m_trace_len) {
+        const uint8_t* p_record   = &m_trace[pos];
+        const uint32_t ticks      = uint32_decode(&p_record[0]) & TRACE_TICKS_MASK;
+        const uint16_t evt_id     = uint16_decode(&p_record[4]);
+        const uint16_t conn       = uint16_decode(&p_record[6]);
+        const uint16_t params_len = uint16_decode(&p_record[8]);
+
+        // A capture can end in the middle of a record
+        if (pos + EVT_TRACE_RECORD_HDR_LEN + params_len > m_trace_len) {
+            break;
+        }
+        pos += EVT_TRACE_RECORD_HDR_LEN + params_len;
+
+        if (evt_id == EVT_TRACE_ID_BOOT) {
+            // The target reset, its timer restarted
+            m_stats.boots += 1;
+            last_ticks     = ticks;
+            continue;
+        }
+        elapsed   += (ticks - last_ticks) & TRACE_TICKS_MASK;
+        last_ticks = ticks;
+
+        if (evt_id == EVT_TRACE_ID_DROPPED) {
+            m_stats.dropped += conn;
+            continue;
+        }
+        if (!evt_build(p_evt, evt_id, conn, &p_record[EVT_TRACE_RECORD_HDR_LEN], params_len)) {
+            m_stats.unknown += 1;
+            continue;
+        }
+
+        // Let application timers expire as they did between the events on the target
+        sim_sched_run_until(start + (elapsed * SIM_RTC_FREQ) / m_trace_tick_hz);
+
+        const uint64_t begin_ns = sim_now_ns();
+        sim_ble_evt_replay(p_evt);
+        m_stats.dispatch_ns += sim_now_ns() - begin_ns;
+        m_stats.events      += 1;
+    }
+
+    m_stats.traced_ticks = elapsed;
+    return start + (elapsed * SIM_RTC_FREQ) / m_trace_tick_hz;
+}
+
+
+int sim_replay_run(const char* p_path, uint32_t passes) {
+    if (trace_load(p_path) != 0) {
+        return -1;
+    }
+
+    sim_handler_stats_reset();
+
+    const uint64_t start_ns = sim_now_ns();
+    uint64_t       at       = sim_rtc_ticks();
+    for (uint32_t i = 0; i < passes; ++i) {
+        at = pass_run(at);
+    }
+    const double wall_s     = (sim_now_ns() - start_ns) / 1e9;
+    const double dispatch_s = m_stats.dispatch_ns / 1e9;
+
+    passes = (passes > 0) ? passes : 1;
+    printf("Replayed %s, %u pass(es)\n", p_path, (unsigned int)passes);
+    printf("per pass: %u events, %.1f s of target time, %u boots, %u records dropped on the target, %u unknown\n",
+           (unsigned int)(m_stats.events / passes),
+           (double)m_stats.traced_ticks / m_trace_tick_hz,
+           (unsigned int)(m_stats.boots / passes),
+           (unsigned int)(m_stats.dropped / passes),
+           (unsigned int)(m_stats.unknown / passes));
+    printf("throughput: %.0f events/s dispatch only, %.0f events/s including timers, %.3f s wall time\n\n",
+           (dispatch_s > 0) ? m_stats.events / dispatch_s : 0.0,
+           (wall_s > 0) ? m_stats.events / wall_s : 0.0, wall_s);
+
+    sim_handler_stats_print();
+
+    free(m_trace);
+    return 0;
+}
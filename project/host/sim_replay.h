@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Function for replaying a BLE event trace through the firmware.
+ *
+ * @details The trace is the binary capture of RTT up channel EVT_TRACE_RTT_CHANNEL, see
+ *          diag_service/evt_trace.h. Every event is dispatched to the BLE observers with
+ *          virtual time advanced to its timestamp first, so application timers expire
+ *          between events as they did on the target. Events are replayed back to back, and
+ *          the throughput and the cost of every observer are reported.
+ *
+ * @param[in] p_path  Trace file.
+ * @param[in] passes  Number of times to replay the trace.
+ *
+ * @return 0 on success, otherwise non-zero.
+ */
+int sim_replay_run(const char* p_path, uint32_t passes);
+
+
+#ifdef __cplusplus
+}
+#endif
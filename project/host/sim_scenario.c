@@ -0,0 +1,367 @@
+#include "sim_scenario.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "config.h"
+#include "ble_hci.h"
+#include "ble_srv_common.h"
+#include "auth_service/unlock_auth.h"
+#include "ble_service/adv_policy.h"
+#include "ble_service/phy_policy.h"
+#include "time_service/usage_schedule.h"
+
+#include "sim_softdevice.h"
+#include "sim_sdk.h"
+#include "sim_scheduler.h"
+#include "sim_phone.h"
+
+
+#define SCENARIO_MAX_ACTIONS 1024   /**< Maximum number of actions in one scenario period. */
+
+
+/**@brief Scenario action types. */
+typedef enum {
+    ACTION_CONNECT,
+    ACTION_NOTIFY,
+    ACTION_UNLOCK,
+    ACTION_DISCONNECT,
+    ACTION_TIMEOUT,
+    ACTION_BUTTON,
+    ACTION_RSSI
+} action_type_t;
+
+/**@brief Scenario action. */
+typedef struct {
+    uint64_t      at_ms;    /**< Time within the period. */
+    action_type_t type;     /**< Action. */
+    uint8_t       value;    /**< RSSI below 0 dBm for ACTION_RSSI. */
+} action_t;
+
+/**@brief Scenario statistics. */
+typedef struct {
+    uint32_t unlocks;             /**< Lock state changes to unlocked. */
+    uint32_t autolocks;           /**< Relocks done by the autolock timer. */
+    uint32_t manual_locks;        /**< Relocks done by the button. */
+    uint32_t missed_autolocks;    /**< Unlocks never followed by a relock. */
+    double   error_sum_ms;        /**< Sum of autolock timing errors. */
+    double   error_max_ms;        /**< Largest absolute autolock timing error. */
+    uint32_t rejected_connects;   /**< Connection attempts while not advertising. */
+    uint32_t dropped_writes;      /**< Writes attempted without a link. */
+    uint32_t system_offs;         /**< Times the lock went to system-off. */
+    uint64_t off_ticks;           /**< Virtual time spent in system-off. */
+} scenario_stats_t;
+
+
+static action_t         m_actions[SCENARIO_MAX_ACTIONS];
+static unsigned int     m_action_count;
+static uint64_t         m_period_ticks;
+static uint32_t         m_periods;
+static uint16_t         m_command_handle;
+static uint16_t         m_cccd_handle;
+static uint16_t         m_ack_cccd_handle;
+
+static scenario_stats_t m_stats;
+static bool             m_unlocked;
+static uint64_t         m_unlocked_at;
+static uint64_t         m_manual_lock_at = UINT64_MAX;
+static bool             m_was_off;
+static uint64_t         m_off_at;
+
+
+/**@brief Function for loading a scenario file.
+ */
+static int scenario_load(const char* p_path) {
+    FILE* p_file = fopen(p_path, "r");
+    if (p_file == NULL) {
+        perror(p_path);
+        return -1;
+    }
+
+    char line[128];
+    unsigned int line_num = 0;
+    while (fgets(line, sizeof(line), p_file) != NULL) {
+        ++line_num;
+
+        char* p_line = line + strspn(line, " \t");
+        if (*p_line == '#' || *p_line == '\n' || *p_line == '\0') {
+            continue;
+        }
+
+        unsigned long long at_ms;
+        char name[16];
+        unsigned int value = 0;
+        const int fields = sscanf(p_line, "%llu %15s %u", &at_ms, name, &value);
+        if (fields < 2 || m_action_count == SCENARIO_MAX_ACTIONS) {
+            fprintf(stderr, "%s:%u: invalid action\n", p_path, line_num);
+            fclose(p_file);
+            return -1;
+        }
+
+        action_t* p_action = &m_actions[m_action_count];
+        p_action->at_ms = at_ms;
+        p_action->value = (uint8_t)value;
+
+        if (strcmp(name, "connect") == 0) {
+            p_action->type = ACTION_CONNECT;
+        }
+        else if (strcmp(name, "notify") == 0) {
+            p_action->type = ACTION_NOTIFY;
+        }
+        else if (strcmp(name, "unlock") == 0) {
+            p_action->type = ACTION_UNLOCK;
+        }
+        else if (strcmp(name, "disconnect") == 0) {
+            p_action->type = ACTION_DISCONNECT;
+        }
+        else if (strcmp(name, "timeout") == 0) {
+            p_action->type = ACTION_TIMEOUT;
+        }
+        else if (strcmp(name, "button") == 0) {
+            p_action->type = ACTION_BUTTON;
+        }
+        else if (strcmp(name, "rssi") == 0 && fields == 3 && value <= 127) {
+            p_action->type = ACTION_RSSI;
+        }
+        else {
+            fprintf(stderr, "%s:%u: unknown action '%s'\n", p_path, line_num, name);
+            fclose(p_file);
+            return -1;
+        }
+
+        if (m_action_count > 0 && at_ms < m_actions[m_action_count - 1].at_ms) {
+            fprintf(stderr, "%s:%u: actions must be in time order\n", p_path, line_num);
+            fclose(p_file);
+            return -1;
+        }
+        ++m_action_count;
+    }
+
+    fclose(p_file);
+    return 0;
+}
+
+
+/**@brief Function for tracking lock actuation, to measure the autolock timing.
+ */
+static void on_led_change(uint32_t led_idx, bool on) {
+    if (led_idx != DOOR_LOCK_LED) {
+        return;
+    }
+
+    const uint64_t now = sim_rtc_ticks();
+
+    if (!on) {
+        // Every unlock restarts the autolock timer
+        m_stats.unlocks += m_unlocked ? 0 : 1;
+        m_unlocked       = true;
+        m_unlocked_at    = now;
+        return;
+    }
+
+    if (!m_unlocked) {
+        return;
+    }
+    m_unlocked = false;
+
+    if (m_manual_lock_at == now) {
+        m_stats.manual_locks += 1;
+        return;
+    }
+
+    const double error_ms = sim_rtc_ticks_to_ms((int64_t)(now - m_unlocked_at)) - DOOR_AUTOLOCK_TIMEOUT_MS;
+    m_stats.autolocks    += 1;
+    m_stats.error_sum_ms += error_ms;
+    if (fabs(error_ms) > m_stats.error_max_ms) {
+        m_stats.error_max_ms = fabs(error_ms);
+    }
+}
+
+
+/**@brief Function for tracking time spent in system-off.
+ */
+static void system_off_track(void) {
+    const bool off = sim_system_off_requested();
+
+    if (off && !m_was_off) {
+        m_stats.system_offs += 1;
+        m_off_at = sim_rtc_ticks();
+
+        // The autolock timer does not survive system-off
+        if (m_unlocked) {
+            m_stats.missed_autolocks += 1;
+            m_unlocked = false;
+        }
+    }
+    else if (!off && m_was_off) {
+        m_stats.off_ticks += sim_rtc_ticks() - m_off_at;
+    }
+    m_was_off = off;
+}
+
+
+/**@brief Function for running one scenario action.
+ *
+ * @param[in] p_context  Unused.
+ * @param[in] arg        Index of the action in the scenario.
+ */
+static void action_run(void* p_context, uint32_t arg) {
+    static uint32_t period;
+    static const ble_gap_addr_t peer_addr = {
+        .addr_type = BLE_GAP_ADDR_TYPE_RANDOM_STATIC,
+        .addr      = {0x01, 0x02, 0x03, 0x04, 0x05, 0xC6}
+    };
+    static const uint8_t cccd_notify[BLE_CCCD_VALUE_LEN] = {BLE_GATT_HVX_NOTIFICATION, 0x00};
+    uint8_t              command[UNLOCK_AUTH_COMMAND_LEN];
+
+    const action_t* p_action = &m_actions[arg];
+
+    switch (p_action->type) {
+        case ACTION_CONNECT:
+            if (!sim_gap_connect(&peer_addr)) {
+                m_stats.rejected_connects += 1;
+            }
+            break;
+
+        case ACTION_NOTIFY:
+            if (sim_gap_is_connected()) {
+                sim_gatts_write(m_cccd_handle, cccd_notify, sizeof(cccd_notify));
+                sim_gatts_write(m_ack_cccd_handle, cccd_notify, sizeof(cccd_notify));
+            }
+            break;
+
+        case ACTION_UNLOCK:
+            if (!sim_gap_is_connected()) {
+                m_stats.dropped_writes += 1;
+                break;
+            }
+            sim_phone_command_build(command, UNLOCK_AUTH_OP_UNLOCK);
+            sim_gatts_write(m_command_handle, command, sizeof(command));
+            break;
+
+        case ACTION_DISCONNECT:
+            sim_gap_disconnect(BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+            break;
+
+        case ACTION_TIMEOUT:
+            sim_gap_disconnect(BLE_HCI_CONNECTION_TIMEOUT);
+            break;
+
+        case ACTION_BUTTON:
+            m_manual_lock_at = sim_rtc_ticks();
+            sim_bsp_evt_send(DOOR_LOCK_BUTTON_EVT);
+            break;
+
+        case ACTION_RSSI:
+            sim_gap_rssi_set((int8_t)-p_action->value);
+            break;
+    }
+
+    // Schedule the next action, wrapping into the next period
+    uint32_t next = arg + 1;
+    if (next == m_action_count) {
+        next = 0;
+        if (++period == m_periods) {
+            return;
+        }
+    }
+    sim_sched_add(period * m_period_ticks + sim_rtc_ms_to_ticks(m_actions[next].at_ms), action_run, NULL, next);
+}
+
+
+/**@brief Function for printing the scenario report.
+ */
+static void report_print(double wall_s) {
+    const uint64_t sim_ticks = sim_rtc_ticks();
+    const double   sim_s     = sim_rtc_ticks_to_ms((int64_t)sim_ticks) / 1000.0;
+    const uint32_t evts      = sim_ble_evt_count() + sim_sdk_evt_count();
+
+    printf("Simulated %.1f days in %.3f s wall time (%.0fx real time)\n",
+           sim_s / 86400.0, wall_s, (wall_s > 0) ? sim_s / wall_s : 0.0);
+    printf("Policy: autolock %u ms, advertising %.1f ms for %u ms, %.1f ms for %u ms, then %.1f ms\n",
+           (unsigned int)DOOR_AUTOLOCK_TIMEOUT_MS,
+           APP_ADV_INTERVAL * 0.625, (unsigned int)APP_ADV_DURATION * 10,
+           APP_ADV_SLOW_INTERVAL * 0.625, (unsigned int)APP_ADV_SLOW_DURATION * 10,
+           APP_ADV_ULTRA_SLOW_INTERVAL * 0.625);
+
+    printf("\nEvents\n");
+    printf("processed %u (%u BLE), %.4f per simulated second\n",
+           (unsigned int)evts, (unsigned int)sim_ble_evt_count(), (sim_s > 0) ? evts / sim_s : 0.0);
+    printf("peak scheduler queue depth %u, peak SoftDevice event queue depth %u\n",
+           sim_sched_depth_peak(), sim_ble_evt_queue_peak());
+
+    printf("\nAutolock\n");
+    printf("unlocks %u, autolocks %u, manual locks %u, missed (system-off while unlocked) %u\n",
+           (unsigned int)m_stats.unlocks, (unsigned int)m_stats.autolocks,
+           (unsigned int)m_stats.manual_locks, (unsigned int)m_stats.missed_autolocks);
+    printf("timing error mean %.3f ms, max %.3f ms\n",
+           (m_stats.autolocks > 0) ? m_stats.error_sum_ms / m_stats.autolocks : 0.0, m_stats.error_max_ms);
+
+    printf("\nReachability\n");
+    printf("system-off %u times, %.2f %% of the time, rejected connects %u, dropped writes %u\n",
+           (unsigned int)m_stats.system_offs,
+           (sim_ticks > 0) ? (100.0 * m_stats.off_ticks) / sim_ticks : 0.0,
+           (unsigned int)m_stats.rejected_connects, (unsigned int)m_stats.dropped_writes);
+
+    const adv_policy_stats_t* p_adv = adv_policy_stats_get();
+    printf("advertising phases started: directed %u, whitelist %u, fast %u, slow %u, habitual %u, ultra-slow %u; wakes %u\n",
+           (unsigned int)p_adv->directed, (unsigned int)p_adv->whitelist, (unsigned int)p_adv->fast,
+           (unsigned int)p_adv->slow, (unsigned int)p_adv->habitual, (unsigned int)p_adv->ultra_slow,
+           (unsigned int)p_adv->wakes);
+
+    const usage_schedule_stats_t* p_usage = usage_schedule_stats_get();
+    printf("usage schedule: unlocks recorded %u, without local time %u, habitual hours %u, recomputes %u\n",
+           (unsigned int)p_usage->unlocks, (unsigned int)p_usage->untimed,
+           (unsigned int)p_usage->habitual_hours, (unsigned int)p_usage->recomputes);
+
+    const phy_policy_stats_t* p_phy = phy_policy_stats_get();
+    printf("\nPHY\n");
+    printf("connections ended on 1M %u, 2M %u, Coded %u; requests %u, errors %u, refused %u\n",
+           (unsigned int)p_phy->conns_1m, (unsigned int)p_phy->conns_2m, (unsigned int)p_phy->conns_coded,
+           (unsigned int)p_phy->requests, (unsigned int)p_phy->request_errors, (unsigned int)p_phy->refused);
+}
+
+
+int sim_scenario_run(const char* p_path,
+                     uint64_t period_ms,
+                     uint32_t periods,
+                     uint16_t command_handle,
+                     uint16_t cccd_handle,
+                     uint16_t ack_cccd_handle) {
+    if (scenario_load(p_path) != 0) {
+        return -1;
+    }
+    if (m_action_count == 0 || periods == 0) {
+        return 0;
+    }
+    if (m_actions[m_action_count - 1].at_ms >= period_ms) {
+        fprintf(stderr, "%s: actions past the end of the %llu ms period\n", p_path, (unsigned long long)period_ms);
+        return -1;
+    }
+
+    m_period_ticks    = sim_rtc_ms_to_ticks(period_ms);
+    m_periods         = periods;
+    m_command_handle  = command_handle;
+    m_cccd_handle     = cccd_handle;
+    m_ack_cccd_handle = ack_cccd_handle;
+
+    sim_led_handler_set(on_led_change);
+
+    const uint64_t start_ns = sim_now_ns();
+    const uint64_t end      = (uint64_t)periods * m_period_ticks;
+
+    sim_sched_add(sim_rtc_ms_to_ticks(m_actions[0].at_ms), action_run, NULL, 0);
+    while (sim_sched_run_next(end)) {
+        system_off_track();
+    }
+    sim_sched_run_until(end);
+    system_off_track();
+    if (m_was_off) {
+        m_stats.off_ticks += sim_rtc_ticks() - m_off_at;
+    }
+
+    report_print((sim_now_ns() - start_ns) / 1e9);
+    return 0;
+}
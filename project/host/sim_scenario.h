@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Function for running a lock scenario in virtual time.
+ *
+ * @details The scenario file has one action per line, "<time_ms> <action> [argument]", with
+ *          times relative to the start of the period. Lines starting with '#' are comments.
+ *          Actions are:
+ *          - connect            A central connects, if the lock is advertising.
+ *          - notify             The central enables lock state and acknowledgement notifications.
+ *          - unlock             The central writes a signed unlock command.
+ *          - disconnect         The central terminates the link.
+ *          - timeout            The link is lost through a supervision timeout.
+ *          - button             The door lock button is pressed.
+ *          - rssi <value>       The link RSSI changes to -value dBm.
+ *
+ *          The script is replayed back to back for the given number of periods, and the
+ *          autolock accuracy, event rate and queue depth are reported.
+ *
+ * @param[in] p_path           Scenario file.
+ * @param[in] period_ms        Length of one period of the script.
+ * @param[in] periods          Number of times to replay the script.
+ * @param[in] command_handle   Value handle of the command characteristic.
+ * @param[in] cccd_handle      CCCD handle of the lock state characteristic.
+ * @param[in] ack_cccd_handle  CCCD handle of the acknowledgement characteristic.
+ *
+ * @return 0 on success, otherwise non-zero.
+ */
+int sim_scenario_run(const char* p_path,
+                     uint64_t period_ms,
+                     uint32_t periods,
+                     uint16_t command_handle,
+                     uint16_t cccd_handle,
+                     uint16_t ack_cccd_handle);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,138 @@
+#include "sim_scheduler.h"
+
+#include "app_timer.h"
+
+#include "sim_softdevice.h"
+
+
+/**@brief Scheduled event. */
+typedef struct {
+    uint64_t            at;         /**< Virtual time to run at. */
+    uint64_t            seq;        /**< Scheduling order, for events at the same time. */
+    sim_sched_handler_t handler;    /**< Event handler. */
+    void*               p_context;  /**< Handler context. */
+    uint32_t            arg;        /**< Handler argument. */
+} sim_sched_evt_t;
+
+
+static sim_sched_evt_t m_heap[SIM_SCHED_QUEUE_SIZE];   /**< Binary min-heap ordered by (at, seq). */
+static unsigned int    m_depth;
+static unsigned int    m_depth_peak;
+static uint64_t        m_seq;
+static uint64_t        m_now;
+
+
+uint64_t sim_rtc_ticks(void) {
+    return m_now;
+}
+
+
+uint64_t sim_rtc_ms_to_ticks(uint64_t ms) {
+    return (ms * SIM_RTC_FREQ + 500) / 1000;
+}
+
+
+double sim_rtc_ticks_to_ms(int64_t ticks) {
+    return ((double)ticks * 1000.0) / SIM_RTC_FREQ;
+}
+
+
+static bool evt_before(const sim_sched_evt_t* p_a, const sim_sched_evt_t* p_b) {
+    return (p_a->at < p_b->at) || (p_a->at == p_b->at && p_a->seq < p_b->seq);
+}
+
+
+static void evt_swap(unsigned int a, unsigned int b) {
+    const sim_sched_evt_t tmp = m_heap[a];
+    m_heap[a] = m_heap[b];
+    m_heap[b] = tmp;
+}
+
+
+bool sim_sched_add(uint64_t at, sim_sched_handler_t handler, void* p_context, uint32_t arg) {
+    if (m_depth == SIM_SCHED_QUEUE_SIZE) {
+        return false;
+    }
+
+    unsigned int i = m_depth++;
+    m_heap[i].at        = (at < m_now) ? m_now : at;
+    m_heap[i].seq       = m_seq++;
+    m_heap[i].handler   = handler;
+    m_heap[i].p_context = p_context;
+    m_heap[i].arg       = arg;
+
+    while (i > 0 && evt_before(&m_heap[i], &m_heap[(i - 1) / 2])) {
+        evt_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+
+    if (m_depth > m_depth_peak) {
+        m_depth_peak = m_depth;
+    }
+    return true;
+}
+
+
+/**@brief Function for removing the earliest event from the heap.
+ */
+static sim_sched_evt_t evt_pop(void) {
+    const sim_sched_evt_t evt = m_heap[0];
+
+    m_heap[0] = m_heap[--m_depth];
+
+    unsigned int i = 0;
+    for (;;) {
+        const unsigned int left  = 2 * i + 1;
+        const unsigned int right = left + 1;
+        unsigned int first = i;
+
+        if (left < m_depth && evt_before(&m_heap[left], &m_heap[first])) {
+            first = left;
+        }
+        if (right < m_depth && evt_before(&m_heap[right], &m_heap[first])) {
+            first = right;
+        }
+        if (first == i) {
+            break;
+        }
+        evt_swap(i, first);
+        i = first;
+    }
+
+    return evt;
+}
+
+
+bool sim_sched_run_next(uint64_t until) {
+    if (m_depth == 0 || m_heap[0].at > until) {
+        return false;
+    }
+
+    const sim_sched_evt_t evt = evt_pop();
+    m_now = evt.at;
+    evt.handler(evt.p_context, evt.arg);
+
+    // Dispatch what the SoftDevice raised in response, at the same virtual time
+    sim_ble_evt_pump();
+    return true;
+}
+
+
+void sim_sched_run_until(uint64_t until) {
+    while (sim_sched_run_next(until)) {
+    }
+
+    if (until > m_now) {
+        m_now = until;
+    }
+}
+
+
+unsigned int sim_sched_depth(void) {
+    return m_depth;
+}
+
+
+unsigned int sim_sched_depth_peak(void) {
+    return m_depth_peak;
+}
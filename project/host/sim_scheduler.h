@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define SIM_SCHED_QUEUE_SIZE 256    /**< Maximum number of pending scheduled events. */
+
+/**@brief Virtual RTC rate, the application timer tick rate after the prescaler, as in APP_TIMER_TICKS.
+ *        Expands where app_timer.h is included. */
+#define SIM_RTC_FREQ (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))
+
+
+/**@brief Scheduled event handler type.
+ *
+ * @param[in] p_context  Context given when the event was scheduled.
+ * @param[in] arg        Argument given when the event was scheduled.
+ */
+typedef void (*sim_sched_handler_t)(void* p_context, uint32_t arg);
+
+
+/**@brief Function for reading the virtual RTC.
+ *
+ * @return Virtual time in application timer ticks since the simulation started.
+ */
+uint64_t sim_rtc_ticks(void);
+
+
+/**@brief Function for converting milliseconds to virtual RTC ticks. */
+uint64_t sim_rtc_ms_to_ticks(uint64_t ms);
+
+
+/**@brief Function for converting virtual RTC ticks to milliseconds. */
+double sim_rtc_ticks_to_ms(int64_t ticks);
+
+
+/**@brief Function for scheduling an event at a virtual time.
+ *
+ * @details Events at the same time run in the order they were scheduled.
+ *
+ * @param[in] at         Virtual time in ticks. Times in the past run at the current time.
+ * @param[in] handler    Event handler.
+ * @param[in] p_context  Context passed to the handler.
+ * @param[in] arg        Argument passed to the handler.
+ *
+ * @return True on success, false if the queue is full.
+ */
+bool sim_sched_add(uint64_t at, sim_sched_handler_t handler, void* p_context, uint32_t arg);
+
+
+/**@brief Function for running the next scheduled event, if it is due by a given time.
+ *
+ * @details The virtual RTC jumps to the event time. Events queued by the simulated
+ *          SoftDevice while the handler runs are dispatched before returning.
+ *
+ * @param[in] until  Latest virtual time to run events at.
+ *
+ * @return True if an event was run.
+ */
+bool sim_sched_run_next(uint64_t until);
+
+
+/**@brief Function for running all events due by a given time, then advancing the RTC to it.
+ *
+ * @param[in] until  Virtual time to run to.
+ */
+void sim_sched_run_until(uint64_t until);
+
+
+/**@brief Function for getting the number of pending scheduled events. */
+unsigned int sim_sched_depth(void);
+
+
+/**@brief Function for getting the largest number of pending scheduled events seen. */
+unsigned int sim_sched_depth_peak(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,981 @@
+#include "sim_sdk.h"
+#include "sim_softdevice.h"
+#include "sim_scheduler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nordic_common.h"
+#include "app_error.h"
+#include "app_timer.h"
+#include "boards.h"
+#include "bsp.h"
+#include "bsp_btn_ble.h"
+#include "nrf_pwr_mgmt.h"
+#include "nrf_sdh.h"
+#include "nrf_sdh_ble.h"
+#include "nrf_ble_gatt.h"
+#include "nrf_ble_qwr.h"
+#include "ble_advertising.h"
+#include "ble_conn_params.h"
+#include "peer_manager.h"
+#include "peer_manager_handler.h"
+#include "fds.h"
+#include "nrf_log_default_backends.h"
+#include "SEGGER_RTT.h"
+
+
+#define SIM_MAX_TIMERS      12  /**< Maximum number of application timers. */
+#define SIM_FDS_MAX_RECORDS 16  /**< Maximum number of flash data storage records. */
+#define SIM_FDS_MAX_WORDS   42  /**< Maximum length of a flash data storage record, in words, the unlock histogram. */
+#define SIM_FDS_MAX_USERS   4   /**< Maximum number of flash data storage event handlers. */
+
+#define SIM_ADV_DIRECTED_HIGH_DUTY_DURATION 128 /**< High duty directed advertising duration, fixed by the SoftDevice, in 10 ms units. */
+
+
+/**@brief Simulated application timer. */
+typedef struct {
+    app_timer_id_t              id;         /**< Timer instance created by the firmware. */
+    app_timer_mode_t            mode;       /**< Single shot or repeated. */
+    app_timer_timeout_handler_t handler;    /**< Timeout handler. */
+    void*                       p_context;  /**< Context given to app_timer_start. */
+    uint32_t                    period;     /**< Timeout in ticks, reloaded in repeated mode. */
+    uint64_t                    expires_at; /**< Virtual time of the next timeout. */
+    uint32_t                    generation; /**< Incremented on every start/stop, to cancel scheduled timeouts. */
+    bool                        active;     /**< True if the timer is running. */
+} sim_timer_t;
+
+/**@brief Simulated advertising module state. */
+typedef struct {
+    ble_adv_evt_handler_t  evt_handler;     /**< Handler given to ble_advertising_init. */
+    ble_adv_modes_config_t config;          /**< Fast and slow modes, from ble_advertising_init or ble_advertising_modes_config_set. */
+    ble_adv_mode_t         mode;            /**< Current mode, BLE_ADV_MODE_DIRECTED, BLE_ADV_MODE_FAST or BLE_ADV_MODE_SLOW while active. */
+    uint32_t               interval;        /**< Interval of the current mode, in 0.625 ms units. */
+    uint32_t               generation;      /**< Incremented on every start/stop, to cancel scheduled timeouts. */
+    bool                   active;          /**< True while advertising. */
+    bool                   peer_addr_set;   /**< The peer address request was answered, directed modes can run. */
+    uint8_t                manuf_data[BLE_GAP_ADV_SET_DATA_SIZE_MAX];  /**< Manufacturer specific scan response payload. */
+    uint16_t               manuf_len;       /**< Length of manuf_data. */
+} sim_adv_t;
+
+/**@brief Simulated flash data storage record. */
+typedef struct {
+    fds_header_t header;                    /**< Record header, file ID, key, length and ID. */
+    uint32_t     data[SIM_FDS_MAX_WORDS];   /**< Record data. */
+    bool         valid;                     /**< False once deleted or replaced. */
+} sim_fds_record_t;
+
+
+static sim_timer_t          m_timers[SIM_MAX_TIMERS];
+static unsigned int         m_timer_count;
+static sim_adv_t            m_adv;
+static sim_fds_record_t     m_fds_records[SIM_FDS_MAX_RECORDS];
+static uint32_t             m_fds_record_id;
+static fds_cb_t             m_fds_users[SIM_FDS_MAX_USERS];
+static unsigned int         m_fds_user_count;
+
+static bsp_event_callback_t m_bsp_evt_handler;
+static sim_led_handler_t    m_led_handler;
+static bool                 m_led_on[LEDS_NUMBER];
+static uint64_t             m_led_changed_ns[LEDS_NUMBER];
+static bool                 m_system_off;
+static bool                 m_sim_started;
+static uint32_t             m_evt_count;
+static FILE*                m_rtt_capture;
+static unsigned             m_rtt_capture_channel;
+static nrf_ble_qwr_evt_handler_t m_qwr_callback;
+static uint16_t             m_qwr_handles[NRF_BLE_QWR_MAX_ATTR];
+static unsigned int         m_qwr_handle_count;
+
+
+/*
+ * Simulation driver hooks
+ */
+
+bool sim_system_off_requested(void) {
+    return m_system_off;
+}
+
+
+uint64_t sim_board_led_changed_ns(uint32_t led_idx) {
+    return (led_idx < LEDS_NUMBER) ? m_led_changed_ns[led_idx] : 0;
+}
+
+
+void sim_led_handler_set(sim_led_handler_t handler) {
+    m_led_handler = handler;
+}
+
+
+void sim_app_timers_fire(void) {
+    uint64_t until = sim_rtc_ticks();
+
+    for (unsigned int i = 0; i < m_timer_count; ++i) {
+        if (m_timers[i].active && m_timers[i].mode == APP_TIMER_MODE_SINGLE_SHOT && m_timers[i].expires_at > until) {
+            until = m_timers[i].expires_at;
+        }
+    }
+    sim_sched_run_until(until);
+}
+
+
+void sim_bsp_evt_send(bsp_event_t event) {
+    if (m_system_off) {
+        // Any button wakes the chip from system-off, through a reset
+        sim_system_wake();
+        return;
+    }
+
+    if (m_bsp_evt_handler != NULL) {
+        ++m_evt_count;
+        m_bsp_evt_handler(event);
+    }
+}
+
+
+void sim_system_wake(void) {
+    // A wake from system-off is a reset. Application RAM is not re-initialized here, the
+    // visible effect is that the lock advertises again.
+    m_system_off = false;
+    ble_advertising_start(NULL, BLE_ADV_MODE_FAST);
+}
+
+
+bool sim_adv_is_active(void) {
+    return m_adv.active && !m_system_off;
+}
+
+
+double sim_adv_interval_ms(void) {
+    return m_adv.interval * 0.625;
+}
+
+
+uint16_t sim_adv_manuf_data_get(const uint8_t** pp_data) {
+    *pp_data = m_adv.manuf_data;
+    return m_adv.manuf_len;
+}
+
+
+uint32_t sim_sdk_evt_count(void) {
+    return m_evt_count;
+}
+
+
+/*
+ * Error handling
+ */
+
+void app_error_handler(ret_code_t error_code, uint32_t line_num, const uint8_t* p_file_name) {
+    fprintf(stderr, "Fatal error 0x%08x at %s:%u\n", (unsigned int)error_code, (const char*)p_file_name, (unsigned int)line_num);
+    exit(EXIT_FAILURE);
+}
+
+
+void app_error_handler_bare(ret_code_t error_code) {
+    fprintf(stderr, "Fatal error 0x%08x\n", (unsigned int)error_code);
+    exit(EXIT_FAILURE);
+}
+
+
+void nrf_log_default_backends_init(void) {
+}
+
+
+/*
+ * SEGGER RTT
+ */
+
+bool sim_rtt_capture_open(unsigned channel, const char* p_path) {
+    m_rtt_capture = fopen(p_path, "wb");
+    if (m_rtt_capture == NULL) {
+        perror(p_path);
+        return false;
+    }
+    m_rtt_capture_channel = channel;
+    return true;
+}
+
+
+int SEGGER_RTT_ConfigUpBuffer(unsigned BufferIndex, const char* sName, void* pBuffer, unsigned BufferSize, unsigned Flags) {
+    UNUSED_PARAMETER(BufferIndex);
+    UNUSED_PARAMETER(sName);
+    UNUSED_PARAMETER(pBuffer);
+    UNUSED_PARAMETER(BufferSize);
+    UNUSED_PARAMETER(Flags);
+    return 0;
+}
+
+
+unsigned SEGGER_RTT_Write(unsigned BufferIndex, const void* pBuffer, unsigned NumBytes) {
+    // The host reads the buffer as fast as it is written
+    if (m_rtt_capture != NULL && BufferIndex == m_rtt_capture_channel) {
+        return (unsigned)fwrite(pBuffer, 1, NumBytes, m_rtt_capture);
+    }
+    return NumBytes;
+}
+
+
+/*
+ * Application timer
+ */
+
+ret_code_t app_timer_init(void) {
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t app_timer_create(app_timer_id_t const* p_timer_id, app_timer_mode_t mode, app_timer_timeout_handler_t timeout_handler) {
+    if (p_timer_id == NULL || timeout_handler == NULL) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+    if (m_timer_count == SIM_MAX_TIMERS) {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    sim_timer_t* p_timer = &m_timers[m_timer_count++];
+    memset(p_timer, 0, sizeof(*p_timer));
+    p_timer->id      = *p_timer_id;
+    p_timer->mode    = mode;
+    p_timer->handler = timeout_handler;
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for handling a scheduled timer timeout.
+ *
+ * @param[in] p_context  Simulated timer.
+ * @param[in] arg        Timer generation when the timeout was scheduled.
+ */
+static void timer_timeout(void* p_context, uint32_t arg) {
+    sim_timer_t* p_timer = (sim_timer_t*)p_context;
+
+    if (!p_timer->active || p_timer->generation != arg) {
+        return;
+    }
+
+    if (p_timer->mode == APP_TIMER_MODE_REPEATED) {
+        p_timer->expires_at += p_timer->period;
+        sim_sched_add(p_timer->expires_at, timer_timeout, p_timer, p_timer->generation);
+    }
+    else {
+        p_timer->active = false;
+    }
+
+    ++m_evt_count;
+    p_timer->handler(p_timer->p_context);
+}
+
+
+/**@brief Function for finding the simulated timer of a timer instance.
+ */
+static sim_timer_t* timer_find(app_timer_id_t timer_id) {
+    for (unsigned int i = 0; i < m_timer_count; ++i) {
+        if (m_timers[i].id == timer_id) {
+            return &m_timers[i];
+        }
+    }
+    return NULL;
+}
+
+
+ret_code_t app_timer_start(app_timer_id_t timer_id, uint32_t timeout_ticks, void* p_context) {
+    sim_timer_t* p_timer = timer_find(timer_id);
+    if (p_timer == NULL || timeout_ticks < APP_TIMER_MIN_TIMEOUT_TICKS) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // Starting a running timer restarts it, as in app_timer2
+    p_timer->p_context   = p_context;
+    p_timer->period      = timeout_ticks;
+    p_timer->expires_at  = sim_rtc_ticks() + timeout_ticks;
+    p_timer->generation += 1;
+    p_timer->active      = true;
+
+    if (!sim_sched_add(p_timer->expires_at, timer_timeout, p_timer, p_timer->generation)) {
+        return NRF_ERROR_NO_MEM;
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t app_timer_cnt_get(void) {
+    // 24-bit RTC counter
+    return (uint32_t)(sim_rtc_ticks() & 0x00FFFFFF);
+}
+
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from) {
+    return (ticks_to - ticks_from) & 0x00FFFFFF;
+}
+
+
+ret_code_t app_timer_stop(app_timer_id_t timer_id) {
+    sim_timer_t* p_timer = timer_find(timer_id);
+    if (p_timer == NULL) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    p_timer->active      = false;
+    p_timer->generation += 1;
+    return NRF_SUCCESS;
+}
+
+
+/*
+ * Board support
+ */
+
+/**@brief Function for recording an LED change, which is what actuates the lock on the boards.
+ */
+static void board_led_set(uint32_t led_idx, bool on) {
+    if (led_idx < LEDS_NUMBER) {
+        m_led_changed_ns[led_idx] = sim_now_ns();
+        m_led_on[led_idx]         = on;
+
+        if (m_led_handler != NULL) {
+            m_led_handler(led_idx, on);
+        }
+    }
+}
+
+
+void bsp_board_led_on(uint32_t led_idx) {
+    board_led_set(led_idx, true);
+}
+
+
+void bsp_board_led_off(uint32_t led_idx) {
+    board_led_set(led_idx, false);
+}
+
+
+bool bsp_board_led_state_get(uint32_t led_idx) {
+    return (led_idx < LEDS_NUMBER) ? m_led_on[led_idx] : false;
+}
+
+
+uint32_t bsp_init(uint32_t type, bsp_event_callback_t callback) {
+    UNUSED_PARAMETER(type);
+    m_bsp_evt_handler = callback;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t bsp_indication_set(bsp_indication_t indicate) {
+    UNUSED_PARAMETER(indicate);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t bsp_btn_ble_init(bsp_btn_ble_error_handler_t error_handler, bsp_event_t* p_startup_bsp_evt) {
+    UNUSED_PARAMETER(error_handler);
+    if (p_startup_bsp_evt != NULL) {
+        *p_startup_bsp_evt = BSP_EVENT_NOTHING;
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t bsp_btn_ble_sleep_mode_prepare(void) {
+    return NRF_SUCCESS;
+}
+
+
+/*
+ * Power management
+ */
+
+ret_code_t nrf_pwr_mgmt_init(void) {
+    return NRF_SUCCESS;
+}
+
+
+void nrf_pwr_mgmt_run(void) {
+    // The first time the firmware goes idle, initialization is done and the simulation runs
+    if (!m_sim_started) {
+        m_sim_started = true;
+        sim_idle();
+    }
+}
+
+
+uint32_t sd_power_system_off(void) {
+    // The RTC stops, so no timer survives system-off
+    for (unsigned int i = 0; i < m_timer_count; ++i) {
+        m_timers[i].active      = false;
+        m_timers[i].generation += 1;
+    }
+
+    m_adv.active      = false;
+    m_adv.generation += 1;
+    m_system_off      = true;
+    return NRF_SUCCESS;
+}
+
+
+/*
+ * SoftDevice handler
+ */
+
+ret_code_t nrf_sdh_enable_request(void) {
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_sdh_ble_default_cfg_set(uint8_t conn_cfg_tag, uint32_t* p_ram_start) {
+    UNUSED_PARAMETER(conn_cfg_tag);
+    *p_ram_start = 0;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_sdh_ble_enable(uint32_t* p_app_ram_start) {
+    UNUSED_PARAMETER(p_app_ram_start);
+    return NRF_SUCCESS;
+}
+
+
+/*
+ * BLE libraries. Apart from the advertising timing, they have no influence on the door lock,
+ * so they only accept their configuration.
+ */
+
+ret_code_t nrf_ble_gatt_init(nrf_ble_gatt_t* p_gatt, nrf_ble_gatt_evt_handler_t evt_handler) {
+    UNUSED_PARAMETER(p_gatt);
+    UNUSED_PARAMETER(evt_handler);
+    return NRF_SUCCESS;
+}
+
+
+void nrf_ble_gatt_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context) {
+    UNUSED_PARAMETER(p_ble_evt);
+    UNUSED_PARAMETER(p_context);
+}
+
+
+ret_code_t nrf_ble_qwr_init(nrf_ble_qwr_t* p_qwr, nrf_ble_qwr_init_t const* p_qwr_init) {
+    UNUSED_PARAMETER(p_qwr);
+
+    // The simulated SoftDevice applies queued writes itself, the buffer is not used
+    m_qwr_callback     = p_qwr_init->callback;
+    m_qwr_handle_count = 0;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_ble_qwr_attr_register(nrf_ble_qwr_t* p_qwr, uint16_t attr_handle) {
+    UNUSED_PARAMETER(p_qwr);
+
+    if (m_qwr_handle_count == NRF_BLE_QWR_MAX_ATTR) {
+        return NRF_ERROR_NO_MEM;
+    }
+    m_qwr_handles[m_qwr_handle_count++] = attr_handle;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t nrf_ble_qwr_conn_handle_assign(nrf_ble_qwr_t* p_qwr, uint16_t conn_handle) {
+    UNUSED_PARAMETER(p_qwr);
+    UNUSED_PARAMETER(conn_handle);
+    return NRF_SUCCESS;
+}
+
+
+void nrf_ble_qwr_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_context) {
+    nrf_ble_qwr_t* p_qwr = (nrf_ble_qwr_t*)p_context;
+
+    if (p_ble_evt->header.evt_id != BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST ||
+        p_ble_evt->evt.gatts_evt.params.authorize_request.type != BLE_GATTS_AUTHORIZE_TYPE_WRITE ||
+        p_ble_evt->evt.gatts_evt.params.authorize_request.request.write.op != BLE_GATTS_OP_EXEC_WRITE_REQ_NOW) {
+        return;
+    }
+
+    // The simulated central writes one attribute per queued write, every registered one is asked
+    uint16_t status = BLE_GATT_STATUS_SUCCESS;
+    for (unsigned int i = 0; i < m_qwr_handle_count && status == BLE_GATT_STATUS_SUCCESS; ++i) {
+        nrf_ble_qwr_evt_t evt = {
+            .evt_type    = NRF_BLE_QWR_EVT_AUTH_REQUEST,
+            .attr_handle = m_qwr_handles[i]
+        };
+        status = m_qwr_callback(p_qwr, &evt);
+    }
+
+    ble_gatts_rw_authorize_reply_params_t reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    reply.params.write.gatt_status = status;
+    reply.params.write.update      = 1;
+    if (sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &reply) != NRF_SUCCESS ||
+        status != BLE_GATT_STATUS_SUCCESS) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < m_qwr_handle_count; ++i) {
+        nrf_ble_qwr_evt_t evt = {
+            .evt_type    = NRF_BLE_QWR_EVT_EXECUTE_WRITE,
+            .attr_handle = m_qwr_handles[i]
+        };
+        m_qwr_callback(p_qwr, &evt);
+    }
+}
+
+
+uint32_t ble_conn_params_init(const ble_conn_params_init_t* p_init) {
+    UNUSED_PARAMETER(p_init);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_conn_params_change_conn_params(uint16_t conn_handle, ble_gap_conn_params_t* p_new_params) {
+    return sd_ble_gap_conn_param_update(conn_handle, p_new_params);
+}
+
+
+/**@brief Function for keeping the manufacturer specific data, for the phones.
+ *
+ * @details The challenge is in the scan response, or leads the single record of the advertising
+ *          data with extended advertising.
+ */
+static void adv_manuf_data_store(const ble_advdata_t* p_advdata, const ble_advdata_t* p_srdata) {
+    const ble_advdata_manuf_data_t* p_manuf = p_advdata->p_manuf_specific_data;
+    if (p_srdata != NULL && p_srdata->p_manuf_specific_data != NULL) {
+        p_manuf = p_srdata->p_manuf_specific_data;
+    }
+
+    m_adv.manuf_len = 0;
+    if (p_manuf != NULL && p_manuf->data.size <= sizeof(m_adv.manuf_data)) {
+        memcpy(m_adv.manuf_data, p_manuf->data.p_data, p_manuf->data.size);
+        m_adv.manuf_len = p_manuf->data.size;
+    }
+}
+
+
+uint32_t ble_advertising_init(ble_advertising_t* const p_advertising, ble_advertising_init_t const* const p_init) {
+    UNUSED_PARAMETER(p_advertising);
+
+    m_adv.evt_handler = p_init->evt_handler;
+    m_adv.config      = p_init->config;
+    adv_manuf_data_store(&p_init->advdata, &p_init->srdata);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t ble_advertising_advdata_update(ble_advertising_t* const p_advertising,
+                                          ble_advdata_t const* const p_advdata,
+                                          ble_advdata_t const* const p_srdata) {
+    UNUSED_PARAMETER(p_advertising);
+
+    // The SoftDevice refuses advertising data on a directed advertising set
+    if (m_adv.mode == BLE_ADV_MODE_DIRECTED) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    adv_manuf_data_store(p_advdata, p_srdata);
+    return NRF_SUCCESS;
+}
+
+
+void ble_advertising_modes_config_set(ble_advertising_t* const p_advertising,
+                                      ble_adv_modes_config_t const* const p_adv_modes_config) {
+    UNUSED_PARAMETER(p_advertising);
+    m_adv.config = *p_adv_modes_config;
+}
+
+
+/**@brief Function for handling the end of the advertising duration, the next mode starts as in
+ *        the advertising module.
+ *
+ * @param[in] p_context  Unused.
+ * @param[in] arg        Advertising generation when the timeout was scheduled.
+ */
+static void adv_timeout(void* p_context, uint32_t arg) {
+    UNUSED_PARAMETER(p_context);
+
+    if (!m_adv.active || m_adv.generation != arg) {
+        return;
+    }
+
+    m_adv.active = false;
+    switch (m_adv.mode) {
+        case BLE_ADV_MODE_DIRECTED:
+            ble_advertising_start(NULL, BLE_ADV_MODE_FAST);
+            break;
+
+        case BLE_ADV_MODE_FAST:
+            ble_advertising_start(NULL, BLE_ADV_MODE_SLOW);
+            break;
+
+        default:
+            ble_advertising_start(NULL, BLE_ADV_MODE_IDLE);
+            break;
+    }
+}
+
+
+/**@brief Function for stopping simulated advertising without raising an event.
+ */
+static void adv_stop(void) {
+    m_adv.active      = false;
+    m_adv.generation += 1;
+}
+
+
+void ble_advertising_conn_cfg_tag_set(ble_advertising_t* const p_advertising, uint8_t ble_cfg_tag) {
+    UNUSED_PARAMETER(p_advertising);
+    UNUSED_PARAMETER(ble_cfg_tag);
+}
+
+
+uint32_t ble_advertising_start(ble_advertising_t* const p_advertising, ble_adv_mode_t advertising_mode) {
+    UNUSED_PARAMETER(p_advertising);
+
+    uint32_t      timeout = 0;
+    ble_adv_evt_t evt     = BLE_ADV_EVT_IDLE;
+
+    // Whitelist modes are not simulated, and the high and low duty directed modes run as one.
+    // A mode that is disabled, or directed without a peer address, falls to the next.
+    m_adv.mode          = BLE_ADV_MODE_IDLE;
+    m_adv.active        = false;
+    m_adv.generation   += 1;
+    m_adv.peer_addr_set = false;
+    if (advertising_mode != BLE_ADV_MODE_IDLE && advertising_mode <= BLE_ADV_MODE_DIRECTED &&
+        m_adv.config.ble_adv_directed_enabled && m_adv.evt_handler != NULL) {
+        ++m_evt_count;
+        m_adv.evt_handler(BLE_ADV_EVT_PEER_ADDR_REQUEST);
+    }
+
+    if (advertising_mode == BLE_ADV_MODE_IDLE) {
+        // Nothing left to advertise
+    }
+    else if (advertising_mode <= BLE_ADV_MODE_DIRECTED && m_adv.peer_addr_set) {
+        m_adv.mode     = BLE_ADV_MODE_DIRECTED;
+        m_adv.interval = m_adv.config.ble_adv_directed_interval;
+        timeout        = SIM_ADV_DIRECTED_HIGH_DUTY_DURATION + m_adv.config.ble_adv_directed_timeout;
+        evt            = BLE_ADV_EVT_DIRECTED;
+    }
+    else if (advertising_mode <= BLE_ADV_MODE_FAST && m_adv.config.ble_adv_fast_enabled) {
+        m_adv.mode     = BLE_ADV_MODE_FAST;
+        m_adv.interval = m_adv.config.ble_adv_fast_interval;
+        timeout        = m_adv.config.ble_adv_fast_timeout;
+        evt            = BLE_ADV_EVT_FAST;
+    }
+    else if (m_adv.config.ble_adv_slow_enabled) {
+        m_adv.mode     = BLE_ADV_MODE_SLOW;
+        m_adv.interval = m_adv.config.ble_adv_slow_interval;
+        timeout        = m_adv.config.ble_adv_slow_timeout;
+        evt            = BLE_ADV_EVT_SLOW;
+    }
+
+    if (m_adv.mode != BLE_ADV_MODE_IDLE) {
+        m_adv.active = true;
+        if (timeout != 0) {
+            sim_sched_add(sim_rtc_ticks() + sim_rtc_ms_to_ticks(10ull * timeout), adv_timeout, NULL, m_adv.generation);
+        }
+    }
+
+    if (m_adv.evt_handler != NULL) {
+        ++m_evt_count;
+        m_adv.evt_handler(evt);
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_adv_stop(uint8_t adv_handle) {
+    UNUSED_PARAMETER(adv_handle);
+
+    if (!m_adv.active) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    adv_stop();
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_advertising_restart_without_whitelist(ble_advertising_t* const p_advertising) {
+    // Advertising is never filtered in the simulation, the current mode starts over as in the SDK
+    return ble_advertising_start(p_advertising, m_adv.mode);
+}
+
+
+uint32_t ble_advertising_whitelist_reply(ble_advertising_t* const p_advertising,
+                                         ble_gap_addr_t const* p_gap_addrs,
+                                         uint32_t addr_cnt,
+                                         ble_gap_irk_t const* p_gap_irks,
+                                         uint32_t irk_cnt) {
+    UNUSED_PARAMETER(p_advertising);
+    UNUSED_PARAMETER(p_gap_addrs);
+    UNUSED_PARAMETER(addr_cnt);
+    UNUSED_PARAMETER(p_gap_irks);
+    UNUSED_PARAMETER(irk_cnt);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t ble_advertising_peer_addr_reply(ble_advertising_t* const p_advertising, ble_gap_addr_t* p_peer_addr) {
+    UNUSED_PARAMETER(p_advertising);
+    UNUSED_PARAMETER(p_peer_addr);
+
+    m_adv.peer_addr_set = true;
+    return NRF_SUCCESS;
+}
+
+
+void ble_advertising_on_ble_evt(ble_evt_t const* p_ble_evt, void* p_adv) {
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONNECTED:
+            adv_stop();
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            // The advertising module restarts advertising when a link goes down
+            ble_advertising_start((ble_advertising_t*)p_adv, BLE_ADV_MODE_DIRECTED_HIGH_DUTY);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void ble_advertising_on_sys_evt(uint32_t sys_evt, void* p_adv) {
+    UNUSED_PARAMETER(sys_evt);
+    UNUSED_PARAMETER(p_adv);
+}
+
+
+/*
+ * Peer manager
+ */
+
+ret_code_t pm_init(void) {
+    // The Peer Manager initializes flash data storage for the application too
+    return fds_init();
+}
+
+
+ret_code_t pm_sec_params_set(ble_gap_sec_params_t* p_sec_params) {
+    UNUSED_PARAMETER(p_sec_params);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_register(pm_evt_handler_t event_handler) {
+    UNUSED_PARAMETER(event_handler);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_peers_delete(void) {
+    return NRF_SUCCESS;
+}
+
+
+/*
+ * The simulated central never bonds, so there are no peers to list, rank or whitelist.
+ */
+
+ret_code_t pm_peer_id_list(pm_peer_id_t* p_peer_list,
+                           uint32_t* const p_list_size,
+                           pm_peer_id_t first_peer_id,
+                           pm_peer_id_list_skip_t skip_id) {
+    UNUSED_PARAMETER(p_peer_list);
+    UNUSED_PARAMETER(first_peer_id);
+    UNUSED_PARAMETER(skip_id);
+
+    *p_list_size = 0;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_peer_ranks_get(pm_peer_id_t* p_highest_ranked_peer,
+                             uint32_t* p_highest_rank,
+                             pm_peer_id_t* p_lowest_ranked_peer,
+                             uint32_t* p_lowest_rank) {
+    UNUSED_PARAMETER(p_highest_ranked_peer);
+    UNUSED_PARAMETER(p_highest_rank);
+    UNUSED_PARAMETER(p_lowest_ranked_peer);
+    UNUSED_PARAMETER(p_lowest_rank);
+    return NRF_ERROR_NOT_FOUND;
+}
+
+
+ret_code_t pm_peer_rank_highest(pm_peer_id_t peer_id) {
+    UNUSED_PARAMETER(peer_id);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_peer_data_bonding_load(pm_peer_id_t peer_id, pm_peer_data_bonding_t* p_data) {
+    UNUSED_PARAMETER(peer_id);
+    UNUSED_PARAMETER(p_data);
+    return NRF_ERROR_NOT_FOUND;
+}
+
+
+ret_code_t pm_whitelist_set(pm_peer_id_t const* p_peers, uint32_t peer_cnt) {
+    UNUSED_PARAMETER(p_peers);
+    UNUSED_PARAMETER(peer_cnt);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_whitelist_get(ble_gap_addr_t* p_addrs, uint32_t* p_addr_cnt, ble_gap_irk_t* p_irks, uint32_t* p_irk_cnt) {
+    UNUSED_PARAMETER(p_addrs);
+    UNUSED_PARAMETER(p_irks);
+
+    *p_addr_cnt = 0;
+    *p_irk_cnt  = 0;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t pm_device_identities_list_set(pm_peer_id_t const* p_peers, uint32_t peer_cnt) {
+    UNUSED_PARAMETER(p_peers);
+    UNUSED_PARAMETER(peer_cnt);
+    return NRF_SUCCESS;
+}
+
+
+void pm_handler_on_pm_evt(pm_evt_t const* p_pm_evt) {
+    UNUSED_PARAMETER(p_pm_evt);
+}
+
+
+void pm_handler_flash_clean(pm_evt_t const* p_pm_evt) {
+    UNUSED_PARAMETER(p_pm_evt);
+}
+
+
+void pm_local_database_has_changed(void) {
+}
+
+
+/*
+ * Flash data storage, kept in RAM. Operations complete before they return and raise no events
+ * other than FDS_EVT_INIT, nothing in the simulation waits for them.
+ */
+
+ret_code_t fds_register(fds_cb_t cb) {
+    if (m_fds_user_count == SIM_FDS_MAX_USERS) {
+        return FDS_ERR_USER_LIMIT_REACHED;
+    }
+    m_fds_users[m_fds_user_count++] = cb;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t fds_init(void) {
+    const fds_evt_t evt = {
+        .id     = FDS_EVT_INIT,
+        .result = NRF_SUCCESS
+    };
+
+    for (unsigned int i = 0; i < m_fds_user_count; ++i) {
+        m_fds_users[i](&evt);
+    }
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t fds_gc(void) {
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for finding a record by its ID. */
+static sim_fds_record_t* fds_record_get(const fds_record_desc_t* p_desc) {
+    for (unsigned int i = 0; i < SIM_FDS_MAX_RECORDS; ++i) {
+        if (m_fds_records[i].valid && m_fds_records[i].header.record_id == p_desc->record_id) {
+            return &m_fds_records[i];
+        }
+    }
+    return NULL;
+}
+
+
+ret_code_t fds_record_find(uint16_t file_id, uint16_t record_key, fds_record_desc_t* p_desc, fds_find_token_t* p_token) {
+    // The token holds the index to continue the search from
+    for (uint32_t i = p_token->page; i < SIM_FDS_MAX_RECORDS; ++i) {
+        const sim_fds_record_t* p_record = &m_fds_records[i];
+        if (p_record->valid && p_record->header.file_id == file_id && p_record->header.record_key == record_key) {
+            memset(p_desc, 0, sizeof(*p_desc));
+            p_desc->record_id = p_record->header.record_id;
+            p_token->page     = i + 1;
+            return NRF_SUCCESS;
+        }
+    }
+    return FDS_ERR_NOT_FOUND;
+}
+
+
+ret_code_t fds_record_find_in_file(uint16_t file_id, fds_record_desc_t* p_desc, fds_find_token_t* p_token) {
+    for (uint32_t i = p_token->page; i < SIM_FDS_MAX_RECORDS; ++i) {
+        const sim_fds_record_t* p_record = &m_fds_records[i];
+        if (p_record->valid && p_record->header.file_id == file_id) {
+            memset(p_desc, 0, sizeof(*p_desc));
+            p_desc->record_id = p_record->header.record_id;
+            p_token->page     = i + 1;
+            return NRF_SUCCESS;
+        }
+    }
+    return FDS_ERR_NOT_FOUND;
+}
+
+
+ret_code_t fds_record_open(fds_record_desc_t* p_desc, fds_flash_record_t* p_flash_record) {
+    const sim_fds_record_t* p_record = fds_record_get(p_desc);
+    if (p_record == NULL) {
+        return FDS_ERR_NOT_FOUND;
+    }
+
+    p_flash_record->p_header = &p_record->header;
+    p_flash_record->p_data   = p_record->data;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t fds_record_close(fds_record_desc_t* p_desc) {
+    UNUSED_PARAMETER(p_desc);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t fds_record_write(fds_record_desc_t* p_desc, fds_record_t const* p_record) {
+    if (p_record->data.length_words > SIM_FDS_MAX_WORDS) {
+        return FDS_ERR_RECORD_TOO_LARGE;
+    }
+
+    for (unsigned int i = 0; i < SIM_FDS_MAX_RECORDS; ++i) {
+        sim_fds_record_t* p_slot = &m_fds_records[i];
+        if (p_slot->valid) {
+            continue;
+        }
+
+        memset(p_slot, 0, sizeof(*p_slot));
+        p_slot->header.file_id      = p_record->file_id;
+        p_slot->header.record_key   = p_record->key;
+        p_slot->header.length_words = p_record->data.length_words;
+        p_slot->header.record_id    = ++m_fds_record_id;
+        memcpy(p_slot->data, p_record->data.p_data, p_record->data.length_words * sizeof(uint32_t));
+        p_slot->valid = true;
+
+        if (p_desc != NULL) {
+            memset(p_desc, 0, sizeof(*p_desc));
+            p_desc->record_id = p_slot->header.record_id;
+        }
+        return NRF_SUCCESS;
+    }
+    return FDS_ERR_NO_SPACE_IN_FLASH;
+}
+
+
+ret_code_t fds_record_update(fds_record_desc_t* p_desc, fds_record_t const* p_record) {
+    sim_fds_record_t* p_old = fds_record_get(p_desc);
+    if (p_old != NULL) {
+        p_old->valid = false;
+    }
+    return fds_record_write(p_desc, p_record);
+}
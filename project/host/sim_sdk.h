@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bsp.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Board LED change handler type.
+ *
+ * @param[in] led_idx  Board LED index.
+ * @param[in] on       New LED state.
+ */
+typedef void (*sim_led_handler_t)(uint32_t led_idx, bool on);
+
+
+/**@brief Function for checking if the firmware requested system-off. */
+bool sim_system_off_requested(void);
+
+
+/**@brief Function for getting the time a board LED last changed state.
+ *
+ * @param[in] led_idx  Board LED index.
+ *
+ * @return Time in nanoseconds, see @ref sim_now_ns.
+ */
+uint64_t sim_board_led_changed_ns(uint32_t led_idx);
+
+
+/**@brief Function for setting a handler called on every board LED change.
+ *
+ * @param[in] handler  LED change handler, or NULL.
+ */
+void sim_led_handler_set(sim_led_handler_t handler);
+
+
+/**@brief Function for running virtual time until all active single shot timers have fired. */
+void sim_app_timers_fire(void);
+
+
+/**@brief Function for sending a BSP event to the handler given to bsp_init.
+ *
+ * @param[in] event  BSP event.
+ */
+void sim_bsp_evt_send(bsp_event_t event);
+
+
+/**@brief Function for waking the chip from system-off, as a button press does. */
+void sim_system_wake(void);
+
+
+/**@brief Function for checking if the lock is advertising, i.e. can accept a connection. */
+bool sim_adv_is_active(void);
+
+
+/**@brief Function for getting the interval of the current advertising mode, in ms. */
+double sim_adv_interval_ms(void);
+
+
+/**@brief Function for getting the manufacturer specific scan response data, as a scanning
+ *        phone sees it.
+ *
+ * @param[out] pp_data  Payload after the company identifier.
+ *
+ * @return Payload length, 0 if there is none.
+ */
+uint16_t sim_adv_manuf_data_get(const uint8_t** pp_data);
+
+
+/**@brief Function for getting the number of timer, button and advertising events raised. */
+uint32_t sim_sdk_evt_count(void);
+
+
+/**@brief Function for saving everything the firmware writes to an RTT up channel to a file.
+ *
+ * @param[in] channel  RTT up channel.
+ * @param[in] p_path   Output file.
+ *
+ * @return True on success.
+ */
+bool sim_rtt_capture_open(unsigned channel, const char* p_path);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,882 @@
+#include "sim_softdevice.h"
+#include "sim_sdk.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "nordic_common.h"
+#include "app_util.h"
+#include "nrf_error.h"
+#include "nrf_soc.h"
+#include "ble.h"
+#include "ble_gap.h"
+#include "ble_gatts.h"
+#include "ble_hci.h"
+#include "ble_srv_common.h"
+
+
+// Observer section, filled in by NRF_SDH_BLE_OBSERVER (see include/nrf_sdh_ble.h)
+extern sim_ble_observer_t __start_sim_ble_observers[];
+extern sim_ble_observer_t __stop_sim_ble_observers[];
+
+
+/**@brief Simulated GATT attribute. */
+typedef struct {
+    ble_uuid_t uuid;                      /**< Attribute UUID. */
+    uint16_t   handle;                    /**< Attribute handle. */
+    uint16_t   value_handle;              /**< Owning characteristic value handle, for CCCDs. */
+    bool       is_cccd;                   /**< True if this is a CCCD. */
+    uint16_t   len;                       /**< Current value length. */
+    uint16_t   max_len;                   /**< Maximum value length. */
+    bool       wr_auth;                   /**< Writes need authorization by the application. */
+    bool       writable;                  /**< The central may write the value, per properties and permission. */
+    uint8_t*   p_value;                   /**< Attribute value, value_buf or application memory for BLE_GATTS_VLOC_USER. */
+    uint8_t    value_buf[SIM_ATTR_MAX_LEN]; /**< Attribute value kept by the SoftDevice. */
+} sim_attr_t;
+
+
+static sim_ble_observer_t* m_observers[SIM_MAX_OBSERVERS];   /**< Observers sorted by priority. */
+static unsigned int        m_observer_count;
+
+static sim_handler_stats_t m_stats[SIM_MAX_OBSERVERS * 8];   /**< Handler cost statistics. */
+static unsigned int        m_stats_count;
+
+static sim_attr_t          m_attrs[SIM_MAX_ATTRS];           /**< Simulated attribute table. */
+static unsigned int        m_attr_count;
+static uint8_t             m_vs_uuid_count;
+static uint32_t            m_hvx_count;
+
+static uint16_t            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static bool                m_disconnect_pending;
+static uint8_t             m_phy = BLE_GAP_PHY_1MBPS;        /**< PHY of the current link. */
+static bool                m_rssi_started;                   /**< RSSI change reporting requested for the current link. */
+static bool                m_scanning;                       /**< Scanner started and not stopped. */
+static bool                m_scan_paused;                    /**< Report buffer not handed back since the last report. */
+static ble_data_t          m_scan_data;                      /**< Report buffer given to sd_ble_gap_scan_start. */
+static ble_gap_scan_params_t m_scan_params;                  /**< Scan parameters. */
+static bool                m_replay;                         /**< Replaying a trace, discard events raised here. */
+static bool                m_sys_attr_set;                   /**< The peer wrote a CCCD on this link, so its system attributes exist. */
+static uint16_t            m_auth_handle;                    /**< Attribute of the pending write authorization request, or invalid. */
+static uint16_t            m_auth_len;                       /**< Length of the pending write. */
+static bool                m_auth_queued;                    /**< The pending write is a queued write, applied on a successful reply. */
+static bool                m_auth_applied;                   /**< The application accepted the last queued write. */
+static uint8_t             m_auth_data[SIM_ATTR_MAX_LEN];    /**< Data of the pending queued write. */
+
+static uint32_t            m_evt_queue[SIM_EVT_QUEUE_SIZE][(SIM_EVT_BUF_SIZE + 3) / 4];
+static unsigned int        m_evt_queue_head;
+static unsigned int        m_evt_queue_count;
+static unsigned int        m_evt_queue_peak;
+static uint32_t            m_evt_count;
+
+
+uint64_t sim_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+
+/**@brief Function for collecting the registered observers in priority order.
+ */
+static void observers_collect(void) {
+    if (m_observer_count != 0) {
+        return;
+    }
+
+    for (sim_ble_observer_t* p_obs = __start_sim_ble_observers; p_obs < __stop_sim_ble_observers; ++p_obs) {
+        if (m_observer_count == SIM_MAX_OBSERVERS) {
+            break;
+        }
+
+        // Insertion sort, keeping registration order within a priority level
+        unsigned int i = m_observer_count++;
+        while (i > 0 && m_observers[i - 1]->prio > p_obs->prio) {
+            m_observers[i] = m_observers[i - 1];
+            --i;
+        }
+        m_observers[i] = p_obs;
+    }
+}
+
+
+/**@brief Function for getting a printable name for a BLE event ID.
+ */
+static const char* evt_name(uint16_t evt_id) {
+    switch (evt_id) {
+        case BLE_GAP_EVT_CONNECTED:         return "GAP_CONNECTED";
+        case BLE_GAP_EVT_DISCONNECTED:      return "GAP_DISCONNECTED";
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE: return "GAP_CONN_PARAM_UPDATE";
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:   return "GAP_CONN_SEC_UPDATE";
+        case BLE_GAP_EVT_PHY_UPDATE:        return "GAP_PHY_UPDATE";
+        case BLE_GATTS_EVT_WRITE:           return "GATTS_WRITE";
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE: return "GATTS_HVN_TX_COMPLETE";
+        default:                            return "OTHER";
+    }
+}
+
+
+/**@brief Function for accounting one handler call.
+ */
+static void stats_add(const char* p_observer, uint16_t evt_id, uint64_t elapsed_ns) {
+    sim_handler_stats_t* p_stats = NULL;
+
+    for (unsigned int i = 0; i < m_stats_count; ++i) {
+        if (m_stats[i].p_observer == p_observer && m_stats[i].evt_id == evt_id) {
+            p_stats = &m_stats[i];
+            break;
+        }
+    }
+
+    if (p_stats == NULL) {
+        if (m_stats_count == sizeof(m_stats) / sizeof(m_stats[0])) {
+            return;
+        }
+        p_stats = &m_stats[m_stats_count++];
+        p_stats->p_observer = p_observer;
+        p_stats->evt_id     = evt_id;
+        p_stats->min_ns     = UINT64_MAX;
+    }
+
+    p_stats->count    += 1;
+    p_stats->total_ns += elapsed_ns;
+    if (elapsed_ns < p_stats->min_ns) {
+        p_stats->min_ns = elapsed_ns;
+    }
+    if (elapsed_ns > p_stats->max_ns) {
+        p_stats->max_ns = elapsed_ns;
+    }
+}
+
+
+void sim_ble_evt_dispatch(const ble_evt_t* p_ble_evt) {
+    observers_collect();
+    ++m_evt_count;
+
+    for (unsigned int i = 0; i < m_observer_count; ++i) {
+        const sim_ble_observer_t* p_obs = m_observers[i];
+
+        const uint64_t start = sim_now_ns();
+        p_obs->handler(p_ble_evt, p_obs->p_context);
+        stats_add(p_obs->p_name, p_ble_evt->header.evt_id, sim_now_ns() - start);
+    }
+}
+
+
+/**@brief Function for reserving a slot in the pending event queue.
+ *
+ * @return Zeroed event buffer, or NULL if the queue is full.
+ */
+static ble_evt_t* evt_queue_alloc(uint16_t evt_id, uint16_t evt_len) {
+    static uint32_t discard_buf[(SIM_EVT_BUF_SIZE + 3) / 4];
+
+    // A replayed trace already holds every event the SoftDevice raised
+    if (m_replay) {
+        memset(discard_buf, 0, sizeof(discard_buf));
+        return (ble_evt_t*)discard_buf;
+    }
+
+    if (m_evt_queue_count == SIM_EVT_QUEUE_SIZE) {
+        return NULL;
+    }
+
+    const unsigned int idx = (m_evt_queue_head + m_evt_queue_count++) % SIM_EVT_QUEUE_SIZE;
+    if (m_evt_queue_count > m_evt_queue_peak) {
+        m_evt_queue_peak = m_evt_queue_count;
+    }
+    ble_evt_t* p_evt = (ble_evt_t*)m_evt_queue[idx];
+
+    memset(p_evt, 0, sizeof(m_evt_queue[idx]));
+    p_evt->header.evt_id  = evt_id;
+    p_evt->header.evt_len = SIM_EVT_LEN(evt_len);
+    return p_evt;
+}
+
+
+unsigned int sim_ble_evt_pump(void) {
+    unsigned int count = 0;
+
+    while (m_evt_queue_count > 0) {
+        static uint32_t evt_buf[(SIM_EVT_BUF_SIZE + 3) / 4];
+
+        // Copy out first, handlers may queue new events
+        memcpy(evt_buf, m_evt_queue[m_evt_queue_head], sizeof(evt_buf));
+        m_evt_queue_head   = (m_evt_queue_head + 1) % SIM_EVT_QUEUE_SIZE;
+        m_evt_queue_count -= 1;
+
+        const ble_evt_t* p_evt = (const ble_evt_t*)evt_buf;
+        if (p_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED) {
+            m_conn_handle        = BLE_CONN_HANDLE_INVALID;
+            m_disconnect_pending = false;
+        }
+
+        sim_ble_evt_dispatch(p_evt);
+        ++count;
+    }
+
+    return count;
+}
+
+
+/**@brief Function for finding an attribute by handle.
+ */
+static sim_attr_t* attr_find(uint16_t handle) {
+    for (unsigned int i = 0; i < m_attr_count; ++i) {
+        if (m_attrs[i].handle == handle) {
+            return &m_attrs[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for adding an attribute to the simulated table.
+ */
+static sim_attr_t* attr_add(const ble_uuid_t* p_uuid) {
+    if (m_attr_count == SIM_MAX_ATTRS) {
+        return NULL;
+    }
+
+    sim_attr_t* p_attr = &m_attrs[m_attr_count++];
+    memset(p_attr, 0, sizeof(*p_attr));
+    p_attr->handle  = (uint16_t)m_attr_count;
+    p_attr->p_value = p_attr->value_buf;
+    if (p_uuid != NULL) {
+        p_attr->uuid = *p_uuid;
+    }
+    return p_attr;
+}
+
+
+/**@brief Function for queueing the disconnect event of the current link, once.
+ */
+static void disconnected_evt_queue(uint8_t reason) {
+    if (m_disconnect_pending) {
+        return;
+    }
+
+    ble_evt_t* p_evt = evt_queue_alloc(BLE_GAP_EVT_DISCONNECTED, sizeof(ble_gap_evt_t));
+    if (p_evt != NULL) {
+        p_evt->evt.gap_evt.conn_handle                = m_conn_handle;
+        p_evt->evt.gap_evt.params.disconnected.reason = reason;
+        m_disconnect_pending = true;
+    }
+}
+
+
+bool sim_gap_connect(const ble_gap_addr_t* p_peer_addr) {
+    static uint32_t evt_buf[(SIM_EVT_BUF_SIZE + 3) / 4];
+    ble_evt_t* p_evt = (ble_evt_t*)evt_buf;
+
+    // A single peripheral link, only available while advertising
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID || !sim_adv_is_active()) {
+        return false;
+    }
+
+    memset(evt_buf, 0, sizeof(evt_buf));
+    p_evt->header.evt_id  = BLE_GAP_EVT_CONNECTED;
+    p_evt->header.evt_len = SIM_EVT_LEN(sizeof(ble_gap_evt_t));
+    p_evt->evt.gap_evt.conn_handle                = SIM_CONN_HANDLE;
+    p_evt->evt.gap_evt.params.connected.peer_addr = *p_peer_addr;
+    p_evt->evt.gap_evt.params.connected.role      = BLE_GAP_ROLE_PERIPH;
+
+    // A phone's usual choice, until the firmware asks for something else
+    p_evt->evt.gap_evt.params.connected.conn_params.min_conn_interval = MSEC_TO_UNITS(30, UNIT_1_25_MS);
+    p_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval = MSEC_TO_UNITS(30, UNIT_1_25_MS);
+    p_evt->evt.gap_evt.params.connected.conn_params.conn_sup_timeout  = MSEC_TO_UNITS(4000, UNIT_10_MS);
+
+    // CCCDs are per connection and start out disabled. The simulated phones never bond, so the
+    // system attributes are missing until the first CCCD write
+    for (unsigned int i = 0; i < m_attr_count; ++i) {
+        if (m_attrs[i].is_cccd) {
+            memset(m_attrs[i].p_value, 0, m_attrs[i].len);
+        }
+    }
+
+    m_sys_attr_set = false;
+    m_conn_handle  = SIM_CONN_HANDLE;
+    m_phy          = BLE_GAP_PHY_1MBPS;
+    m_rssi_started = false;
+    sim_ble_evt_dispatch(p_evt);
+    return true;
+}
+
+
+void sim_gap_disconnect(uint8_t reason) {
+    if (m_conn_handle != BLE_CONN_HANDLE_INVALID) {
+        disconnected_evt_queue(reason);
+    }
+    sim_ble_evt_pump();
+}
+
+
+bool sim_gap_is_connected(void) {
+    return m_conn_handle != BLE_CONN_HANDLE_INVALID;
+}
+
+
+void sim_gap_rssi_set(int8_t rssi) {
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID || !m_rssi_started) {
+        return;
+    }
+
+    ble_evt_t* p_evt = evt_queue_alloc(BLE_GAP_EVT_RSSI_CHANGED, sizeof(ble_gap_evt_t));
+    if (p_evt != NULL) {
+        p_evt->evt.gap_evt.conn_handle              = m_conn_handle;
+        p_evt->evt.gap_evt.params.rssi_changed.rssi = rssi;
+    }
+    sim_ble_evt_pump();
+}
+
+
+uint8_t sim_gap_phy_get(void) {
+    return m_phy;
+}
+
+
+bool sim_gap_adv_report(const ble_gap_addr_t* p_peer_addr, int8_t rssi, const uint8_t* p_data, uint16_t len) {
+    if (!m_scanning || m_scan_paused || len > m_scan_data.len) {
+        return false;
+    }
+
+    ble_evt_t* p_evt = evt_queue_alloc(BLE_GAP_EVT_ADV_REPORT, sizeof(ble_gap_evt_t));
+    if (p_evt == NULL) {
+        return false;
+    }
+
+    // The SoftDevice writes the payload into the buffer it was given and pauses until it is back
+    memcpy(m_scan_data.p_data, p_data, len);
+    m_scan_paused = true;
+
+    ble_gap_evt_adv_report_t* p_report = &p_evt->evt.gap_evt.params.adv_report;
+    p_evt->evt.gap_evt.conn_handle = BLE_CONN_HANDLE_INVALID;
+    p_report->type.connectable     = 1;
+    p_report->type.scannable       = 1;
+    p_report->type.status          = BLE_GAP_ADV_DATA_STATUS_COMPLETE;
+    p_report->peer_addr            = *p_peer_addr;
+    p_report->primary_phy          = BLE_GAP_PHY_1MBPS;
+    p_report->rssi                 = rssi;
+    p_report->data.p_data          = m_scan_data.p_data;
+    p_report->data.len             = len;
+
+    sim_ble_evt_pump();
+    return true;
+}
+
+
+bool sim_gap_scan_get(double* p_interval_ms, double* p_window_ms) {
+    *p_interval_ms = m_scan_params.interval * 0.625;
+    *p_window_ms   = m_scan_params.window * 0.625;
+    return m_scanning;
+}
+
+
+/**@brief Function for dispatching a write authorization request for a pending write.
+ *
+ * @param[in] op      BLE_GATTS_OP_WRITE_REQ or BLE_GATTS_OP_EXEC_WRITE_REQ_NOW.
+ * @param[in] p_data  Data of a Write Request, NULL for an Execute Write Request.
+ * @param[in] len     Length of the data.
+ */
+static void write_authorize_request_dispatch(uint8_t op, const uint8_t* p_data, uint16_t len) {
+    static uint32_t evt_buf[(SIM_EVT_BUF_SIZE + 3) / 4];
+    ble_evt_t* p_evt = (ble_evt_t*)evt_buf;
+
+    memset(evt_buf, 0, sizeof(evt_buf));
+    p_evt->header.evt_id  = BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST;
+    p_evt->header.evt_len = SIM_EVT_LEN(sizeof(ble_gatts_evt_t) + len);
+    p_evt->evt.gatts_evt.conn_handle                           = m_conn_handle;
+    p_evt->evt.gatts_evt.params.authorize_request.type         = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    p_evt->evt.gatts_evt.params.authorize_request.request.write.op     = op;
+    p_evt->evt.gatts_evt.params.authorize_request.request.write.handle = (op == BLE_GATTS_OP_WRITE_REQ) ? m_auth_handle : 0;
+    p_evt->evt.gatts_evt.params.authorize_request.request.write.len    = len;
+    if (p_data != NULL) {
+        memcpy(p_evt->evt.gatts_evt.params.authorize_request.request.write.data, p_data, len);
+    }
+
+    sim_ble_evt_dispatch(p_evt);
+
+    // Not answered, the SoftDevice would time the request out
+    m_auth_handle = BLE_GATT_HANDLE_INVALID;
+}
+
+
+void sim_gatts_write(uint16_t handle, const uint8_t* p_data, uint16_t len) {
+    static uint32_t evt_buf[(SIM_EVT_BUF_SIZE + 3) / 4];
+    ble_evt_t* p_evt = (ble_evt_t*)evt_buf;
+
+    sim_attr_t* p_attr = attr_find(handle);
+    if (p_attr == NULL || !p_attr->writable || len > p_attr->max_len) {
+        return;
+    }
+
+    // Written by the reply, if the application accepts it
+    if (p_attr->wr_auth) {
+        m_auth_handle = handle;
+        m_auth_queued = false;
+        write_authorize_request_dispatch(BLE_GATTS_OP_WRITE_REQ, p_data, len);
+        return;
+    }
+
+    memcpy(p_attr->p_value, p_data, len);
+    p_attr->len = len;
+    if (p_attr->is_cccd) {
+        m_sys_attr_set = true;
+    }
+
+    memset(evt_buf, 0, sizeof(evt_buf));
+    p_evt->header.evt_id  = BLE_GATTS_EVT_WRITE;
+    p_evt->header.evt_len = SIM_EVT_LEN(sizeof(ble_gatts_evt_t) + len);
+    p_evt->evt.gatts_evt.conn_handle         = m_conn_handle;
+    p_evt->evt.gatts_evt.params.write.handle = handle;
+    p_evt->evt.gatts_evt.params.write.uuid   = p_attr->uuid;
+    p_evt->evt.gatts_evt.params.write.op     = BLE_GATTS_OP_WRITE_REQ;
+    p_evt->evt.gatts_evt.params.write.offset = 0;
+    p_evt->evt.gatts_evt.params.write.len    = len;
+    memcpy(p_evt->evt.gatts_evt.params.write.data, p_data, len);
+
+    sim_ble_evt_dispatch(p_evt);
+}
+
+
+bool sim_gatts_long_write(uint16_t handle, const uint8_t* p_data, uint16_t len) {
+    const sim_attr_t* p_attr = attr_find(handle);
+    if (p_attr == NULL || !p_attr->wr_auth || len > p_attr->max_len) {
+        return false;
+    }
+
+    // The Prepare Write Requests are queued in the application's memory without events, the
+    // Execute Write Request asks for authorization
+    m_auth_handle  = handle;
+    m_auth_len     = len;
+    m_auth_queued  = true;
+    m_auth_applied = false;
+    memcpy(m_auth_data, p_data, len);
+
+    write_authorize_request_dispatch(BLE_GATTS_OP_EXEC_WRITE_REQ_NOW, NULL, 0);
+    return m_auth_applied;
+}
+
+
+uint16_t sim_gatts_value_handle_find(const ble_uuid_t* p_uuid) {
+    for (unsigned int i = 0; i < m_attr_count; ++i) {
+        if (!m_attrs[i].is_cccd && m_attrs[i].uuid.type == p_uuid->type && m_attrs[i].uuid.uuid == p_uuid->uuid) {
+            return m_attrs[i].handle;
+        }
+    }
+    return BLE_GATT_HANDLE_INVALID;
+}
+
+
+uint16_t sim_gatts_cccd_handle_find(uint16_t value_handle) {
+    for (unsigned int i = 0; i < m_attr_count; ++i) {
+        if (m_attrs[i].is_cccd && m_attrs[i].value_handle == value_handle) {
+            return m_attrs[i].handle;
+        }
+    }
+    return BLE_GATT_HANDLE_INVALID;
+}
+
+
+uint32_t sim_ble_evt_count(void) {
+    return m_evt_count;
+}
+
+
+unsigned int sim_ble_evt_queue_peak(void) {
+    return m_evt_queue_peak;
+}
+
+
+uint32_t sim_gatts_hvx_count(void) {
+    return m_hvx_count;
+}
+
+
+const sim_handler_stats_t* sim_handler_stats_get(unsigned int* p_count) {
+    *p_count = m_stats_count;
+    return m_stats;
+}
+
+
+void sim_handler_stats_reset(void) {
+    m_stats_count = 0;
+}
+
+
+void sim_handler_stats_print(void) {
+    printf("%-24s %-22s %10s %10s %10s %10s\n", "observer", "event", "calls", "mean ns", "min ns", "max ns");
+    for (unsigned int i = 0; i < m_stats_count; ++i) {
+        printf("%-24s %-22s %10u %10llu %10llu %10llu\n",
+               m_stats[i].p_observer,
+               evt_name(m_stats[i].evt_id),
+               (unsigned int)m_stats[i].count,
+               (unsigned long long)(m_stats[i].total_ns / m_stats[i].count),
+               (unsigned long long)m_stats[i].min_ns,
+               (unsigned long long)m_stats[i].max_ns);
+    }
+}
+
+
+void sim_ble_evt_replay(const ble_evt_t* p_ble_evt) {
+    m_replay = true;
+
+    // Keep the connection and CCCD state the SoftDevice calls made by the handlers depend on
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONNECTED:
+            for (unsigned int i = 0; i < m_attr_count; ++i) {
+                if (m_attrs[i].is_cccd) {
+                    memset(m_attrs[i].p_value, 0, m_attrs[i].len);
+                }
+            }
+            // A trace does not tell whether the peer manager restored them, assume it did
+            m_sys_attr_set = true;
+            m_conn_handle  = p_ble_evt->evt.gap_evt.conn_handle;
+            break;
+
+        case BLE_GATTS_EVT_WRITE: {
+            const ble_gatts_evt_write_t* p_write = &p_ble_evt->evt.gatts_evt.params.write;
+            sim_attr_t* p_attr = attr_find(p_write->handle);
+            if (p_attr != NULL && p_write->offset + p_write->len <= p_attr->max_len) {
+                memcpy(&p_attr->p_value[p_write->offset], p_write->data, p_write->len);
+                p_attr->len = p_write->offset + p_write->len;
+            }
+        } break;
+
+        default:
+            break;
+    }
+
+    sim_ble_evt_dispatch(p_ble_evt);
+
+    if (p_ble_evt->header.evt_id == BLE_GAP_EVT_DISCONNECTED) {
+        m_conn_handle        = BLE_CONN_HANDLE_INVALID;
+        m_disconnect_pending = false;
+    }
+}
+
+
+/*
+ * SoftDevice API stand-ins
+ */
+
+uint32_t sd_ble_uuid_vs_add(ble_uuid128_t const* p_vs_uuid, uint8_t* p_uuid_type) {
+    if (p_vs_uuid == NULL || p_uuid_type == NULL) {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+    *p_uuid_type = BLE_UUID_TYPE_VENDOR_BEGIN + m_vs_uuid_count++;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_service_add(uint8_t type, ble_uuid_t const* p_uuid, uint16_t* p_handle) {
+    UNUSED_PARAMETER(type);
+
+    sim_attr_t* p_attr = attr_add(p_uuid);
+    if (p_attr == NULL) {
+        return NRF_ERROR_NO_MEM;
+    }
+    *p_handle = p_attr->handle;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_characteristic_add(uint16_t service_handle,
+                                         ble_gatts_char_md_t const* p_char_md,
+                                         ble_gatts_attr_t const* p_attr_char_value,
+                                         ble_gatts_char_handles_t* p_handles) {
+    UNUSED_PARAMETER(service_handle);
+
+    if (p_attr_char_value->max_len > SIM_ATTR_MAX_LEN) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // Declaration and value
+    sim_attr_t* p_decl  = attr_add(NULL);
+    sim_attr_t* p_value = attr_add(p_attr_char_value->p_uuid);
+    if (p_decl == NULL || p_value == NULL) {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    p_value->max_len = p_attr_char_value->max_len;
+    p_value->len     = p_attr_char_value->init_len;
+    p_value->wr_auth = p_attr_char_value->p_attr_md->wr_auth;
+    p_value->writable = (p_char_md->char_props.write || p_char_md->char_props.write_wo_resp) &&
+                        p_attr_char_value->p_attr_md->write_perm.sm != 0;
+    if (p_attr_char_value->p_attr_md->vloc == BLE_GATTS_VLOC_USER) {
+        p_value->p_value = p_attr_char_value->p_value;
+    }
+    else if (p_attr_char_value->p_value != NULL) {
+        memcpy(p_value->p_value, p_attr_char_value->p_value, p_attr_char_value->init_len);
+    }
+
+    memset(p_handles, 0, sizeof(*p_handles));
+    p_handles->value_handle = p_value->handle;
+
+    // Client Characteristic Configuration Descriptor
+    if (p_char_md->char_props.notify || p_char_md->char_props.indicate) {
+        sim_attr_t* p_cccd = attr_add(NULL);
+        if (p_cccd == NULL) {
+            return NRF_ERROR_NO_MEM;
+        }
+        p_cccd->uuid.type    = BLE_UUID_TYPE_BLE;
+        p_cccd->uuid.uuid    = BLE_UUID_DESCRIPTOR_CLIENT_CHAR_CONFIG;
+        p_cccd->is_cccd      = true;
+        p_cccd->writable     = true;
+        p_cccd->value_handle = p_value->handle;
+        p_cccd->max_len      = BLE_CCCD_VALUE_LEN;
+        p_cccd->len          = BLE_CCCD_VALUE_LEN;
+        p_handles->cccd_handle = p_cccd->handle;
+    }
+
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_set(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t* p_value) {
+    UNUSED_PARAMETER(conn_handle);
+
+    sim_attr_t* p_attr = attr_find(handle);
+    if (p_attr == NULL) {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if (p_value->offset + p_value->len > p_attr->max_len) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    memcpy(&p_attr->p_value[p_value->offset], p_value->p_value, p_value->len);
+    p_attr->len = p_value->offset + p_value->len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_value_get(uint16_t conn_handle, uint16_t handle, ble_gatts_value_t* p_value) {
+    UNUSED_PARAMETER(conn_handle);
+
+    sim_attr_t* p_attr = attr_find(handle);
+    if (p_attr == NULL) {
+        return BLE_ERROR_INVALID_ATTR_HANDLE;
+    }
+    if (p_value->offset > p_attr->len) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    uint16_t len = p_attr->len - p_value->offset;
+    if (p_value->p_value != NULL) {
+        if (len > p_value->len) {
+            len = p_value->len;
+        }
+        memcpy(p_value->p_value, &p_attr->p_value[p_value->offset], len);
+    }
+    p_value->len = len;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_attr_get(uint16_t handle, ble_uuid_t* p_uuid, ble_gatts_attr_md_t* p_md) {
+    const sim_attr_t* p_attr = attr_find(handle);
+    if (p_attr == NULL) {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    // Permissions are not simulated
+    if (p_uuid != NULL) {
+        *p_uuid = p_attr->uuid;
+    }
+    if (p_md != NULL) {
+        memset(p_md, 0, sizeof(*p_md));
+    }
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_rw_authorize_reply(uint16_t conn_handle, ble_gatts_rw_authorize_reply_params_t const* p_rw_authorize_reply_params) {
+    if (conn_handle == BLE_CONN_HANDLE_INVALID || conn_handle != m_conn_handle) {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+
+    // Nothing pending when replaying a trace
+    sim_attr_t* p_attr = attr_find(m_auth_handle);
+    if (p_attr == NULL || p_rw_authorize_reply_params->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE) {
+        return NRF_SUCCESS;
+    }
+
+    const ble_gatts_authorize_params_t* p_write = &p_rw_authorize_reply_params->params.write;
+    if (p_write->gatt_status == BLE_GATT_STATUS_SUCCESS) {
+        if (m_auth_queued) {
+            memcpy(p_attr->p_value, m_auth_data, m_auth_len);
+            p_attr->len    = m_auth_len;
+            m_auth_applied = true;
+        }
+        else if (p_write->update && p_write->offset + p_write->len <= p_attr->max_len) {
+            memcpy(&p_attr->p_value[p_write->offset], p_write->p_data, p_write->len);
+            p_attr->len = p_write->offset + p_write->len;
+        }
+    }
+
+    m_auth_handle = BLE_GATT_HANDLE_INVALID;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gatts_hvx(uint16_t conn_handle, ble_gatts_hvx_params_t const* p_hvx_params) {
+    if (conn_handle == BLE_CONN_HANDLE_INVALID || conn_handle != m_conn_handle) {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+
+    if (!m_sys_attr_set) {
+        return BLE_ERROR_GATTS_SYS_ATTR_MISSING;
+    }
+
+    const uint16_t cccd_handle = sim_gatts_cccd_handle_find(p_hvx_params->handle);
+    const sim_attr_t* p_cccd = attr_find(cccd_handle);
+    const uint16_t mask = (p_hvx_params->type == BLE_GATT_HVX_NOTIFICATION) ? BLE_GATT_HVX_NOTIFICATION
+                                                                            : BLE_GATT_HVX_INDICATION;
+    if (p_cccd == NULL || (uint16_decode(p_cccd->p_value) & mask) == 0) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    if (p_hvx_params->p_data != NULL && p_hvx_params->p_len != NULL) {
+        sim_attr_t* p_attr = attr_find(p_hvx_params->handle);
+        memcpy(&p_attr->p_value[p_hvx_params->offset], p_hvx_params->p_data, *p_hvx_params->p_len);
+    }
+
+    // Transmitted in the next connection event
+    ble_evt_t* p_evt = evt_queue_alloc(BLE_GATTS_EVT_HVN_TX_COMPLETE, sizeof(ble_gatts_evt_t));
+    if (p_evt == NULL) {
+        return NRF_ERROR_RESOURCES;
+    }
+    p_evt->evt.gatts_evt.conn_handle                  = conn_handle;
+    p_evt->evt.gatts_evt.params.hvn_tx_complete.count = 1;
+
+    ++m_hvx_count;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_device_name_set(ble_gap_conn_sec_mode_t const* p_write_perm, uint8_t const* p_dev_name, uint16_t len) {
+    UNUSED_PARAMETER(p_write_perm);
+    UNUSED_PARAMETER(p_dev_name);
+    UNUSED_PARAMETER(len);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_ppcp_set(ble_gap_conn_params_t const* p_conn_params) {
+    UNUSED_PARAMETER(p_conn_params);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_disconnect(uint16_t conn_handle, uint8_t hci_status_code) {
+    UNUSED_PARAMETER(hci_status_code);
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID || conn_handle != m_conn_handle) {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    disconnected_evt_queue(BLE_HCI_LOCAL_HOST_TERMINATED_CONNECTION);
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_conn_param_update(uint16_t conn_handle, ble_gap_conn_params_t const* p_conn_params) {
+    if (conn_handle == BLE_CONN_HANDLE_INVALID || conn_handle != m_conn_handle) {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+
+    // The central always accepts, at the slowest interval allowed
+    ble_evt_t* p_evt = evt_queue_alloc(BLE_GAP_EVT_CONN_PARAM_UPDATE, sizeof(ble_gap_evt_t));
+    if (p_evt == NULL) {
+        return NRF_ERROR_BUSY;
+    }
+    ble_gap_conn_params_t* p_params = &p_evt->evt.gap_evt.params.conn_param_update.conn_params;
+    p_evt->evt.gap_evt.conn_handle = conn_handle;
+    *p_params                      = *p_conn_params;
+    p_params->min_conn_interval    = p_conn_params->max_conn_interval;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_phy_update(uint16_t conn_handle, ble_gap_phys_t const* p_gap_phys) {
+    if (conn_handle != m_conn_handle) {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+
+    // The central supports every PHY, and keeps the current one if it is allowed
+    const uint8_t phys = p_gap_phys->tx_phys;
+    if (phys != BLE_GAP_PHY_AUTO && (phys & m_phy) == 0) {
+        m_phy = (phys & BLE_GAP_PHY_2MBPS) ? BLE_GAP_PHY_2MBPS
+              : (phys & BLE_GAP_PHY_1MBPS) ? BLE_GAP_PHY_1MBPS
+              : BLE_GAP_PHY_CODED;
+    }
+
+    ble_evt_t* p_evt = evt_queue_alloc(BLE_GAP_EVT_PHY_UPDATE, sizeof(ble_gap_evt_t));
+    if (p_evt == NULL) {
+        return NRF_ERROR_BUSY;
+    }
+    p_evt->evt.gap_evt.conn_handle              = conn_handle;
+    p_evt->evt.gap_evt.params.phy_update.status = BLE_HCI_STATUS_CODE_SUCCESS;
+    p_evt->evt.gap_evt.params.phy_update.tx_phy = m_phy;
+    p_evt->evt.gap_evt.params.phy_update.rx_phy = m_phy;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_rssi_start(uint16_t conn_handle, uint8_t threshold_dbm, uint8_t skip_count) {
+    UNUSED_PARAMETER(threshold_dbm);
+    UNUSED_PARAMETER(skip_count);
+
+    if (conn_handle == BLE_CONN_HANDLE_INVALID || conn_handle != m_conn_handle) {
+        return BLE_ERROR_INVALID_CONN_HANDLE;
+    }
+    m_rssi_started = true;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_scan_start(ble_gap_scan_params_t const* p_scan_params, ble_data_t const* p_adv_report_buffer) {
+    if (p_adv_report_buffer == NULL) {
+        return NRF_ERROR_INVALID_ADDR;
+    }
+
+    // Without parameters, resumes a scanner paused by a report
+    if (p_scan_params == NULL) {
+        if (!m_scanning || !m_scan_paused) {
+            return NRF_ERROR_INVALID_STATE;
+        }
+    }
+    else {
+        if (m_scanning) {
+            return NRF_ERROR_INVALID_STATE;
+        }
+        m_scan_params = *p_scan_params;
+        m_scanning    = true;
+    }
+
+    m_scan_data   = *p_adv_report_buffer;
+    m_scan_paused = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_ble_gap_scan_stop(void) {
+    if (!m_scanning) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    m_scanning = false;
+    return NRF_SUCCESS;
+}
+
+
+uint32_t sd_rand_application_vector_get(uint8_t* p_buff, uint8_t length) {
+    // Deterministic, so runs can be compared
+    static uint32_t state = 0x2545F491;
+
+    for (uint8_t i = 0; i < length; ++i) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        p_buff[i] = (uint8_t)state;
+    }
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ble.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define SIM_CONN_HANDLE            0       /**< Connection handle given to the simulated central. */
+#define SIM_MAX_OBSERVERS          16      /**< Maximum number of BLE observers the simulator can time. */
+#define SIM_MAX_ATTRS              64      /**< Size of the simulated GATT attribute table. */
+#define SIM_ATTR_MAX_LEN           BLE_GATTS_VAR_ATTR_LEN_MAX  /**< Maximum length of a simulated attribute value. */
+#define SIM_EVT_QUEUE_SIZE         16      /**< Number of events the simulated SoftDevice can have pending. */
+#define SIM_EVT_BUF_SIZE           (sizeof(ble_evt_t) + SIM_ATTR_MAX_LEN)
+
+/**@brief Event length as reported by the SoftDevice, including the event header. */
+#define SIM_EVT_LEN(_module_evt_len) ((uint16_t)(offsetof(ble_evt_t, evt) + (_module_evt_len)))
+
+
+/**@brief BLE observer event handler type, matching nrf_sdh_ble_evt_handler_t. */
+typedef void (*sim_ble_evt_handler_t)(const ble_evt_t* p_ble_evt, void* p_context);
+
+/**@brief BLE observer registered by NRF_SDH_BLE_OBSERVER in the host build. */
+typedef struct {
+    const char*           p_name;     /**< Name of the observer instance. */
+    uint8_t               prio;       /**< Observer priority, lower is called first. */
+    sim_ble_evt_handler_t handler;    /**< BLE event handler. */
+    void*                 p_context;  /**< Context passed to the handler. */
+} sim_ble_observer_t;
+
+/**@brief Handler cost statistics for one observer and one event ID. */
+typedef struct {
+    const char* p_observer;  /**< Name of the observer. */
+    uint16_t    evt_id;      /**< BLE event ID. */
+    uint32_t    count;       /**< Number of calls. */
+    uint64_t    total_ns;    /**< Total time spent in the handler. */
+    uint64_t    min_ns;      /**< Fastest call. */
+    uint64_t    max_ns;      /**< Slowest call. */
+} sim_handler_stats_t;
+
+
+/**@brief Function for reading the host monotonic clock.
+ *
+ * @return Current time in nanoseconds.
+ */
+uint64_t sim_now_ns(void);
+
+
+/**@brief Function for dispatching a BLE event to all observers, in priority order.
+ *
+ * @details Every handler call is timed and accumulated in the handler statistics.
+ *
+ * @param[in] p_ble_evt  Event to dispatch.
+ */
+void sim_ble_evt_dispatch(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Function for dispatching all events queued by the simulated SoftDevice.
+ *
+ * @details Events such as BLE_GAP_EVT_DISCONNECTED after sd_ble_gap_disconnect are raised
+ *          asynchronously by the SoftDevice, so they are queued and dispatched here.
+ *
+ * @return Number of events dispatched.
+ */
+unsigned int sim_ble_evt_pump(void);
+
+
+/**@brief Function for simulating a central connecting.
+ *
+ * @details The central is not bonded, so notifications fail with BLE_ERROR_GATTS_SYS_ATTR_MISSING
+ *          until it writes a CCCD on the new link.
+ *
+ * @param[in] p_peer_addr  Address of the central.
+ *
+ * @return True if connected, false if the lock was not connectable.
+ */
+bool sim_gap_connect(const ble_gap_addr_t* p_peer_addr);
+
+
+/**@brief Function for simulating the link going down from the central side.
+ *
+ * @param[in] reason  HCI reason, e.g. BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION or
+ *                    BLE_HCI_CONNECTION_TIMEOUT for a supervision timeout.
+ */
+void sim_gap_disconnect(uint8_t reason);
+
+
+/**@brief Function for checking if the simulated central is connected.
+ */
+bool sim_gap_is_connected(void);
+
+
+/**@brief Function for simulating a change of the link RSSI.
+ *
+ * @details Raises BLE_GAP_EVT_RSSI_CHANGED if the firmware started RSSI reporting on the link.
+ *          Thresholds and skip counts are not simulated, every call is reported.
+ *
+ * @param[in] rssi  New RSSI, dBm.
+ */
+void sim_gap_rssi_set(int8_t rssi);
+
+
+/**@brief Function for getting the PHY of the simulated link, BLE_GAP_PHY_1MBPS after connecting. */
+uint8_t sim_gap_phy_get(void);
+
+
+/**@brief Function for simulating an advertisement received by the scanner.
+ *
+ * @details Raises BLE_GAP_EVT_ADV_REPORT and dispatches it if the firmware is scanning and has
+ *          handed the report buffer back since the previous report. Scan windows and timeouts
+ *          are not simulated, every call made while scanning is reported.
+ *
+ * @param[in] p_peer_addr  Address of the advertiser.
+ * @param[in] rssi         RSSI, dBm.
+ * @param[in] p_data       Advertising data.
+ * @param[in] len          Advertising data length.
+ *
+ * @return True if reported, false if the firmware is not scanning.
+ */
+bool sim_gap_adv_report(const ble_gap_addr_t* p_peer_addr, int8_t rssi, const uint8_t* p_data, uint16_t len);
+
+
+/**@brief Function for getting the scan interval and window the firmware last started with.
+ *
+ * @param[out] p_interval_ms  Scan interval.
+ * @param[out] p_window_ms    Scan window.
+ *
+ * @return True if scanning.
+ */
+bool sim_gap_scan_get(double* p_interval_ms, double* p_window_ms);
+
+
+/**@brief Function for simulating a GATT write request from the central.
+ *
+ * @details The attribute value is updated before BLE_GATTS_EVT_WRITE is dispatched, as the
+ *          SoftDevice does. Writes to attributes that are not writable, by their properties or
+ *          their write permission, are refused without an event.
+ *
+ * @param[in] handle  Attribute handle.
+ * @param[in] p_data  Data written.
+ * @param[in] len     Length of the data.
+ */
+void sim_gatts_write(uint16_t handle, const uint8_t* p_data, uint16_t len);
+
+
+/**@brief Function for simulating a long write from the central, with Prepare Write Requests
+ *        and an Execute Write Request.
+ *
+ * @details Only attributes that need write authorization are supported. The value is updated
+ *          when the application accepts the BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST of the Execute
+ *          Write Request, as the SoftDevice does.
+ *
+ * @param[in] handle  Attribute handle.
+ * @param[in] p_data  Data written.
+ * @param[in] len     Length of the data.
+ *
+ * @return true if the application accepted the write.
+ */
+bool sim_gatts_long_write(uint16_t handle, const uint8_t* p_data, uint16_t len);
+
+
+/**@brief Function for finding a characteristic value handle.
+ *
+ * @param[in] p_uuid  UUID of the characteristic.
+ *
+ * @return Value handle, or BLE_GATT_HANDLE_INVALID if not found.
+ */
+uint16_t sim_gatts_value_handle_find(const ble_uuid_t* p_uuid);
+
+
+/**@brief Function for finding the CCCD handle of a characteristic.
+ *
+ * @param[in] value_handle  Value handle of the characteristic.
+ *
+ * @return CCCD handle, or BLE_GATT_HANDLE_INVALID if the characteristic has none.
+ */
+uint16_t sim_gatts_cccd_handle_find(uint16_t value_handle);
+
+
+/**@brief Function for getting the number of BLE events dispatched since startup. */
+uint32_t sim_ble_evt_count(void);
+
+
+/**@brief Function for getting the largest number of BLE events pending at once. */
+unsigned int sim_ble_evt_queue_peak(void);
+
+
+/**@brief Function for getting the number of notifications sent since startup. */
+uint32_t sim_gatts_hvx_count(void);
+
+
+/**@brief Function for getting the handler cost statistics.
+ *
+ * @param[out] p_count  Number of entries.
+ *
+ * @return Statistics table.
+ */
+const sim_handler_stats_t* sim_handler_stats_get(unsigned int* p_count);
+
+
+/**@brief Function for clearing the handler cost statistics. */
+void sim_handler_stats_reset(void);
+
+
+/**@brief Function for printing the handler cost statistics table. */
+void sim_handler_stats_print(void);
+
+
+/**@brief Function for replaying a BLE event captured on the target.
+ *
+ * @details The event is dispatched like a live one. The connection handle and the attribute
+ *          values are updated from it, so SoftDevice calls made by the handlers behave as they
+ *          did on the target. From the first replayed event on, events the simulated
+ *          SoftDevice would raise itself are discarded, as the trace already holds them.
+ *
+ * @param[in] p_ble_evt  Event to replay.
+ */
+void sim_ble_evt_replay(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Simulation entry point, called when the firmware main loop first goes idle.
+ *
+ * @details Implemented by the simulation driver. It runs the simulation from the firmware's
+ *          idle state and does not return.
+ */
+void sim_idle(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,98 @@
+/** @file
+ *
+ * @brief Unit tests of firmware modules, host build.
+ *
+ * @details Each module is linked alone, with the SDK functions it calls provided here, so a
+ *          test controls exactly what the module sees:
+ *
+ *          make test
+ *
+ *          Prints every failed check and exits with a non-zero status if any failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "app_timer.h"
+
+#include "diag_service/unlock_latency.h"
+
+
+static uint32_t     m_ticks;    /**< Application timer counter seen by the module under test */
+static unsigned int m_failed;
+
+
+#define CHECK_EQUAL(expected, actual)                                                           \
+    do {                                                                                        \
+        const unsigned long long e = (expected);                                                \
+        const unsigned long long a = (actual);                                                  \
+        if (e != a) {                                                                           \
+            fprintf(stderr, "%s:%d: %s is %llu, expected %llu\n", __FILE__, __LINE__, #actual, a, e); \
+            ++m_failed;                                                                         \
+        }                                                                                       \
+    } while (0)
+
+
+uint32_t app_timer_cnt_get(void) {
+    return m_ticks;
+}
+
+
+uint32_t app_timer_cnt_diff_compute(uint32_t ticks_to, uint32_t ticks_from) {
+    return (ticks_to - ticks_from) & 0x00FFFFFF;
+}
+
+
+/**@brief Function for checking that the breakdown is in microseconds at the timer rate the
+ *        firmware arms its timers with, prescaler included.
+ */
+static void test_unlock_latency_units(void) {
+    unlock_latency_record_t record;
+
+    m_ticks = 0x00FFFF00;       // Wraps during the transaction
+    unlock_latency_mark(UNLOCK_LATENCY_CONNECTED);
+    m_ticks = (m_ticks + APP_TIMER_TICKS(250)) & 0x00FFFFFF;
+    unlock_latency_mark(UNLOCK_LATENCY_SECURED);
+    m_ticks = (m_ticks + APP_TIMER_TICKS(1000)) & 0x00FFFFFF;
+    unlock_latency_mark(UNLOCK_LATENCY_WRITE);
+    m_ticks = (m_ticks + APP_TIMER_TICKS(125)) & 0x00FFFFFF;
+    unlock_latency_mark(UNLOCK_LATENCY_ACTUATED);
+    unlock_latency_disconnected();
+
+    CHECK_EQUAL(1, unlock_latency_count());
+    CHECK_EQUAL(true, unlock_latency_get(0, &record));
+    CHECK_EQUAL(UNLOCK_LATENCY_FLAG_SECURED, record.flags);
+    CHECK_EQUAL(250000, record.security_us);
+    CHECK_EQUAL(1000000, record.gatt_us);
+    CHECK_EQUAL(125000, record.firmware_us);
+}
+
+
+/**@brief Function for checking that an unlock after a command that did not unlock is not
+ *        timed from that command.
+ */
+static void test_unlock_latency_write_without_unlock(void) {
+    const uint8_t count = unlock_latency_count();
+
+    unlock_latency_mark(UNLOCK_LATENCY_CONNECTED);
+    unlock_latency_mark(UNLOCK_LATENCY_WRITE);
+    unlock_latency_mark(UNLOCK_LATENCY_WRITE_DONE);
+    m_ticks = (m_ticks + APP_TIMER_TICKS(3000)) & 0x00FFFFFF;
+    unlock_latency_mark(UNLOCK_LATENCY_ACTUATED);
+    unlock_latency_disconnected();
+
+    CHECK_EQUAL(count, unlock_latency_count());
+}
+
+
+int main(void) {
+    test_unlock_latency_units();
+    test_unlock_latency_write_without_unlock();
+
+    if (m_failed != 0) {
+        fprintf(stderr, "%u checks failed\n", m_failed);
+        return EXIT_FAILURE;
+    }
+    printf("All tests passed\n");
+    return EXIT_SUCCESS;
+}
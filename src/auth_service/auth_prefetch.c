@@ -0,0 +1,144 @@
+#include "auth_prefetch.h"
+#include "unlock_auth.h"
+#include "config.h"
+
+#include <stdbool.h>
+#include <string.h>
+#include "nrf_log.h"
+
+
+/**@brief Peer that sent a command before */
+typedef struct {
+    ble_gap_addr_t addr;        /**< Address the peer last connected with */
+    pm_peer_id_t   peer_id;     /**< Bond of the peer, PM_PEER_ID_INVALID if not bonded */
+    uint16_t       cred_id;     /**< Credential of its last accepted command, 0 if the entry is free */
+} peer_entry_t;
+
+
+static peer_entry_t          m_peers[AUTH_PREFETCH_PEERS];
+static uint8_t               m_next_entry;                  /**< Entry replaced by the next new peer */
+static auth_prefetch_stats_t m_stats;
+static uint16_t              m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static ble_gap_addr_t        m_addr;                        /**< Address of the current peer */
+static pm_peer_id_t          m_peer_id = PM_PEER_ID_INVALID; /**< Bond of the current peer, once identified */
+static uint16_t              m_prefetched;                  /**< Credential prepared for the current connection, 0 if none */
+static bool                  m_accepted;                    /**< A command was accepted on the current connection */
+
+
+/**@brief Function for checking if two addresses are the same.
+ */
+static bool addr_equal(const ble_gap_addr_t* p_a, const ble_gap_addr_t* p_b) {
+    return p_a->addr_type == p_b->addr_type && memcmp(p_a->addr, p_b->addr, BLE_GAP_ADDR_LEN) == 0;
+}
+
+
+/**@brief Function for finding the entry of the current peer, by bond if it is identified and
+ *        else by address.
+ *
+ * @return Entry, or NULL if the peer did not send a command before.
+ */
+static peer_entry_t* peer_find(void) {
+    for (unsigned int i = 0; i < AUTH_PREFETCH_PEERS; ++i) {
+        const peer_entry_t* p_entry = &m_peers[i];
+
+        if (p_entry->cred_id == 0) {
+            continue;
+        }
+        if (m_peer_id != PM_PEER_ID_INVALID ? p_entry->peer_id == m_peer_id : addr_equal(&p_entry->addr, &m_addr)) {
+            return &m_peers[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for preparing the credential of the current peer, if it is known.
+ */
+static void prefetch(void) {
+    const peer_entry_t* p_entry = peer_find();
+
+    if (p_entry == NULL || p_entry->cred_id == m_prefetched || m_accepted) {
+        return;
+    }
+
+    const ret_code_t err_code = unlock_auth_prefetch(p_entry->cred_id);
+    if (err_code != NRF_SUCCESS) {
+        // The command is verified the usual way
+        ++m_stats.errors;
+        return;
+    }
+
+    ++m_stats.prefetches;
+    m_prefetched = p_entry->cred_id;
+}
+
+
+void auth_prefetch_on_ble_evt(const ble_evt_t* p_ble_evt) {
+    const ble_gap_evt_t* p_gap_evt = &p_ble_evt->evt.gap_evt;
+
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONNECTED:
+            ++m_stats.connections;
+            m_conn_handle = p_gap_evt->conn_handle;
+            m_addr        = p_gap_evt->params.connected.peer_addr;
+            m_peer_id     = PM_PEER_ID_INVALID;
+            m_prefetched  = 0;
+            m_accepted    = false;
+            prefetch();
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_gap_evt->conn_handle == m_conn_handle) {
+                m_conn_handle = BLE_CONN_HANDLE_INVALID;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void auth_prefetch_on_pm_evt(const pm_evt_t* p_evt) {
+    if (p_evt->evt_id != PM_EVT_BONDED_PEER_CONNECTED || p_evt->conn_handle != m_conn_handle) {
+        return;
+    }
+
+    m_peer_id = p_evt->peer_id;
+    prefetch();
+}
+
+
+void auth_prefetch_command_accepted(uint16_t cred_id) {
+    // Only the first command of a connection can use the prepared context
+    if (!m_accepted) {
+        if (cred_id == m_prefetched) {
+            ++m_stats.hits;
+        }
+        else {
+            ++m_stats.misses;
+        }
+    }
+    m_accepted   = true;
+    m_prefetched = 0;
+
+    peer_entry_t* p_entry = peer_find();
+    if (p_entry == NULL) {
+        p_entry      = &m_peers[m_next_entry];
+        m_next_entry = (m_next_entry + 1) % AUTH_PREFETCH_PEERS;
+    }
+    p_entry->addr    = m_addr;
+    p_entry->peer_id = m_peer_id;
+    p_entry->cred_id = cred_id;
+}
+
+
+const auth_prefetch_stats_t* auth_prefetch_stats_get(void) {
+    return &m_stats;
+}
+
+
+void auth_prefetch_log(void) {
+    NRF_LOG_INFO("Auth prefetch: %u connections, %u prefetches, %u errors, %u hits, %u misses",
+                 m_stats.connections, m_stats.prefetches, m_stats.errors, m_stats.hits, m_stats.misses);
+}
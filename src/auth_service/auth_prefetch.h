@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ble.h"
+#include "peer_manager_types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Authentication prefetch counters, since boot */
+typedef struct {
+    uint32_t connections;       /**< Connections */
+    uint32_t prefetches;        /**< Connections of a known peer, whose credential was prepared */
+    uint32_t errors;            /**< Preparations that failed, e.g. on a flash read */
+    uint32_t hits;              /**< Commands signed with the prepared credential */
+    uint32_t misses;            /**< Commands signed with another credential, or from an unknown peer */
+} auth_prefetch_stats_t;
+
+
+/**@brief Function for handling BLE events, called for every event.
+ *
+ * @details On connect the peer address is looked up among the peers that sent a command
+ *          before, and if found the verification of the credential they used is prepared with
+ *          @ref unlock_auth_prefetch, while the link is still being set up.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ */
+void auth_prefetch_on_ble_evt(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Function for handling peer manager events, called for every event.
+ *
+ * @details A bonded peer using a resolvable address is only known once the peer manager
+ *          identifies it, it is then looked up by peer ID.
+ *
+ * @param[in] p_evt  Peer manager event.
+ */
+void auth_prefetch_on_pm_evt(const pm_evt_t* p_evt);
+
+
+/**@brief Function for recording the credential of a command accepted on the current connection.
+ *
+ * @param[in] cred_id  Credential the command was signed with.
+ */
+void auth_prefetch_command_accepted(uint16_t cred_id);
+
+
+/**@brief Function for getting the prefetch counters. */
+const auth_prefetch_stats_t* auth_prefetch_stats_get(void);
+
+
+/**@brief Function for logging the prefetch counters. */
+void auth_prefetch_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
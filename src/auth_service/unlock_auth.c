@@ -0,0 +1,493 @@
+#include "unlock_auth.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "config.h"
+#include "app_error.h"
+#include "sdk_macros.h"
+#include "nrf_crypto.h"
+#include "nrf_soc.h"
+#include "fds.h"
+#include "nrf_log.h"
+
+
+// FDS record keys of the counters are the credential IDs, those of the keys are offset by
+// KEY_RECORD_BASE, which splits the valid key range in two
+#define CRED_ID_MIN     0x0001
+#define CRED_ID_MAX     0x5FFF
+#define KEY_RECORD_BASE 0x6000
+
+
+/**@brief Credential slot */
+typedef struct {
+    uint8_t           key[UNLOCK_AUTH_KEY_LEN]; /**< Key, kept in RAM for the CC310, word aligned for FDS */
+    uint32_t          counter;                  /**< Last accepted counter */
+    uint32_t          record_counter;           /**< Counter being written to flash */
+    fds_record_desc_t record_desc;              /**< Flash record of the counter, if record_found */
+    uint16_t          cred_id;                  /**< Credential ID, 0 if the slot is free */
+    bool              loaded;                   /**< Counter read from flash */
+    bool              record_found;             /**< Counter has a flash record */
+    bool              store_pending;            /**< Counter still to be written, flash or queue was full */
+    bool              key_store_pending;        /**< Key still to be written, FDS not initialized or flash or queue was full */
+} credential_t;
+
+
+static credential_t              m_credentials[UNLOCK_AUTH_MAX_CREDENTIALS];
+static nrf_crypto_hmac_context_t m_hmac_context;
+static nrf_crypto_hmac_context_t m_prefetch_context;                           /**< Keyed with the credential of m_prefetch_cred_id */
+static uint16_t                  m_prefetch_cred_id;                           /**< Credential prepared by unlock_auth_prefetch, 0 if none */
+static uint8_t                   m_challenges[2][UNLOCK_AUTH_CHALLENGE_LEN];   /**< Current and previous challenge */
+static uint8_t                   m_challenge_index;                            /**< Index of the current challenge */
+static uint8_t                   m_challenge_count;                            /**< Number of challenges drawn, up to 2 */
+static bool                      m_gc_pending;                                 /**< Garbage collection started for a counter write */
+static bool                      m_gc_done;                                    /**< Garbage collection completed, records still not fitting are given up */
+static bool                      m_fds_ready;                                  /**< FDS initialized, keys can be written */
+
+
+/**@brief Function for finding the slot of a credential.
+ *
+ * @return Slot, or NULL if the credential is unknown.
+ */
+static credential_t* credential_find(uint16_t cred_id) {
+    for (unsigned int i = 0; i < UNLOCK_AUTH_MAX_CREDENTIALS; ++i) {
+        if (m_credentials[i].cred_id == cred_id && cred_id != 0) {
+            return &m_credentials[i];
+        }
+    }
+    return NULL;
+}
+
+
+/**@brief Function for adding a credential to a free slot, without writing its key.
+ *
+ * @param[out] pp_cred  Slot, only valid on success.
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the ID is out of range or in use or
+ *         NRF_ERROR_NO_MEM if every slot is in use.
+ */
+static ret_code_t credential_slot_add(uint16_t cred_id, const uint8_t* p_key, credential_t** pp_cred) {
+    if (cred_id < CRED_ID_MIN || cred_id > CRED_ID_MAX || credential_find(cred_id) != NULL) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    credential_t* p_cred = NULL;
+    for (unsigned int i = 0; i < UNLOCK_AUTH_MAX_CREDENTIALS && p_cred == NULL; ++i) {
+        if (m_credentials[i].cred_id == 0) {
+            p_cred = &m_credentials[i];
+        }
+    }
+    if (p_cred == NULL) {
+        return NRF_ERROR_NO_MEM;
+    }
+
+    memset(p_cred, 0, sizeof(*p_cred));
+    memcpy(p_cred->key, p_key, UNLOCK_AUTH_KEY_LEN);
+    p_cred->cred_id = cred_id;
+    *pp_cred = p_cred;
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for reading the last accepted counter of a credential from flash.
+ *
+ * @return NRF_SUCCESS, also if the credential has no record yet, otherwise an FDS error code.
+ */
+static ret_code_t counter_load(credential_t* p_cred) {
+    fds_find_token_t   token = {0};
+    fds_flash_record_t record;
+
+    ret_code_t err_code = fds_record_find(UNLOCK_AUTH_FILE_ID, p_cred->cred_id, &p_cred->record_desc, &token);
+    if (err_code == FDS_ERR_NOT_FOUND) {
+        p_cred->counter = 0;
+        p_cred->loaded  = true;
+        return NRF_SUCCESS;
+    }
+    VERIFY_SUCCESS(err_code);
+
+    err_code = fds_record_open(&p_cred->record_desc, &record);
+    VERIFY_SUCCESS(err_code);
+    memcpy(&p_cred->counter, record.p_data, sizeof(p_cred->counter));
+    err_code = fds_record_close(&p_cred->record_desc);
+    VERIFY_SUCCESS(err_code);
+
+    p_cred->record_found = true;
+    p_cred->loaded       = true;
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for handling the result of queueing the write of a credential record.
+ *
+ * @details If flash or the FDS queue is full, the write is retried from the FDS event handler.
+ *          A full flash is collected once, and the write given up if that freed nothing.
+ *
+ * @return Whether the write is to be retried.
+ */
+static bool store_result_handle(ret_code_t err_code, uint16_t cred_id) {
+    if (err_code == NRF_SUCCESS) {
+        return false;
+    }
+
+    if (err_code == FDS_ERR_NO_SPACE_IN_FLASH && m_gc_done) {
+        NRF_LOG_WARNING("Credential 0x%04x: no flash left", cred_id);
+        return false;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH && !m_gc_pending) {
+        err_code = fds_gc();
+        m_gc_pending = (err_code == NRF_SUCCESS);
+        if (err_code != NRF_SUCCESS && err_code != FDS_ERR_NO_SPACE_IN_QUEUES) {
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+    else if (err_code != FDS_ERR_NO_SPACE_IN_FLASH && err_code != FDS_ERR_NO_SPACE_IN_QUEUES) {
+        APP_ERROR_CHECK(err_code);
+    }
+    return true;
+}
+
+
+/**@brief Function for queueing the write of the last accepted counter of a credential.
+ *
+ * @details A write given up on is tried again on the next accepted command. The counter in RAM
+ *          is authoritative until then.
+ */
+static void counter_store(credential_t* p_cred) {
+    fds_record_t record;
+    ret_code_t   err_code;
+
+    p_cred->record_counter    = p_cred->counter;
+    record.file_id            = UNLOCK_AUTH_FILE_ID;
+    record.key                = p_cred->cred_id;
+    record.data.p_data        = &p_cred->record_counter;
+    record.data.length_words  = 1;
+
+    if (p_cred->record_found) {
+        err_code = fds_record_update(&p_cred->record_desc, &record);
+    }
+    else {
+        err_code = fds_record_write(&p_cred->record_desc, &record);
+    }
+
+    if (err_code == NRF_SUCCESS) {
+        p_cred->record_found = true;
+    }
+    p_cred->store_pending = store_result_handle(err_code, p_cred->cred_id);
+}
+
+
+/**@brief Function for queueing the write of the key of a credential, once FDS is initialized.
+ *
+ * @details A key already in flash, such as the development key provisioned every boot, is
+ *          not written again, see @ref credentials_load.
+ */
+static void key_store(credential_t* p_cred) {
+    fds_record_desc_t desc;
+    fds_find_token_t  token = {0};
+    fds_record_t      record;
+
+    p_cred->key_store_pending = true;
+    if (!m_fds_ready) {
+        return;
+    }
+
+    record.file_id           = UNLOCK_AUTH_FILE_ID;
+    record.key               = KEY_RECORD_BASE + p_cred->cred_id;
+    record.data.p_data       = p_cred->key;
+    record.data.length_words = UNLOCK_AUTH_KEY_LEN / sizeof(uint32_t);
+
+    // A key left in flash from an older enrollment of the same ID is replaced
+    ret_code_t err_code = fds_record_find(UNLOCK_AUTH_FILE_ID, record.key, &desc, &token);
+    if (err_code == NRF_SUCCESS) {
+        err_code = fds_record_update(&desc, &record);
+    }
+    else if (err_code == FDS_ERR_NOT_FOUND) {
+        err_code = fds_record_write(NULL, &record);
+    }
+
+    p_cred->key_store_pending = store_result_handle(err_code, p_cred->cred_id);
+}
+
+
+/**@brief Function for adding the credentials whose key is in flash, once FDS is initialized.
+ *
+ * @details Credentials added before, such as the development credential, keep their slot. If
+ *          their key is already in flash it is not written again. Keys that do not fit a slot
+ *          stay in flash.
+ */
+static void credentials_load(void) {
+    fds_record_desc_t  desc;
+    fds_find_token_t   token = {0};
+    fds_flash_record_t record;
+
+    while (fds_record_find_in_file(UNLOCK_AUTH_FILE_ID, &desc, &token) == NRF_SUCCESS) {
+        ret_code_t err_code = fds_record_open(&desc, &record);
+        APP_ERROR_CHECK(err_code);
+
+        const uint16_t record_key = record.p_header->record_key;
+        if (record_key > KEY_RECORD_BASE && record.p_header->length_words * sizeof(uint32_t) == UNLOCK_AUTH_KEY_LEN) {
+            const uint16_t cred_id = record_key - KEY_RECORD_BASE;
+            credential_t*  p_cred  = credential_find(cred_id);
+
+            if (p_cred == NULL) {
+                err_code = credential_slot_add(cred_id, record.p_data, &p_cred);
+                if (err_code != NRF_SUCCESS) {
+                    NRF_LOG_WARNING("Credential 0x%04x in flash not loaded: 0x%x", cred_id, err_code);
+                }
+            }
+            else if (memcmp(p_cred->key, record.p_data, UNLOCK_AUTH_KEY_LEN) == 0) {
+                p_cred->key_store_pending = false;
+            }
+        }
+
+        err_code = fds_record_close(&desc);
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for handling FDS events, loads the credentials once FDS is initialized and
+ *        retries writes that did not fit before.
+ */
+static void fds_evt_handler(const fds_evt_t* p_evt) {
+    if (p_evt->id == FDS_EVT_INIT) {
+        if (p_evt->result != NRF_SUCCESS) {
+            return;
+        }
+        m_fds_ready = true;
+        credentials_load();
+    }
+    else if (p_evt->id == FDS_EVT_GC && m_gc_pending) {
+        m_gc_pending = false;
+        m_gc_done    = true;
+    }
+
+    for (unsigned int i = 0; i < UNLOCK_AUTH_MAX_CREDENTIALS; ++i) {
+        if (m_credentials[i].store_pending) {
+            counter_store(&m_credentials[i]);
+        }
+        if (m_credentials[i].key_store_pending) {
+            key_store(&m_credentials[i]);
+        }
+    }
+
+    // Only the retries right after a collection give up
+    m_gc_done = false;
+}
+
+
+/**@brief Function for comparing two buffers in a time independent of their contents.
+ */
+static bool mac_equal(const uint8_t* p_a, const uint8_t* p_b, uint16_t len) {
+    uint8_t diff = 0;
+
+    for (uint16_t i = 0; i < len; ++i) {
+        diff |= p_a[i] ^ p_b[i];
+    }
+    return diff == 0;
+}
+
+
+/**@brief Function for releasing the prefetched HMAC context without using it.
+ */
+static void prefetch_drop(void) {
+    uint8_t digest[NRF_CRYPTO_HASH_SIZE_SHA256];
+    size_t  digest_size = sizeof(digest);
+
+    if (m_prefetch_cred_id == 0) {
+        return;
+    }
+
+    // Finalizing is the only way to give back what the backend allocated for the context
+    (void)nrf_crypto_hmac_finalize(&m_prefetch_context, digest, &digest_size);
+    m_prefetch_cred_id = 0;
+}
+
+
+/**@brief Function for computing the MAC of a command with the prefetched HMAC context, which is
+ *        used up.
+ */
+static ret_code_t prefetch_mac_compute(const uint8_t* p_data, const uint8_t* p_challenge, uint8_t* p_mac) {
+    uint8_t    message[UNLOCK_AUTH_SIGNED_LEN + UNLOCK_AUTH_CHALLENGE_LEN];
+    uint8_t    digest[NRF_CRYPTO_HASH_SIZE_SHA256];
+    size_t     digest_size = sizeof(digest);
+    ret_code_t err_code;
+
+    m_prefetch_cred_id = 0;
+
+    memcpy(message, p_data, UNLOCK_AUTH_SIGNED_LEN);
+    memcpy(&message[UNLOCK_AUTH_SIGNED_LEN], p_challenge, UNLOCK_AUTH_CHALLENGE_LEN);
+
+    err_code = nrf_crypto_hmac_update(&m_prefetch_context, message, sizeof(message));
+    if (err_code != NRF_SUCCESS) {
+        (void)nrf_crypto_hmac_finalize(&m_prefetch_context, digest, &digest_size);
+        return err_code;
+    }
+
+    err_code = nrf_crypto_hmac_finalize(&m_prefetch_context, digest, &digest_size);
+    VERIFY_SUCCESS(err_code);
+
+    memcpy(p_mac, digest, UNLOCK_AUTH_MAC_LEN);
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for checking a command MAC against a challenge.
+ *
+ * @details The prefetched HMAC context is used if it was keyed for the credential, the key
+ *          schedule is then already done.
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_INVALID_DATA if the MAC does not match, otherwise an nrf_crypto
+ *         error code.
+ */
+static ret_code_t mac_check(const credential_t* p_cred, const uint8_t* p_data, const uint8_t* p_challenge) {
+    uint8_t    mac[UNLOCK_AUTH_MAC_LEN];
+    ret_code_t err_code;
+
+    if (m_prefetch_cred_id == p_cred->cred_id) {
+        err_code = prefetch_mac_compute(p_data, p_challenge, mac);
+    }
+    else {
+        err_code = unlock_auth_mac_compute(p_cred->key, p_data, p_challenge, mac);
+    }
+    VERIFY_SUCCESS(err_code);
+
+    return mac_equal(mac, &p_data[UNLOCK_AUTH_SIGNED_LEN], UNLOCK_AUTH_MAC_LEN) ? NRF_SUCCESS : NRF_ERROR_INVALID_DATA;
+}
+
+
+ret_code_t unlock_auth_init(void) {
+    memset(m_credentials, 0, sizeof(m_credentials));
+    m_challenge_count  = 0;
+    m_prefetch_cred_id = 0;
+
+    const ret_code_t err_code = nrf_crypto_init();
+    VERIFY_SUCCESS(err_code);
+
+    return fds_register(fds_evt_handler);
+}
+
+
+ret_code_t unlock_auth_credential_add(uint16_t cred_id, const uint8_t* p_key) {
+    credential_t* p_cred;
+
+    const ret_code_t err_code = credential_slot_add(cred_id, p_key, &p_cred);
+    VERIFY_SUCCESS(err_code);
+
+    key_store(p_cred);
+    return NRF_SUCCESS;
+}
+
+
+bool unlock_auth_credential_exists(uint16_t cred_id) {
+    return credential_find(cred_id) != NULL;
+}
+
+
+ret_code_t unlock_auth_challenge_rotate(void) {
+    const uint8_t next = m_challenge_index ^ 1;
+
+    const ret_code_t err_code = sd_rand_application_vector_get(m_challenges[next], UNLOCK_AUTH_CHALLENGE_LEN);
+    VERIFY_SUCCESS(err_code);
+
+    m_challenge_index = next;
+    if (m_challenge_count < 2) {
+        ++m_challenge_count;
+    }
+    return NRF_SUCCESS;
+}
+
+
+const uint8_t* unlock_auth_challenge_get(void) {
+    return m_challenges[m_challenge_index];
+}
+
+
+ret_code_t unlock_auth_prefetch(uint16_t cred_id) {
+    ret_code_t err_code;
+
+    credential_t* p_cred = credential_find(cred_id);
+    if (p_cred == NULL) {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    if (!p_cred->loaded) {
+        err_code = counter_load(p_cred);
+        VERIFY_SUCCESS(err_code);
+    }
+
+    if (m_prefetch_cred_id == cred_id) {
+        return NRF_SUCCESS;
+    }
+    prefetch_drop();
+
+    err_code = nrf_crypto_hmac_init(&m_prefetch_context, &g_nrf_crypto_hmac_sha256_info,
+                                    p_cred->key, UNLOCK_AUTH_KEY_LEN);
+    VERIFY_SUCCESS(err_code);
+
+    m_prefetch_cred_id = cred_id;
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t unlock_auth_mac_compute(const uint8_t* p_key, const uint8_t* p_data, const uint8_t* p_challenge, uint8_t* p_mac) {
+    uint8_t message[UNLOCK_AUTH_SIGNED_LEN + UNLOCK_AUTH_CHALLENGE_LEN];
+    uint8_t digest[NRF_CRYPTO_HASH_SIZE_SHA256];
+    size_t  digest_size = sizeof(digest);
+
+    // One contiguous RAM buffer, the CC310 cannot read from flash
+    memcpy(message, p_data, UNLOCK_AUTH_SIGNED_LEN);
+    memcpy(&message[UNLOCK_AUTH_SIGNED_LEN], p_challenge, UNLOCK_AUTH_CHALLENGE_LEN);
+
+    const ret_code_t err_code = nrf_crypto_hmac_calculate(&m_hmac_context, &g_nrf_crypto_hmac_sha256_info,
+                                                          digest, &digest_size,
+                                                          p_key, UNLOCK_AUTH_KEY_LEN,
+                                                          message, sizeof(message));
+    VERIFY_SUCCESS(err_code);
+
+    memcpy(p_mac, digest, UNLOCK_AUTH_MAC_LEN);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t unlock_auth_command_verify(const uint8_t* p_data, uint16_t len, unlock_auth_command_t* p_command) {
+    ret_code_t err_code;
+
+    if (len != UNLOCK_AUTH_COMMAND_LEN) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    p_command->opcode  = p_data[0];
+    p_command->cred_id = uint16_decode(&p_data[1]);
+    p_command->counter = uint32_decode(&p_data[3]);
+
+    if (p_command->opcode != UNLOCK_AUTH_OP_UNLOCK && p_command->opcode != UNLOCK_AUTH_OP_LOCK &&
+        p_command->opcode != UNLOCK_AUTH_OP_ENROLL) {
+        return NRF_ERROR_NOT_SUPPORTED;
+    }
+
+    credential_t* p_cred = credential_find(p_command->cred_id);
+    if (p_cred == NULL) {
+        return NRF_ERROR_NOT_FOUND;
+    }
+
+    if (m_challenge_count == 0 || (!p_cred->loaded && counter_load(p_cred) != NRF_SUCCESS)) {
+        return NRF_ERROR_BUSY;
+    }
+
+    // Replays are rejected before spending time on the MAC
+    if (p_command->counter <= p_cred->counter) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    // The phone may have read the challenge just before it was rotated
+    err_code = mac_check(p_cred, p_data, m_challenges[m_challenge_index]);
+    if (err_code == NRF_ERROR_INVALID_DATA && m_challenge_count == 2) {
+        err_code = mac_check(p_cred, p_data, m_challenges[m_challenge_index ^ 1]);
+    }
+    VERIFY_SUCCESS(err_code);
+
+    p_cred->counter = p_command->counter;
+    counter_store(p_cred);
+    return NRF_SUCCESS;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define UNLOCK_AUTH_KEY_LEN         32  /**< Length of a credential key, HMAC-SHA256. */
+#define UNLOCK_AUTH_MAC_LEN         8   /**< Length of the truncated HMAC-SHA256 closing a command. */
+#define UNLOCK_AUTH_SIGNED_LEN      7   /**< Length of the part of a command covered by the MAC. */
+#define UNLOCK_AUTH_COMMAND_LEN     (UNLOCK_AUTH_SIGNED_LEN + UNLOCK_AUTH_MAC_LEN)  /**< Length of a command. */
+#define UNLOCK_AUTH_CHALLENGE_LEN   8   /**< Length of the challenge published in the scan response. */
+
+
+/**@brief Command opcodes */
+typedef enum {
+    UNLOCK_AUTH_OP_UNLOCK = 0x01,   /**< Unlock the door, the autolock timer locks it again */
+    UNLOCK_AUTH_OP_LOCK   = 0x02,   /**< Lock the door */
+    UNLOCK_AUTH_OP_ENROLL = 0x03    /**< Authorize the credentials that follow in a long command */
+} unlock_auth_opcode_t;
+
+/**@brief Verified command */
+typedef struct {
+    uint8_t  opcode;    /**< One of @ref unlock_auth_opcode_t */
+    uint16_t cred_id;   /**< Credential the command was signed with */
+    uint32_t counter;   /**< Counter of the command, larger than any accepted before for the credential */
+} unlock_auth_command_t;
+
+
+/**@brief Function for initializing the unlock authentication.
+ *
+ * @details Initializes nrf_crypto and registers with FDS, so it must be called before the
+ *          peer manager initializes FDS. The credentials enrolled before the reset are loaded
+ *          from flash once FDS is initialized, their counters are read on first use.
+ *          Commands are rejected until the first challenge is drawn with
+ *          @ref unlock_auth_challenge_rotate.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t unlock_auth_init(void);
+
+
+/**@brief Function for adding a credential.
+ *
+ * @details The key is written to flash, once FDS is initialized if it is not yet.
+ *
+ * @param[in] cred_id  Credential ID phones send in their commands, 0x0001 to 0x5FFF.
+ * @param[in] p_key    Key of the credential, @ref UNLOCK_AUTH_KEY_LEN bytes.
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_INVALID_PARAM if the ID is out of range or already in use or
+ *         NRF_ERROR_NO_MEM if UNLOCK_AUTH_MAX_CREDENTIALS are in use.
+ */
+ret_code_t unlock_auth_credential_add(uint16_t cred_id, const uint8_t* p_key);
+
+
+/**@brief Function for checking if a credential has been added.
+ *
+ * @param[in] cred_id  Credential ID.
+ */
+bool unlock_auth_credential_exists(uint16_t cred_id);
+
+
+/**@brief Function for drawing a new challenge from the SoftDevice RNG.
+ *
+ * @details The previous challenge stays valid until the next rotation, so a phone that read
+ *          it just before the rotation can still use it.
+ *
+ * @return NRF_SUCCESS, or NRF_ERROR_SOC_RAND_NOT_ENOUGH_VALUES if the RNG pool is short, in
+ *         which case the current challenge is kept.
+ */
+ret_code_t unlock_auth_challenge_rotate(void);
+
+
+/**@brief Function for getting the current challenge, @ref UNLOCK_AUTH_CHALLENGE_LEN bytes. */
+const uint8_t* unlock_auth_challenge_get(void);
+
+
+/**@brief Function for verifying a command written to the command characteristic.
+ *
+ * @details A command is the opcode, the credential ID and the counter, little endian, followed
+ *          by the first @ref UNLOCK_AUTH_MAC_LEN bytes of the HMAC-SHA256 of those and the
+ *          current or previous challenge under the credential key. On success the counter is
+ *          accepted and stored, so the same command is rejected if it is replayed.
+ *
+ * @param[in]  p_data     Command.
+ * @param[in]  len        Command length.
+ * @param[out] p_command  Verified command, only valid on success.
+ *
+ * @return NRF_SUCCESS if the command can be acted on,
+ *         NRF_ERROR_INVALID_LENGTH if it is not @ref UNLOCK_AUTH_COMMAND_LEN bytes,
+ *         NRF_ERROR_NOT_SUPPORTED for an unknown opcode,
+ *         NRF_ERROR_NOT_FOUND for an unknown credential,
+ *         NRF_ERROR_INVALID_STATE if the counter is not larger than the last accepted one,
+ *         NRF_ERROR_INVALID_DATA if the MAC does not match,
+ *         NRF_ERROR_BUSY if the stored counter could not be read yet or there is no challenge.
+ */
+ret_code_t unlock_auth_command_verify(const uint8_t* p_data, uint16_t len, unlock_auth_command_t* p_command);
+
+
+/**@brief Function for preparing the verification of the next command of a credential.
+ *
+ * @details Reads the credential counter from flash if needed and keys an HMAC context with the
+ *          credential key, so that verifying the next command of that credential only hashes the
+ *          command and the challenge. Called while the link is being set up, before the command
+ *          is written. The prepared context is used once, preparing another credential drops it.
+ *
+ * @param[in] cred_id  Credential expected to sign the next command.
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_NOT_FOUND for an unknown credential, otherwise an FDS or
+ *         nrf_crypto error code.
+ */
+ret_code_t unlock_auth_prefetch(uint16_t cred_id);
+
+
+/**@brief Function for computing the MAC of a command, as a phone would.
+ *
+ * @param[in]  p_key        Credential key, @ref UNLOCK_AUTH_KEY_LEN bytes. Must be in RAM.
+ * @param[in]  p_data       First @ref UNLOCK_AUTH_SIGNED_LEN bytes of the command.
+ * @param[in]  p_challenge  Challenge read from the scan response, @ref UNLOCK_AUTH_CHALLENGE_LEN bytes.
+ * @param[out] p_mac        MAC, @ref UNLOCK_AUTH_MAC_LEN bytes.
+ *
+ * @return NRF_SUCCESS on success, otherwise an nrf_crypto error code.
+ */
+ret_code_t unlock_auth_mac_compute(const uint8_t* p_key, const uint8_t* p_data, const uint8_t* p_challenge, uint8_t* p_mac);
+
+
+#ifdef __cplusplus
+}
+#endif
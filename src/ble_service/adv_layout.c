@@ -0,0 +1,143 @@
+#include "adv_layout.h"
+#include "config.h"
+
+#include <string.h>
+
+#include "app_util.h"
+
+
+#define AD_HEADER_LEN   2       /**< Length and type bytes of each AD structure */
+#define NAME_FITS       ((sizeof(DEVICE_NAME) - 1) <= ADV_SHORT_NAME_LEN)  /**< The device name is advertised whole */
+
+#define MANUF_HEADER_LEN    (AD_HEADER_LEN + 2)  /**< AD header and company identifier of a manufacturer specific data record */
+
+/**@brief Longest encoding of the fields phones filter on: flags, the 128-bit service UUIDs and
+ *        the status in manufacturer specific data */
+#define FILTER_FIELDS_LEN   ((AD_HEADER_LEN + 1) +                                                 \
+                             (AD_HEADER_LEN + 16 * ADV_UUID128_MAX_COUNT) +                        \
+                             (MANUF_HEADER_LEN + ADV_STATUS_MAX_LEN))
+
+/**@brief Longest encoding of the other fields: the short name, the appearance and the
+ *        manufacturer specific data */
+#define SCAN_FIELDS_LEN     ((AD_HEADER_LEN + ADV_SHORT_NAME_LEN) +                                \
+                             (AD_HEADER_LEN + 2) +                                                 \
+                             (MANUF_HEADER_LEN + ADV_MANUF_DATA_MAX_LEN))
+
+// Each packet must fit its PDU with the largest payloads
+#if ADV_EXTENDED_ENABLED
+// A single packet, the status shares the manufacturer specific data record
+STATIC_ASSERT(FILTER_FIELDS_LEN + SCAN_FIELDS_LEN - MANUF_HEADER_LEN <= BLE_GAP_ADV_SET_DATA_SIZE_EXTENDED_CONNECTABLE_MAX_SUPPORTED);
+#else
+STATIC_ASSERT(FILTER_FIELDS_LEN <= BLE_GAP_ADV_SET_DATA_SIZE_MAX);
+STATIC_ASSERT(SCAN_FIELDS_LEN <= BLE_GAP_ADV_SET_DATA_SIZE_MAX);
+#endif
+
+
+static ble_advdata_t              m_advdata;                                    /**< Advertising data */
+static ble_advdata_t              m_srdata;                                     /**< Scan response data */
+static ble_advdata_manuf_data_t   m_manuf_data;                                 /**< Manufacturer specific data of the scan response */
+static uint8_t                    m_manuf_payload[ADV_MANUF_DATA_MAX_LEN + (ADV_EXTENDED_ENABLED ? ADV_STATUS_MAX_LEN : 0)];  /**< Payload of the manufacturer specific data, then the status with extended advertising */
+static uint8_t                    m_manuf_len;                                  /**< Length of the scan response payload */
+static ble_advdata_manuf_data_t   m_status_data;                                /**< Manufacturer specific data of the advertising data, the status */
+static uint8_t                    m_status_payload[ADV_STATUS_MAX_LEN];         /**< Payload of the status */
+static uint8_t                    m_status_len;                                 /**< Length of the status, 0 until adv_layout_status_set */
+static ble_advdata_t*             mp_scan_fields;                               /**< Packet of the name, appearance and manufacturer specific data */
+
+
+/**@brief Function for pointing the packets at the manufacturer specific data records.
+ *
+ * @details With extended advertising there is a single packet, which can only carry one
+ *          record: the status follows the scan response payload, padded to ADV_MANUF_DATA_MAX_LEN
+ *          so the status sits at a fixed offset.
+ */
+static void manuf_records_update(void) {
+    if (ADV_EXTENDED_ENABLED) {
+        if (m_status_len > 0) {
+            memcpy(&m_manuf_payload[ADV_MANUF_DATA_MAX_LEN], m_status_payload, m_status_len);
+            m_manuf_data.data.size = ADV_MANUF_DATA_MAX_LEN + m_status_len;
+        }
+        else {
+            m_manuf_data.data.size = m_manuf_len;
+        }
+        m_advdata.p_manuf_specific_data = &m_manuf_data;
+        return;
+    }
+
+    m_manuf_data.data.size  = m_manuf_len;
+    m_status_data.data.size = m_status_len;
+    if (m_manuf_len > 0) {
+        m_srdata.p_manuf_specific_data = &m_manuf_data;
+    }
+    if (m_status_len > 0) {
+        m_advdata.p_manuf_specific_data = &m_status_data;
+    }
+}
+
+
+ret_code_t adv_layout_init(const ble_uuid_t* p_uuids, unsigned int uuid_count) {
+    if (uuid_count > ADV_UUID128_MAX_COUNT) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    memset(&m_advdata, 0, sizeof(m_advdata));
+    memset(&m_srdata, 0, sizeof(m_srdata));
+
+    m_advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
+    m_advdata.uuids_complete.uuid_cnt = (uint16_t)uuid_count;
+    m_advdata.uuids_complete.p_uuids  = (ble_uuid_t*)p_uuids;
+
+    // Extended connectable advertising has no scan response
+    mp_scan_fields = ADV_EXTENDED_ENABLED ? &m_advdata : &m_srdata;
+
+    // The complete name when it fits, otherwise the shortened name
+    mp_scan_fields->name_type          = NAME_FITS ? BLE_ADVDATA_FULL_NAME : BLE_ADVDATA_SHORT_NAME;
+    mp_scan_fields->short_name_len     = ADV_SHORT_NAME_LEN;
+    mp_scan_fields->include_appearance = true;
+
+    // Empty until adv_layout_manuf_data_set and adv_layout_status_set
+    m_manuf_data.company_identifier  = ADV_COMPANY_IDENTIFIER;
+    m_manuf_data.data.p_data         = m_manuf_payload;
+    m_manuf_data.data.size           = 0;
+    m_manuf_len                      = 0;
+    m_status_data.company_identifier = ADV_COMPANY_IDENTIFIER;
+    m_status_data.data.p_data        = m_status_payload;
+    m_status_data.data.size          = 0;
+    m_status_len                     = 0;
+
+    return NRF_SUCCESS;
+}
+
+
+const ble_advdata_t* adv_layout_advdata_get(void) {
+    return &m_advdata;
+}
+
+
+const ble_advdata_t* adv_layout_srdata_get(void) {
+    return ADV_EXTENDED_ENABLED ? NULL : &m_srdata;
+}
+
+
+ret_code_t adv_layout_manuf_data_set(const uint8_t* p_data, uint8_t len) {
+    if (len > ADV_MANUF_DATA_MAX_LEN) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    memcpy(m_manuf_payload, p_data, len);
+    memset(&m_manuf_payload[len], 0, ADV_MANUF_DATA_MAX_LEN - len);
+    m_manuf_len = len;
+    manuf_records_update();
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t adv_layout_status_set(const uint8_t* p_data, uint8_t len) {
+    if (len > ADV_STATUS_MAX_LEN) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    memcpy(m_status_payload, p_data, len);
+    m_status_len = len;
+    manuf_records_update();
+    return NRF_SUCCESS;
+}
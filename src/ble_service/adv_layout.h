@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ble.h"
+#include "ble_advdata.h"
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Function for initializing the advertising layout.
+ *
+ * @details The advertising packet carries what phones filter on in hardware, the complete list
+ *          of 128-bit service UUIDs, along with the flags and the status, as manufacturer specific
+ *          data under ADV_COMPANY_IDENTIFIER. The name, cut to ADV_SHORT_NAME_LEN, the appearance
+ *          and the other manufacturer specific data go in the scan response. Both packets are
+ *          sized at compile time for the largest payloads.
+ *
+ *          With ADV_EXTENDED_ENABLED the lock advertises connectable extended PDUs, which cannot
+ *          be scanned, so every field goes in the advertising data and there is no scan response.
+ *          The packet then has a single manufacturer specific data record, the status starts
+ *          ADV_MANUF_DATA_MAX_LEN bytes into it.
+ *
+ * @param[in] p_uuids     128-bit service UUIDs, kept by reference.
+ * @param[in] uuid_count  Number of UUIDs, at most ADV_UUID128_MAX_COUNT.
+ *
+ * @return NRF_SUCCESS on success, NRF_ERROR_INVALID_LENGTH if the UUIDs do not fit.
+ */
+ret_code_t adv_layout_init(const ble_uuid_t* p_uuids, unsigned int uuid_count);
+
+
+/**@brief Function for getting the advertising data. */
+const ble_advdata_t* adv_layout_advdata_get(void);
+
+
+/**@brief Function for getting the scan response data, NULL with extended advertising. */
+const ble_advdata_t* adv_layout_srdata_get(void);
+
+
+/**@brief Function for setting the manufacturer specific data of the scan response.
+ *
+ * @param[in] p_data  Payload, after the company identifier.
+ * @param[in] len     Payload length, at most ADV_MANUF_DATA_MAX_LEN.
+ *
+ * @return NRF_SUCCESS on success, NRF_ERROR_INVALID_LENGTH if the payload is too long.
+ */
+ret_code_t adv_layout_manuf_data_set(const uint8_t* p_data, uint8_t len);
+
+
+/**@brief Function for setting the status, the manufacturer specific data of the advertising data.
+ *
+ * @param[in] p_data  Payload, after the company identifier.
+ * @param[in] len     Payload length, at most ADV_STATUS_MAX_LEN.
+ *
+ * @return NRF_SUCCESS on success, NRF_ERROR_INVALID_LENGTH if the payload is too long.
+ */
+ret_code_t adv_layout_status_set(const uint8_t* p_data, uint8_t len);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,430 @@
+#include "adv_policy.h"
+#include "config.h"
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "app_util.h"
+#include "peer_manager.h"
+#include "nrf_log.h"
+#include "time_service/usage_schedule.h"
+
+
+STATIC_ASSERT(APP_ADV_INTERVAL < APP_ADV_SLOW_INTERVAL);
+STATIC_ASSERT(APP_ADV_SLOW_INTERVAL < APP_ADV_ULTRA_SLOW_INTERVAL);
+STATIC_ASSERT(APP_ADV_ULTRA_SLOW_INTERVAL <= BLE_GAP_ADV_INTERVAL_MAX);
+STATIC_ASSERT(APP_ADV_WHITELIST_DURATION < APP_ADV_DURATION);
+
+
+#define TICK_FREQ   (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))  /**< Application timer ticks per second */
+
+
+APP_TIMER_DEF(m_whitelist_timer);   /**< End of the whitelist time slice */
+APP_TIMER_DEF(m_schedule_timer);    /**< Checks the usage schedule while idle */
+
+static ble_advertising_t* mp_advertising;
+static adv_policy_phase_t m_phase;
+static adv_policy_stats_t m_stats;
+static pm_peer_id_t       m_last_peer = PM_PEER_ID_INVALID;    /**< Bonded peer of the last connection, target of directed advertising */
+static uint32_t           m_fast_start;                         /**< Application timer counter at the start of the fast phase */
+
+
+/**@brief Function for listing the bonded peers, skipping the ones without the keys @p skip needs.
+ */
+static uint32_t peer_list(pm_peer_id_t* p_peers, uint32_t max_count, pm_peer_id_list_skip_t skip) {
+    uint32_t count = max_count;
+
+    const ret_code_t err_code = pm_peer_id_list(p_peers, &count, PM_PEER_ID_INVALID, skip);
+    APP_ERROR_CHECK(err_code);
+    return count;
+}
+
+
+/**@brief Function for giving the bonded peers to the peer manager, as the whitelist and as the
+ *        identities the SoftDevice resolves private addresses with.
+ *
+ * @details Only called while not advertising, the SoftDevice refuses changes to a whitelist in
+ *          use.
+ */
+static void bonds_apply(void) {
+    pm_peer_id_t peers[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+    uint32_t     count;
+    ret_code_t   err_code;
+
+    count    = peer_list(peers, ARRAY_SIZE(peers), PM_PEER_ID_LIST_SKIP_NO_ID_ADDR);
+    err_code = pm_whitelist_set((count > 0) ? peers : NULL, count);
+    APP_ERROR_CHECK(err_code);
+
+    // Directed advertising to a phone using a private address needs its IRK
+    count    = peer_list(peers, ARRAY_SIZE(peers), PM_PEER_ID_LIST_SKIP_NO_IRK);
+    err_code = pm_device_identities_list_set((count > 0) ? peers : NULL, count);
+    if (err_code != NRF_ERROR_NOT_SUPPORTED) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for answering the advertising module with the address of the last bonded
+ *        peer. Without an answer, the directed phases are skipped.
+ */
+static void peer_addr_reply(void) {
+    pm_peer_data_bonding_t bonding;
+
+    if (m_last_peer == PM_PEER_ID_INVALID) {
+        return;
+    }
+
+    const ret_code_t err_code = pm_peer_data_bonding_load(m_last_peer, &bonding);
+    if (err_code == NRF_ERROR_NOT_FOUND) {
+        // Deleted since
+        m_last_peer = PM_PEER_ID_INVALID;
+        return;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    const uint32_t reply_err_code = ble_advertising_peer_addr_reply(mp_advertising, &bonding.peer_ble_id.id_addr_info);
+    APP_ERROR_CHECK(reply_err_code);
+}
+
+
+/**@brief Function for answering the advertising module with the bonded peers. An empty whitelist
+ *        makes it advertise to everybody.
+ */
+static void whitelist_reply(void) {
+    ble_gap_addr_t addrs[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+    ble_gap_irk_t  irks[BLE_GAP_WHITELIST_ADDR_MAX_COUNT];
+    uint32_t       addr_count = ARRAY_SIZE(addrs);
+    uint32_t       irk_count  = ARRAY_SIZE(irks);
+    ret_code_t     err_code;
+
+    err_code = pm_whitelist_get(addrs, &addr_count, irks, &irk_count);
+    APP_ERROR_CHECK(err_code);
+
+    err_code = ble_advertising_whitelist_reply(mp_advertising, addrs, addr_count, irks, irk_count);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for opening advertising to everybody, until the next disconnection.
+ *
+ * @details The advertising module restarts its current mode. Out of the whitelist time slice,
+ *          the fast phase only gets what is left of APP_ADV_DURATION, its timeout is put back
+ *          right after for the next start. The idle phases run as the slow mode, which restarts
+ *          with the slow parameters, so they become the slow phase until it times out.
+ */
+static ret_code_t whitelist_off(void) {
+    ble_adv_modes_config_t config;
+
+    ret_code_t err_code = app_timer_stop(m_whitelist_timer);
+    APP_ERROR_CHECK(err_code);
+
+    if (m_phase != ADV_POLICY_PHASE_WHITELIST) {
+        // Set first, the slow event is raised from within the restart
+        if (m_phase == ADV_POLICY_PHASE_HABITUAL || m_phase == ADV_POLICY_PHASE_ULTRA_SLOW) {
+            m_phase = ADV_POLICY_PHASE_SLOW;
+        }
+        return ble_advertising_restart_without_whitelist(mp_advertising);
+    }
+
+    // In the 10 ms units of the advertising durations
+    const uint32_t ticks   = app_timer_cnt_diff_compute(app_timer_cnt_get(), m_fast_start);
+    const uint32_t elapsed = (uint32_t)(((uint64_t)ticks * 100) / TICK_FREQ);
+
+    adv_policy_modes_config_get(&config);
+    config.ble_adv_fast_timeout = (elapsed < APP_ADV_DURATION) ? (APP_ADV_DURATION - elapsed) : 1;
+    ble_advertising_modes_config_set(mp_advertising, &config);
+
+    err_code = ble_advertising_restart_without_whitelist(mp_advertising);
+
+    adv_policy_modes_config_get(&config);
+    ble_advertising_modes_config_set(mp_advertising, &config);
+    return err_code;
+}
+
+
+/**@brief Function for ending the whitelist time slice.
+ *
+ * @param[in] p_context  Unused.
+ */
+static void whitelist_timeout(void* p_context) {
+    if (m_phase != ADV_POLICY_PHASE_WHITELIST) {
+        return;
+    }
+
+    const ret_code_t err_code = whitelist_off();
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for starting the idle phase, once the slow one timed out: habitual in a
+ *        habitual arrival window of the usage schedule, ultra-slow otherwise.
+ *
+ * @details The advertising module has no third phase, so it runs as a slow phase without a
+ *          timeout. The fast and slow phases are put back right after, for the next start.
+ */
+static void idle_start(void) {
+    ble_adv_modes_config_t config;
+
+    const bool habitual = usage_schedule_is_habitual();
+
+    adv_policy_modes_config_get(&config);
+    config.ble_adv_slow_interval = habitual ? APP_ADV_INTERVAL : APP_ADV_ULTRA_SLOW_INTERVAL;
+    config.ble_adv_slow_timeout  = BLE_GAP_ADV_TIMEOUT_GENERAL_UNLIMITED;
+    ble_advertising_modes_config_set(mp_advertising, &config);
+
+    // Set first, the slow event is raised from within ble_advertising_start
+    m_phase = habitual ? ADV_POLICY_PHASE_HABITUAL : ADV_POLICY_PHASE_ULTRA_SLOW;
+    const ret_code_t err_code = ble_advertising_start(mp_advertising, BLE_ADV_MODE_SLOW);
+
+    adv_policy_modes_config_get(&config);
+    ble_advertising_modes_config_set(mp_advertising, &config);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for switching the idle phase when a habitual arrival window starts or ends.
+ *
+ * @param[in] p_context  Unused.
+ */
+static void schedule_timeout(void* p_context) {
+    if (m_phase != ADV_POLICY_PHASE_HABITUAL && m_phase != ADV_POLICY_PHASE_ULTRA_SLOW) {
+        return;
+    }
+    if (usage_schedule_is_habitual() == (m_phase == ADV_POLICY_PHASE_HABITUAL)) {
+        return;
+    }
+
+    const ret_code_t err_code = sd_ble_gap_adv_stop(mp_advertising->adv_handle);
+    if (err_code != NRF_ERROR_INVALID_STATE) {
+        APP_ERROR_CHECK(err_code);
+    }
+    idle_start();
+}
+
+
+/**@brief Function for recording the bonded peer of a new connection as the last one.
+ */
+static void last_peer_set(pm_peer_id_t peer_id) {
+    if (peer_id == m_last_peer) {
+        return;
+    }
+    m_last_peer = peer_id;
+
+    // Kept in flash, so directed advertising still targets it after a reset
+    const ret_code_t err_code = pm_peer_rank_highest(peer_id);
+    if (err_code != NRF_ERROR_BUSY && err_code != NRF_ERROR_RESOURCES && err_code != NRF_ERROR_STORAGE_FULL) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+void adv_policy_modes_config_get(ble_adv_modes_config_t* p_config) {
+    memset(p_config, 0, sizeof(*p_config));
+
+    p_config->ble_adv_whitelist_enabled          = true;
+    // High duty directed advertising only exists as a legacy PDU, extended starts at low duty
+    p_config->ble_adv_directed_high_duty_enabled = !ADV_EXTENDED_ENABLED;
+    p_config->ble_adv_directed_enabled           = true;
+    p_config->ble_adv_directed_interval          = APP_ADV_DIRECTED_INTERVAL;
+    p_config->ble_adv_directed_timeout           = APP_ADV_DIRECTED_DURATION;
+    p_config->ble_adv_fast_enabled               = true;
+    p_config->ble_adv_fast_interval              = APP_ADV_INTERVAL;
+    p_config->ble_adv_fast_timeout               = APP_ADV_DURATION;
+    p_config->ble_adv_slow_enabled               = true;
+    p_config->ble_adv_slow_interval              = APP_ADV_SLOW_INTERVAL;
+    p_config->ble_adv_slow_timeout               = APP_ADV_SLOW_DURATION;
+    p_config->ble_adv_extended_enabled           = ADV_EXTENDED_ENABLED;
+    p_config->ble_adv_primary_phy                = BLE_GAP_PHY_1MBPS;
+    p_config->ble_adv_secondary_phy              = BLE_GAP_PHY_1MBPS;
+}
+
+
+void adv_policy_init(ble_advertising_t* p_advertising) {
+    mp_advertising = p_advertising;
+    m_phase        = ADV_POLICY_PHASE_NONE;
+
+    ret_code_t err_code = app_timer_create(&m_whitelist_timer, APP_TIMER_MODE_SINGLE_SHOT, whitelist_timeout);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_create(&m_schedule_timer, APP_TIMER_MODE_REPEATED, schedule_timeout);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_start(m_schedule_timer, APP_TIMER_TICKS(APP_ADV_SCHEDULE_CHECK_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+void adv_policy_bonds_load(void) {
+    pm_peer_id_t lowest_peer;
+    uint32_t     highest_rank;
+    uint32_t     lowest_rank;
+
+    const ret_code_t err_code = pm_peer_ranks_get(&m_last_peer, &highest_rank, &lowest_peer, &lowest_rank);
+    if (err_code == NRF_ERROR_NOT_FOUND) {
+        m_last_peer = PM_PEER_ID_INVALID;
+    }
+    else {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    bonds_apply();
+}
+
+
+bool adv_policy_on_adv_evt(ble_adv_evt_t ble_adv_evt) {
+    ret_code_t err_code;
+
+    switch (ble_adv_evt) {
+        case BLE_ADV_EVT_PEER_ADDR_REQUEST:
+            peer_addr_reply();
+            return false;
+
+        case BLE_ADV_EVT_WHITELIST_REQUEST:
+            whitelist_reply();
+            return false;
+
+        case BLE_ADV_EVT_DIRECTED_HIGH_DUTY:
+        case BLE_ADV_EVT_DIRECTED:
+            m_phase = ADV_POLICY_PHASE_DIRECTED;
+            ++m_stats.directed;
+            break;
+
+        case BLE_ADV_EVT_FAST_WHITELIST:
+            m_phase      = ADV_POLICY_PHASE_WHITELIST;
+            m_fast_start = app_timer_cnt_get();
+            ++m_stats.whitelist;
+
+            err_code = app_timer_start(m_whitelist_timer, APP_TIMER_TICKS(APP_ADV_WHITELIST_DURATION * 10), NULL);
+            APP_ERROR_CHECK(err_code);
+            break;
+
+        case BLE_ADV_EVT_FAST:
+            m_phase = ADV_POLICY_PHASE_FAST;
+            ++m_stats.fast;
+            break;
+
+        case BLE_ADV_EVT_SLOW:
+        case BLE_ADV_EVT_SLOW_WHITELIST:
+            if (m_phase == ADV_POLICY_PHASE_HABITUAL) {
+                ++m_stats.habitual;
+            }
+            else if (m_phase == ADV_POLICY_PHASE_ULTRA_SLOW) {
+                ++m_stats.ultra_slow;
+            }
+            else {
+                m_phase = ADV_POLICY_PHASE_SLOW;
+                ++m_stats.slow;
+            }
+            break;
+
+        case BLE_ADV_EVT_IDLE:
+            idle_start();
+            return false;
+
+        default:
+            return true;
+    }
+
+    NRF_LOG_INFO("Advertising: %s", adv_policy_phase_name(m_phase));
+    return true;
+}
+
+
+void adv_policy_on_ble_evt(const ble_evt_t* p_ble_evt) {
+    if (p_ble_evt->header.evt_id != BLE_GAP_EVT_CONNECTED) {
+        return;
+    }
+
+    if (m_phase == ADV_POLICY_PHASE_DIRECTED) {
+        ++m_stats.directed_connections;
+    }
+    else if (m_phase == ADV_POLICY_PHASE_WHITELIST) {
+        ++m_stats.whitelist_connections;
+    }
+
+    // Advertising stops, and starts over with the directed phases on disconnection
+    m_phase = ADV_POLICY_PHASE_NONE;
+    const ret_code_t err_code = app_timer_stop(m_whitelist_timer);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+void adv_policy_on_pm_evt(const pm_evt_t* p_evt) {
+    switch (p_evt->evt_id) {
+        case PM_EVT_BONDED_PEER_CONNECTED:
+        case PM_EVT_CONN_SEC_SUCCEEDED:
+            last_peer_set(p_evt->peer_id);
+            break;
+
+        case PM_EVT_PEER_DATA_UPDATE_SUCCEEDED:
+            // A new bond, applied while connected so before advertising starts again
+            if (p_evt->params.peer_data_update_succeeded.data_id == PM_PEER_DATA_ID_BONDING &&
+                p_evt->params.peer_data_update_succeeded.flash_changed) {
+                bonds_apply();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+ret_code_t adv_policy_wake(void) {
+    if (m_phase == ADV_POLICY_PHASE_NONE) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    ret_code_t err_code = sd_ble_gap_adv_stop(mp_advertising->adv_handle);
+    if (err_code != NRF_ERROR_INVALID_STATE) {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    ++m_stats.wakes;
+    err_code = ble_advertising_start(mp_advertising, BLE_ADV_MODE_FAST);
+    APP_ERROR_CHECK(err_code);
+    return NRF_SUCCESS;
+}
+
+
+ret_code_t adv_policy_whitelist_off(void) {
+    if (m_phase == ADV_POLICY_PHASE_NONE) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+    return whitelist_off();
+}
+
+
+adv_policy_phase_t adv_policy_phase_get(void) {
+    return m_phase;
+}
+
+
+const adv_policy_stats_t* adv_policy_stats_get(void) {
+    return &m_stats;
+}
+
+
+const char* adv_policy_phase_name(adv_policy_phase_t phase) {
+    switch (phase) {
+        case ADV_POLICY_PHASE_DIRECTED:
+            return "directed";
+
+        case ADV_POLICY_PHASE_WHITELIST:
+            return "whitelist";
+
+        case ADV_POLICY_PHASE_FAST:
+            return "fast";
+
+        case ADV_POLICY_PHASE_SLOW:
+            return "slow";
+
+        case ADV_POLICY_PHASE_HABITUAL:
+            return "habitual";
+
+        case ADV_POLICY_PHASE_ULTRA_SLOW:
+            return "ultra-slow";
+
+        default:
+            return "none";
+    }
+}
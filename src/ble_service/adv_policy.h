@@ -0,0 +1,136 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ble.h"
+#include "ble_advertising.h"
+#include "peer_manager_types.h"
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Advertising phases, from the most to the least responsive */
+typedef enum {
+    ADV_POLICY_PHASE_NONE,          /**< Not advertising, connected or not started yet */
+    ADV_POLICY_PHASE_DIRECTED,      /**< Directed to the last bonded peer, high duty and then APP_ADV_DIRECTED_INTERVAL for APP_ADV_DIRECTED_DURATION */
+    ADV_POLICY_PHASE_WHITELIST,     /**< APP_ADV_INTERVAL to the bonded peers only, for APP_ADV_WHITELIST_DURATION */
+    ADV_POLICY_PHASE_FAST,          /**< APP_ADV_INTERVAL for APP_ADV_DURATION */
+    ADV_POLICY_PHASE_SLOW,          /**< APP_ADV_SLOW_INTERVAL for APP_ADV_SLOW_DURATION */
+    ADV_POLICY_PHASE_HABITUAL,      /**< APP_ADV_INTERVAL in a habitual arrival window of the usage schedule, until it ends, a connection or a wake */
+    ADV_POLICY_PHASE_ULTRA_SLOW     /**< APP_ADV_ULTRA_SLOW_INTERVAL outside habitual arrival windows, until a connection or a wake */
+} adv_policy_phase_t;
+
+/**@brief Advertising policy counters, since boot */
+typedef struct {
+    uint32_t directed;              /**< Directed phases started */
+    uint32_t whitelist;             /**< Whitelist phases started */
+    uint32_t fast;                  /**< Fast phases started */
+    uint32_t slow;                  /**< Slow phases started */
+    uint32_t habitual;              /**< Habitual phases started */
+    uint32_t ultra_slow;            /**< Ultra-slow phases started */
+    uint32_t wakes;                 /**< Button wakes back to the fast phase */
+    uint32_t directed_connections;  /**< Connections made during a directed phase */
+    uint32_t whitelist_connections; /**< Connections made during a whitelist phase */
+} adv_policy_stats_t;
+
+
+/**@brief Function for getting the directed, fast and slow phases, for ble_advertising_init.
+ *
+ * @param[out] p_config  Advertising modes configuration.
+ */
+void adv_policy_modes_config_get(ble_adv_modes_config_t* p_config);
+
+
+/**@brief Function for initializing the advertising policy, after ble_advertising_init.
+ *
+ * @details The advertising module first advertises directed to the last bonded peer, so a phone
+ *          coming back reconnects within a few connection events. It then runs the fast phase,
+ *          to the bonded peers only for its first APP_ADV_WHITELIST_DURATION and then to
+ *          everybody, and then the slow one. When the slow one times out, the policy goes on
+ *          advertising without a timeout instead of letting advertising stop, so the lock can
+ *          always be reached: at APP_ADV_INTERVAL in the habitual arrival windows learned by the
+ *          usage schedule, at APP_ADV_ULTRA_SLOW_INTERVAL otherwise. The schedule is checked every
+ *          APP_ADV_SCHEDULE_CHECK_MS. A disconnection starts over with
+ *          the directed phase, a wake with the fast one. Phases without a bonded peer to target
+ *          are skipped.
+ *
+ * @param[in] p_advertising  Advertising module instance.
+ */
+void adv_policy_init(ble_advertising_t* p_advertising);
+
+
+/**@brief Function for handling advertising events, called for every event.
+ *
+ * @param[in] ble_adv_evt  Advertising event.
+ *
+ * @return False for BLE_ADV_EVT_IDLE, which is taken over by the idle phases, and for the
+ *         peer address and whitelist requests, which are answered here, true otherwise.
+ */
+bool adv_policy_on_adv_evt(ble_adv_evt_t ble_adv_evt);
+
+
+/**@brief Function for loading the last bonded peer and the whitelist, after the peer manager is
+ *        initialized and before advertising starts.
+ */
+void adv_policy_bonds_load(void);
+
+
+/**@brief Function for handling BLE events, called for every event.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ */
+void adv_policy_on_ble_evt(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Function for handling peer manager events, called for every event.
+ *
+ * @details A bonded peer that connects becomes the target of directed advertising, and is ranked
+ *          highest so it still is after a reset. New bonds update the whitelist, deleted ones are
+ *          dropped by adv_policy_bonds_load when advertising starts again.
+ *
+ * @param[in] p_evt  Peer manager event.
+ */
+void adv_policy_on_pm_evt(const pm_evt_t* p_evt);
+
+
+/**@brief Function for going back to the fast phase, e.g. on a button press.
+ *
+ * @details Ignored while connected. The fast phase starts over also if it is already running.
+ *
+ * @return NRF_SUCCESS, or NRF_ERROR_INVALID_STATE if not advertising.
+ */
+ret_code_t adv_policy_wake(void);
+
+
+/**@brief Function for ending the whitelist phase early, e.g. on a button press, so a phone
+ *        that is not bonded yet can connect.
+ *
+ * @details Advertising is open to everybody until the next disconnection. From the habitual or
+ *          ultra-slow phase, it goes back to the slow phase, which then times out into the idle
+ *          phase again.
+ *
+ * @return NRF_SUCCESS, NRF_ERROR_INVALID_STATE if not advertising, otherwise an error code.
+ */
+ret_code_t adv_policy_whitelist_off(void);
+
+
+/**@brief Function for getting the current advertising phase. */
+adv_policy_phase_t adv_policy_phase_get(void);
+
+
+/**@brief Function for getting the advertising policy counters. */
+const adv_policy_stats_t* adv_policy_stats_get(void);
+
+
+/**@brief Function for getting the name of a phase, for logs and reports. */
+const char* adv_policy_phase_name(adv_policy_phase_t phase);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,6 +7,8 @@
 #include "bsp_config.h"
 #include "boards.h"
 #include "nrf_log.h"
+#include "diag_service/probe.h"
+#include "diag_service/unlock_latency.h"
 
 
 /**@brief Function for adding the Door locked characteristic.
@@ -23,6 +25,7 @@ static uint32_t lock_state_request_char_add(ble_dls_t* p_dls, const ble_dls_init
     ble_gatts_attr_t    attr_char_value;
     ble_uuid_t          ble_uuid;
     ble_gatts_attr_md_t attr_md;
+    uint8_t             initial_lock_state = p_dls_init->initial_lock_state_value;
 
     memset(&cccd_md, 0, sizeof(cccd_md));
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
@@ -32,7 +35,6 @@ static uint32_t lock_state_request_char_add(ble_dls_t* p_dls, const ble_dls_init
 
     memset(&char_md, 0, sizeof(char_md));
     char_md.char_props.read   = 1;
-    char_md.char_props.write  = 1;
     char_md.char_props.notify = 1; 
     char_md.p_char_user_desc  = NULL;
     char_md.p_char_pf         = NULL;
@@ -57,7 +59,7 @@ static uint32_t lock_state_request_char_add(ble_dls_t* p_dls, const ble_dls_init
     attr_char_value.init_len  = sizeof(uint8_t);
     attr_char_value.init_offs = 0;
     attr_char_value.max_len   = sizeof(uint8_t);
-    attr_char_value.p_value   = &p_dls_init->initial_lock_state_value;
+    attr_char_value.p_value   = &initial_lock_state;
 
     err_code = sd_ble_gatts_characteristic_add(p_dls->service_handle,
                                                &char_md,
@@ -71,8 +73,184 @@ static uint32_t lock_state_request_char_add(ble_dls_t* p_dls, const ble_dls_init
 }
 
 
+/**@brief Function for adding a read-only diagnostic characteristic.
+ *
+ * @param[in]   p_dls        Door Lock Service structure.
+ * @param[in]   p_dls_init   Information needed to initialize the service.
+ * @param[in]   uuid         16-bit UUID of the characteristic.
+ * @param[in]   notify       True if the characteristic can be notified.
+ * @param[out]  p_handles    Handles of the characteristic.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t diag_char_add(ble_dls_t* p_dls, const ble_dls_init_t* p_dls_init, uint16_t uuid, bool notify,
+                              ble_gatts_char_handles_t* p_handles) {
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_md_t cccd_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&cccd_md, 0, sizeof(cccd_md));
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&cccd_md.read_perm);
+    cccd_md.write_perm = p_dls_init->diag_char_attr_md.cccd_write_perm;
+    cccd_md.vloc       = BLE_GATTS_VLOC_STACK;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.read   = 1;
+    char_md.char_props.notify = notify ? 1 : 0;
+    char_md.p_cccd_md         = notify ? &cccd_md : NULL;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    attr_md.read_perm = p_dls_init->diag_char_attr_md.read_perm;
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.write_perm);
+    attr_md.vloc      = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen      = 1;
+
+    ble_uuid.type = p_dls->uuid_type;
+    ble_uuid.uuid = uuid;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = 0;
+    attr_char_value.max_len   = BLE_DLS_DIAG_MAX_LEN;
+
+    return sd_ble_gatts_characteristic_add(p_dls->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           p_handles);
+}
+
+
+/**@brief Function for adding the command characteristic.
+ *
+ * @details Write without response only, so a command costs a single packet. The value is not
+ *          readable, the last command stays in the attribute table.
+ *
+ * @param[in]   p_dls        Door Lock Service structure.
+ * @param[in]   p_dls_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t command_char_add(ble_dls_t* p_dls, const ble_dls_init_t* p_dls_init) {
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.write_wo_resp = 1;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    attr_md.write_perm = p_dls_init->command_write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen       = 1;
+
+    ble_uuid.type = p_dls->uuid_type;
+    ble_uuid.uuid = DLS_UUID_COMMAND_CHAR;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = 0;
+    attr_char_value.max_len   = BLE_DLS_COMMAND_MAX_LEN;
+
+    return sd_ble_gatts_characteristic_add(p_dls->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dls->command_handles);
+}
+
+
+/**@brief Function for adding the local time characteristic.
+ *
+ * @details Write only, with response. Phones write the local time when they connect, the lock
+ *          has no other way to know it.
+ *
+ * @param[in]   p_dls        Door Lock Service structure.
+ * @param[in]   p_dls_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t time_char_add(ble_dls_t* p_dls, const ble_dls_init_t* p_dls_init) {
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.write = 1;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    attr_md.write_perm = p_dls_init->time_write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_STACK;
+    attr_md.vlen       = 0;
+
+    ble_uuid.type = p_dls->uuid_type;
+    ble_uuid.uuid = DLS_UUID_TIME_CHAR;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = BLE_DLS_TIME_LEN;
+    attr_char_value.max_len   = BLE_DLS_TIME_LEN;
+
+    return sd_ble_gatts_characteristic_add(p_dls->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dls->time_handles);
+}
+
+
+/**@brief Function for adding the long command characteristic.
+ *
+ * @details Written with response. The value lives in p_dls->long_command and write
+ *          authorization is required, so the Queued Write module gets the Execute Write Request
+ *          of a long write and a single Write Request is raised as an authorization request.
+ *
+ * @param[in]   p_dls        Door Lock Service structure.
+ * @param[in]   p_dls_init   Information needed to initialize the service.
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+static uint32_t long_command_char_add(ble_dls_t* p_dls, const ble_dls_init_t* p_dls_init) {
+    ble_gatts_char_md_t char_md;
+    ble_gatts_attr_t    attr_char_value;
+    ble_uuid_t          ble_uuid;
+    ble_gatts_attr_md_t attr_md;
+
+    memset(&char_md, 0, sizeof(char_md));
+    char_md.char_props.write = 1;
+
+    memset(&attr_md, 0, sizeof(attr_md));
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&attr_md.read_perm);
+    attr_md.write_perm = p_dls_init->long_command_write_perm;
+    attr_md.vloc       = BLE_GATTS_VLOC_USER;
+    attr_md.wr_auth    = 1;
+    attr_md.vlen       = 1;
+
+    ble_uuid.type = p_dls->uuid_type;
+    ble_uuid.uuid = DLS_UUID_LONG_COMMAND_CHAR;
+
+    memset(&attr_char_value, 0, sizeof(attr_char_value));
+    attr_char_value.p_uuid    = &ble_uuid;
+    attr_char_value.p_attr_md = &attr_md;
+    attr_char_value.init_len  = 0;
+    attr_char_value.max_len   = BLE_DLS_LONG_COMMAND_MAX_LEN;
+    attr_char_value.p_value   = p_dls->long_command;
+
+    return sd_ble_gatts_characteristic_add(p_dls->service_handle,
+                                           &char_md,
+                                           &attr_char_value,
+                                           &p_dls->long_command_handles);
+}
+
+
 uint32_t ble_dls_init(ble_dls_t* p_dls, const ble_dls_init_t* p_dls_init) {
-    if (p_dls == NULL || p_dls_init == NULL) {
+    if (p_dls == NULL || p_dls_init == NULL || p_dls_init->p_qwr == NULL) {
         return NRF_ERROR_NULL;
     }
 
@@ -97,16 +275,60 @@ uint32_t ble_dls_init(ble_dls_t* p_dls, const ble_dls_init_t* p_dls_init) {
         return err_code;
     }
 
-    return lock_state_request_char_add(p_dls, p_dls_init);
+    err_code = lock_state_request_char_add(p_dls, p_dls_init);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = diag_char_add(p_dls, p_dls_init, DLS_UUID_DIAG_CHAR, true, &p_dls->diag_handles);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = diag_char_add(p_dls, p_dls_init, DLS_UUID_RAM_USAGE_CHAR, false, &p_dls->ram_usage_handles);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = command_char_add(p_dls, p_dls_init);
+    VERIFY_SUCCESS(err_code);
+
+    // Same layout as the diagnostics: read and notify, not writable
+    err_code = diag_char_add(p_dls, p_dls_init, DLS_UUID_ACK_CHAR, true, &p_dls->ack_handles);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = time_char_add(p_dls, p_dls_init);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = long_command_char_add(p_dls, p_dls_init);
+    VERIFY_SUCCESS(err_code);
+
+    err_code = nrf_ble_qwr_attr_register(p_dls_init->p_qwr, p_dls->long_command_handles.value_handle);
+    VERIFY_SUCCESS(err_code);
+
+    // Responses are short, same layout as the acknowledgement
+    return diag_char_add(p_dls, p_dls_init, DLS_UUID_RESPONSE_CHAR, true, &p_dls->response_handles);
 }
 
 
-uint32_t ble_dls_lock_state_set(ble_dls_t* p_dls, uint8_t lock_state_value) {
-    if (p_dls == NULL) {
-        return NRF_ERROR_NULL;
+/**@brief Function for queueing a notification, counting it until it is transmitted.
+ *
+ * @param[in]   p_dls        Door Lock Service structure
+ * @param[in]   p_hvx_params Notification
+ *
+ * @return      Result of sd_ble_gatts_hvx.
+ */
+static uint32_t notification_send(ble_dls_t* p_dls, const ble_gatts_hvx_params_t* p_hvx_params) {
+    const uint32_t err_code = sd_ble_gatts_hvx(p_dls->conn_handle, p_hvx_params);
+    if (err_code == NRF_SUCCESS) {
+        ++p_dls->hvx_pending;
     }
+    return err_code;
+}
 
-    uint32_t err_code = NRF_SUCCESS;
+
+/**@brief Function for storing the door lock value in the attribute table.
+ *
+ * @param[in]   p_dls             Door Lock Service structure
+ * @param[in]   lock_state_value  Door lock state value
+ *
+ * @return      Result of sd_ble_gatts_value_set.
+ */
+static uint32_t lock_state_store(ble_dls_t* p_dls, uint8_t lock_state_value) {
     ble_gatts_value_t gatts_value;
 
     // Initialize value struct
@@ -116,28 +338,54 @@ uint32_t ble_dls_lock_state_set(ble_dls_t* p_dls, uint8_t lock_state_value) {
     gatts_value.p_value = &lock_state_value;
 
     // Update database
-    err_code = sd_ble_gatts_value_set(p_dls->conn_handle,
-                                      p_dls->lock_state_handles.value_handle,
-                                      &gatts_value);
-    if (err_code != NRF_SUCCESS) {
-        return err_code;
+    return sd_ble_gatts_value_set(p_dls->conn_handle,
+                                  p_dls->lock_state_handles.value_handle,
+                                  &gatts_value);
+}
+
+
+/**@brief Function for notifying the door lock value if connected.
+ *
+ * @param[in]   p_dls             Door Lock Service structure
+ * @param[in]   lock_state_value  Door lock state value
+ *
+ * @return      NRF_SUCCESS if sent or not connected, otherwise the result of sd_ble_gatts_hvx.
+ */
+static uint32_t lock_state_notify(ble_dls_t* p_dls, uint8_t lock_state_value) {
+    if (p_dls->conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return NRF_SUCCESS;
     }
 
-    // Send value if connected and notifying
-    if ((p_dls->conn_handle != BLE_CONN_HANDLE_INVALID)) {
-        ble_gatts_hvx_params_t hvx_params;
+    ble_gatts_hvx_params_t hvx_params;
+    uint16_t               len = sizeof(uint8_t);
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
 
-        memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle = p_dls->lock_state_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &len;
+    hvx_params.p_data = &lock_state_value;
+
+    return notification_send(p_dls, &hvx_params);
+}
 
-        hvx_params.handle = p_dls->lock_state_handles.value_handle;
-        hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
-        hvx_params.offset  = gatts_value.offset;
-        hvx_params.p_len  = &gatts_value.len;
-        hvx_params.p_data = gatts_value.p_value;
 
-        err_code = sd_ble_gatts_hvx(p_dls->conn_handle, &hvx_params);
+uint32_t ble_dls_lock_state_set(ble_dls_t* p_dls, uint8_t lock_state_value) {
+    if (p_dls == NULL) {
+        return NRF_ERROR_NULL;
     }
 
+    PROBE_BEGIN(probe_start);
+    uint32_t err_code = lock_state_store(p_dls, lock_state_value);
+    if (err_code != NRF_SUCCESS) {
+        PROBE_END(PROBE_DLS_LOCK_STATE_SET, probe_start);
+        return err_code;
+    }
+
+    // The characteristic holds the new state, so the door follows it even if the notification fails
+    err_code = lock_state_notify(p_dls, lock_state_value);
+
     // Send write signal
     if (p_dls->evt_handler != NULL) {
         ble_dls_evt_t evt;
@@ -145,10 +393,24 @@ uint32_t ble_dls_lock_state_set(ble_dls_t* p_dls, uint8_t lock_state_value) {
         p_dls->evt_handler(p_dls, &evt);
     }
   
+    PROBE_END(PROBE_DLS_LOCK_STATE_SET, probe_start);
     return err_code;
 }
 
+uint32_t ble_dls_lock_state_report(ble_dls_t* p_dls, uint8_t lock_state_value) {
+    if (p_dls == NULL) {
+        return NRF_ERROR_NULL;
+    }
+
+    const uint32_t err_code = lock_state_store(p_dls, lock_state_value);
+    VERIFY_SUCCESS(err_code);
+
+    return lock_state_notify(p_dls, lock_state_value);
+}
+
+
 uint32_t ble_dls_lock_state_get(ble_dls_t* p_dls, uint8_t* p_lock_state_value) {
+    PROBE_BEGIN(probe_start);
     uint32_t err_code = NRF_SUCCESS;
     ble_gatts_value_t gatts_value;
 
@@ -163,10 +425,150 @@ uint32_t ble_dls_lock_state_get(ble_dls_t* p_dls, uint8_t* p_lock_state_value) {
                                       p_dls->lock_state_handles.value_handle,
                                       &gatts_value);
 
+    PROBE_END(PROBE_DLS_LOCK_STATE_GET, probe_start);
     return err_code;
 }
 
 
+uint32_t ble_dls_diag_send(ble_dls_t* p_dls, const uint8_t* p_data, uint16_t len) {
+    if (p_dls == NULL || p_data == NULL) {
+        return NRF_ERROR_NULL;
+    }
+    if (len > BLE_DLS_DIAG_MAX_LEN) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    uint32_t err_code;
+    ble_gatts_value_t gatts_value;
+
+    // Keep the latest record readable
+    memset(&gatts_value, 0, sizeof(gatts_value));
+    gatts_value.len     = len;
+    gatts_value.offset  = 0;
+    gatts_value.p_value = (uint8_t*)p_data;
+
+    err_code = sd_ble_gatts_value_set(p_dls->conn_handle,
+                                      p_dls->diag_handles.value_handle,
+                                      &gatts_value);
+    VERIFY_SUCCESS(err_code);
+
+    if (p_dls->conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    ble_gatts_hvx_params_t hvx_params;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle = p_dls->diag_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &gatts_value.len;
+    hvx_params.p_data = gatts_value.p_value;
+
+    return notification_send(p_dls, &hvx_params);
+}
+
+
+uint32_t ble_dls_ack_send(ble_dls_t* p_dls, uint16_t seq, ble_dls_ack_result_t result, bool locked) {
+    if (p_dls == NULL) {
+        return NRF_ERROR_NULL;
+    }
+
+    uint32_t          err_code;
+    uint8_t           ack[BLE_DLS_ACK_LEN];
+    ble_gatts_value_t gatts_value;
+
+    uint16_encode(seq, &ack[0]);
+    ack[2] = (uint8_t)result;
+    ack[3] = locked ? 1 : 0;
+
+    // Readable too, for a peer that does not subscribe
+    memset(&gatts_value, 0, sizeof(gatts_value));
+    gatts_value.len     = sizeof(ack);
+    gatts_value.offset  = 0;
+    gatts_value.p_value = ack;
+
+    err_code = sd_ble_gatts_value_set(p_dls->conn_handle,
+                                      p_dls->ack_handles.value_handle,
+                                      &gatts_value);
+    VERIFY_SUCCESS(err_code);
+
+    if (p_dls->conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    ble_gatts_hvx_params_t hvx_params;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle = p_dls->ack_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &gatts_value.len;
+    hvx_params.p_data = gatts_value.p_value;
+
+    return notification_send(p_dls, &hvx_params);
+}
+
+
+uint32_t ble_dls_response_send(ble_dls_t* p_dls, const uint8_t* p_data, uint16_t len) {
+    if (p_dls == NULL || p_data == NULL) {
+        return NRF_ERROR_NULL;
+    }
+    if (len > BLE_DLS_RESPONSE_MAX_LEN) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    uint32_t err_code;
+    ble_gatts_value_t gatts_value;
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+    gatts_value.len     = len;
+    gatts_value.offset  = 0;
+    gatts_value.p_value = (uint8_t*)p_data;
+
+    err_code = sd_ble_gatts_value_set(p_dls->conn_handle,
+                                      p_dls->response_handles.value_handle,
+                                      &gatts_value);
+    VERIFY_SUCCESS(err_code);
+
+    if (p_dls->conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return NRF_ERROR_INVALID_STATE;
+    }
+
+    ble_gatts_hvx_params_t hvx_params;
+
+    memset(&hvx_params, 0, sizeof(hvx_params));
+    hvx_params.handle = p_dls->response_handles.value_handle;
+    hvx_params.type   = BLE_GATT_HVX_NOTIFICATION;
+    hvx_params.offset = 0;
+    hvx_params.p_len  = &gatts_value.len;
+    hvx_params.p_data = gatts_value.p_value;
+
+    return notification_send(p_dls, &hvx_params);
+}
+
+
+uint32_t ble_dls_ram_usage_set(ble_dls_t* p_dls, const uint8_t* p_data, uint16_t len) {
+    if (p_dls == NULL || p_data == NULL) {
+        return NRF_ERROR_NULL;
+    }
+    if (len > BLE_DLS_DIAG_MAX_LEN) {
+        return NRF_ERROR_INVALID_LENGTH;
+    }
+
+    ble_gatts_value_t gatts_value;
+
+    memset(&gatts_value, 0, sizeof(gatts_value));
+    gatts_value.len     = len;
+    gatts_value.offset  = 0;
+    gatts_value.p_value = (uint8_t*)p_data;
+
+    return sd_ble_gatts_value_set(p_dls->conn_handle,
+                                  p_dls->ram_usage_handles.value_handle,
+                                  &gatts_value);
+}
+
+
 /**@brief Function for handling the Connect event.
  *
  * @param[in]   p_dls       Door Lock Service structure.
@@ -174,6 +576,7 @@ uint32_t ble_dls_lock_state_get(ble_dls_t* p_dls, uint8_t* p_lock_state_value) {
  */
 static void on_connect(ble_dls_t* p_dls, const ble_evt_t* p_ble_evt) {
     p_dls->conn_handle = p_ble_evt->evt.gap_evt.conn_handle;
+    p_dls->hvx_pending = 0;
 
     if (p_dls->evt_handler != NULL) {
         ble_dls_evt_t evt;
@@ -206,13 +609,27 @@ static void on_disconnect(ble_dls_t* p_dls, const ble_evt_t* p_ble_evt) {
  * @param[in]   p_ble_evt   Event received from the BLE stack.
  */
 static void on_write(ble_dls_t* p_dls, const ble_evt_t* p_ble_evt) {
+    PROBE_BEGIN(probe_start);
     const ble_gatts_evt_write_t* p_evt_write = &p_ble_evt->evt.gatts_evt.params.write;
     
-    // Check if the handle passed with the event matches the Door locked Characteristic handle
-    if (p_evt_write->handle == p_dls->lock_state_handles.value_handle) {
+    // Authenticated command, handed to the application as is
+    if (p_evt_write->handle == p_dls->command_handles.value_handle) {
+        unlock_latency_mark(UNLOCK_LATENCY_WRITE);
+        if (p_dls->evt_handler != NULL) {
+            ble_dls_evt_t evt;
+            evt.evt_type              = BLE_DLS_EVT_COMMAND;
+            evt.params.command.p_data = p_evt_write->data;
+            evt.params.command.len    = p_evt_write->len;
+            p_dls->evt_handler(p_dls, &evt);
+        }
+        unlock_latency_mark(UNLOCK_LATENCY_WRITE_DONE);
+    }
+
+    if (p_evt_write->handle == p_dls->time_handles.value_handle && p_evt_write->len == BLE_DLS_TIME_LEN) {
         if (p_dls->evt_handler != NULL) {
             ble_dls_evt_t evt;
-            evt.evt_type = BLE_DLS_EVT_WRITE;
+            evt.evt_type              = BLE_DLS_EVT_TIME_WRITE;
+            evt.params.minute_of_week = uint16_decode(p_evt_write->data);
             p_dls->evt_handler(p_dls, &evt);
         }
     }
@@ -234,6 +651,123 @@ static void on_write(ble_dls_t* p_dls, const ble_evt_t* p_ble_evt) {
             p_dls->evt_handler(p_dls, &evt);
         }
     }
+
+    // Same for the diagnostic CCCD
+    if ((p_evt_write->handle == p_dls->diag_handles.cccd_handle) && (p_evt_write->len == 2)) {
+        if (p_dls->evt_handler != NULL) {
+            ble_dls_evt_t evt;
+
+            if (ble_srv_is_notification_enabled(p_evt_write->data)) {
+                evt.evt_type = BLE_DLS_EVT_DIAG_NOTIFICATION_ENABLED;
+            }
+            else {
+                evt.evt_type = BLE_DLS_EVT_DIAG_NOTIFICATION_DISABLED;
+            }
+
+            p_dls->evt_handler(p_dls, &evt);
+        }
+    }
+
+    PROBE_END(PROBE_DLS_ON_WRITE, probe_start);
+}
+
+
+/**@brief Function for raising a long command to the application.
+ *
+ * @param[in]   p_dls       Door Lock Service structure.
+ * @param[in]   p_data      Long command, valid during the event only.
+ * @param[in]   len         Long command length.
+ */
+static void long_command_raise(ble_dls_t* p_dls, const uint8_t* p_data, uint16_t len) {
+    if (p_dls->evt_handler != NULL) {
+        ble_dls_evt_t evt;
+        evt.evt_type              = BLE_DLS_EVT_LONG_COMMAND;
+        evt.params.command.p_data = p_data;
+        evt.params.command.len    = len;
+        p_dls->evt_handler(p_dls, &evt);
+    }
+}
+
+
+/**@brief Function for handling the Read/Write Authorization Request event.
+ *
+ * @details A long command short enough for a single Write Request arrives here instead of
+ *          through the Queued Write module. It is accepted as is.
+ *
+ * @param[in]   p_dls       Door Lock Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_rw_authorize_request(ble_dls_t* p_dls, const ble_evt_t* p_ble_evt) {
+    const ble_gatts_evt_rw_authorize_request_t* p_auth_req = &p_ble_evt->evt.gatts_evt.params.authorize_request;
+    const ble_gatts_evt_write_t*                p_evt_write = &p_auth_req->request.write;
+
+    if (p_auth_req->type != BLE_GATTS_AUTHORIZE_TYPE_WRITE ||
+        p_evt_write->op != BLE_GATTS_OP_WRITE_REQ ||
+        p_evt_write->handle != p_dls->long_command_handles.value_handle) {
+        return;
+    }
+
+    ble_gatts_rw_authorize_reply_params_t auth_reply;
+
+    memset(&auth_reply, 0, sizeof(auth_reply));
+    auth_reply.type                     = BLE_GATTS_AUTHORIZE_TYPE_WRITE;
+    auth_reply.params.write.gatt_status = BLE_GATT_STATUS_SUCCESS;
+    auth_reply.params.write.update      = 1;
+    auth_reply.params.write.offset      = p_evt_write->offset;
+    auth_reply.params.write.len         = p_evt_write->len;
+    auth_reply.params.write.p_data      = p_evt_write->data;
+
+    if (sd_ble_gatts_rw_authorize_reply(p_ble_evt->evt.gatts_evt.conn_handle, &auth_reply) != NRF_SUCCESS) {
+        // Link gone, nobody to answer
+        return;
+    }
+
+    long_command_raise(p_dls, p_evt_write->data, p_evt_write->len);
+}
+
+
+uint16_t ble_dls_on_qwr_evt(ble_dls_t* p_dls, nrf_ble_qwr_t* p_qwr, nrf_ble_qwr_evt_t* p_evt) {
+    UNUSED_PARAMETER(p_qwr);
+
+    if (p_dls == NULL || p_evt == NULL || p_evt->attr_handle != p_dls->long_command_handles.value_handle) {
+        return BLE_GATT_STATUS_ATTERR_REQUEST_NOT_SUPPORTED;
+    }
+
+    // The SoftDevice checks the length against max_len, the application checks the content
+    if (p_evt->evt_type != NRF_BLE_QWR_EVT_EXECUTE_WRITE) {
+        return BLE_GATT_STATUS_SUCCESS;
+    }
+
+    ble_gatts_value_t gatts_value;
+
+    // Without a buffer, only the length is returned
+    memset(&gatts_value, 0, sizeof(gatts_value));
+    gatts_value.len     = 0;
+    gatts_value.offset  = 0;
+    gatts_value.p_value = NULL;
+
+    if (sd_ble_gatts_value_get(p_dls->conn_handle, p_evt->attr_handle, &gatts_value) == NRF_SUCCESS) {
+        long_command_raise(p_dls, p_dls->long_command, gatts_value.len);
+    }
+
+    return BLE_GATT_STATUS_SUCCESS;
+}
+
+
+/**@brief Function for handling the notification transmission complete event.
+ *
+ * @param[in]   p_dls       Door Lock Service structure.
+ * @param[in]   p_ble_evt   Event received from the BLE stack.
+ */
+static void on_hvn_tx_complete(ble_dls_t* p_dls, const ble_evt_t* p_ble_evt) {
+    const uint8_t count = p_ble_evt->evt.gatts_evt.params.hvn_tx_complete.count;
+    p_dls->hvx_pending = (count < p_dls->hvx_pending) ? p_dls->hvx_pending - count : 0;
+
+    if (p_dls->evt_handler != NULL) {
+        ble_dls_evt_t evt;
+        evt.evt_type = BLE_DLS_EVT_TX_COMPLETE;
+        p_dls->evt_handler(p_dls, &evt);
+    }
 }
 
 
@@ -244,6 +778,7 @@ void ble_dls_on_ble_evt(const ble_evt_t* p_ble_evt, void* p_context) {
         return;
     }
 
+    PROBE_BEGIN(probe_start);
     switch (p_ble_evt->header.evt_id) {
         case BLE_GAP_EVT_CONNECTED:
             on_connect(p_dls, p_ble_evt);
@@ -257,7 +792,16 @@ void ble_dls_on_ble_evt(const ble_evt_t* p_ble_evt, void* p_context) {
             on_write(p_dls, p_ble_evt);
             break;
 
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            on_hvn_tx_complete(p_dls, p_ble_evt);
+            break;
+
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+            on_rw_authorize_request(p_dls, p_ble_evt);
+            break;
+
         default:
             break;
     }
+    PROBE_END(PROBE_DLS_ON_BLE_EVT, probe_start);
 }
\ No newline at end of file
@@ -6,6 +6,7 @@
 
 #include "ble.h"
 #include "ble_srv_common.h"
+#include "nrf_ble_qwr.h"
 
 
 #ifdef __cplusplus
@@ -18,8 +19,33 @@ extern "C" {
                         0x4D, 0x4E, 0xA9, 0x10, 0x0D, 0xA3, 0xE1, 0xD1 }
 
 // 16-bit UUID for the service and its characteristics
-#define DLS_UUID_SERVICE         0x2000
-#define DLS_UUID_LOCK_STATE_CHAR 0x2001
+#define DLS_UUID_SERVICE           0x2000
+#define DLS_UUID_LOCK_STATE_CHAR   0x2001
+#define DLS_UUID_DIAG_CHAR         0x2002
+#define DLS_UUID_RAM_USAGE_CHAR    0x2003
+#define DLS_UUID_COMMAND_CHAR      0x2004
+#define DLS_UUID_ACK_CHAR          0x2005
+#define DLS_UUID_TIME_CHAR         0x2006
+#define DLS_UUID_LONG_COMMAND_CHAR 0x2007
+#define DLS_UUID_RESPONSE_CHAR     0x2008
+
+// Maximum length of a diagnostic record, one notification at the default ATT MTU
+#define BLE_DLS_DIAG_MAX_LEN     (BLE_GATT_ATT_MTU_DEFAULT - 3)
+
+// Maximum length of a command, one write at the default ATT MTU
+#define BLE_DLS_COMMAND_MAX_LEN  (BLE_GATT_ATT_MTU_DEFAULT - 3)
+
+// Length of an acknowledgement: sequence number, result, lock state
+#define BLE_DLS_ACK_LEN          4
+
+// Length of a local time write: minutes since Monday 00:00
+#define BLE_DLS_TIME_LEN         2
+
+// Maximum length of a long command, written with queued writes over as many packets as needed
+#define BLE_DLS_LONG_COMMAND_MAX_LEN BLE_GATTS_VAR_ATTR_LEN_MAX
+
+// Maximum length of a long command response, one notification at the default ATT MTU
+#define BLE_DLS_RESPONSE_MAX_LEN BLE_DLS_DIAG_MAX_LEN
 
 
 /**@brief   Macro for defining an door lock service instance.
@@ -39,12 +65,45 @@ typedef enum {
     BLE_DLS_EVT_NOTIFICATION_DISABLED,  /**< Door lock notification disabled event. */
     BLE_DLS_EVT_DISCONNECTED,
     BLE_DLS_EVT_CONNECTED,
-    BLE_DLS_EVT_WRITE
+    BLE_DLS_EVT_WRITE,
+    BLE_DLS_EVT_DIAG_NOTIFICATION_ENABLED,  /**< Diagnostic notification enabled event. */
+    BLE_DLS_EVT_DIAG_NOTIFICATION_DISABLED, /**< Diagnostic notification disabled event. */
+    BLE_DLS_EVT_TX_COMPLETE,                /**< Notification transmitted, room in the queue. */
+    BLE_DLS_EVT_COMMAND,                    /**< Command characteristic written, see params.command. */
+    BLE_DLS_EVT_TIME_WRITE,                 /**< Local time characteristic written, see params.minute_of_week. */
+    BLE_DLS_EVT_LONG_COMMAND                /**< Long command characteristic written, see params.command. */
 } ble_dls_evt_type_t;
 
+/**@brief Result codes of an acknowledgement. */
+typedef enum {
+    BLE_DLS_ACK_OK                 = 0x00,  /**< Acted on. */
+    BLE_DLS_ACK_INVALID_LENGTH     = 0x01,  /**< Command of the wrong length. */
+    BLE_DLS_ACK_INVALID_OPCODE     = 0x02,  /**< Unknown opcode. */
+    BLE_DLS_ACK_UNKNOWN_CREDENTIAL = 0x03,  /**< Credential not enrolled. */
+    BLE_DLS_ACK_REPLAYED           = 0x04,  /**< Counter not larger than the last one accepted. */
+    BLE_DLS_ACK_INVALID_MAC        = 0x05,  /**< MAC does not match the current or previous challenge. */
+    BLE_DLS_ACK_BUSY               = 0x06,  /**< Lock not ready, try again with a new command. */
+    BLE_DLS_ACK_REJECTED           = 0x07   /**< Authorized, but could not be carried out. */
+} ble_dls_ack_result_t;
+
+/**@brief Long command opcodes, first byte of a long command and of its response. */
+typedef enum {
+    BLE_DLS_LONG_OP_CREDENTIALS_ADD = 0x01  /**< Enroll the credentials that follow an enroll command. */
+} ble_dls_long_opcode_t;
+
+/**@brief Command written to the command or long command characteristic. */
+typedef struct {
+    const uint8_t* p_data;  /**< Command, valid during the event only. */
+    uint16_t       len;     /**< Command length. */
+} ble_dls_command_t;
+
 /**@brief Door Lock Service event. */
 typedef struct {
     ble_dls_evt_type_t evt_type;  /**< Type of event. */
+    union {
+        ble_dls_command_t command;          /**< Parameters of BLE_DLS_EVT_COMMAND. */
+        uint16_t          minute_of_week;   /**< Parameter of BLE_DLS_EVT_TIME_WRITE, minutes since Monday 00:00 local time. */
+    } params;
 } ble_dls_evt_t;
 
 
@@ -62,6 +121,11 @@ typedef struct {
     ble_dls_evt_handler_t        evt_handler;               /**< Event handler to be called for handling events in the Door Lock Service */
     uint8_t                      initial_lock_state_value;  /**< Initial value for the door lock */
     ble_srv_cccd_security_mode_t lock_state_char_attr_md;   /**< Initial security level for Door Lock characteristics attribute */
+    ble_srv_cccd_security_mode_t diag_char_attr_md;         /**< Initial security level for the diagnostic characteristics attributes */
+    ble_gap_conn_sec_mode_t      command_write_perm;        /**< Write permission of the command characteristic */
+    ble_gap_conn_sec_mode_t      time_write_perm;           /**< Write permission of the local time characteristic */
+    ble_gap_conn_sec_mode_t      long_command_write_perm;   /**< Write permission of the long command characteristic */
+    nrf_ble_qwr_t*               p_qwr;                     /**< Queued Write module instance the long command characteristic is registered with */
 } ble_dls_init_t;
 
 
@@ -70,8 +134,17 @@ struct ble_dls_s {
     ble_dls_evt_handler_t    evt_handler;         /**< Event handler to be called for handling events in the Door Lock Service */
     uint16_t                 service_handle;      /**< Handle of Door Lock Service (as provided by the BLE stack) */
     ble_gatts_char_handles_t lock_state_handles;  /**< Handles related to the Door locked characteristic */
+    ble_gatts_char_handles_t diag_handles;        /**< Handles related to the diagnostic characteristic */
+    ble_gatts_char_handles_t ram_usage_handles;   /**< Handles related to the RAM usage characteristic */
+    ble_gatts_char_handles_t command_handles;     /**< Handles related to the command characteristic */
+    ble_gatts_char_handles_t ack_handles;         /**< Handles related to the acknowledgement characteristic */
+    ble_gatts_char_handles_t time_handles;        /**< Handles related to the local time characteristic */
+    ble_gatts_char_handles_t long_command_handles; /**< Handles related to the long command characteristic */
+    ble_gatts_char_handles_t response_handles;    /**< Handles related to the long command response characteristic */
+    uint8_t                  hvx_pending;         /**< Notifications queued in the SoftDevice and not yet transmitted */
     uint16_t                 conn_handle;         /**< Handle of the current connection (as provided by the BLE stack, is BLE_CONN_HANDLE_INVALID if not in a connection) */
     uint8_t                  uuid_type; 
+    uint8_t                  long_command[BLE_DLS_LONG_COMMAND_MAX_LEN]; /**< Value of the long command characteristic, in application memory */
 };
 
 
@@ -99,6 +172,22 @@ uint32_t ble_dls_init(ble_dls_t* p_dls, const ble_dls_init_t* p_dls_init);
 void ble_dls_on_ble_evt(const ble_evt_t* p_ble_evt, void* p_context);
 
 
+/**@brief Function for handling the Queued Write module events of the long command characteristic.
+ *
+ * @details A long command is written with Prepare Write Requests, collected by the Queued Write
+ *          module, and raised as BLE_DLS_EVT_LONG_COMMAND once the Execute Write Request has
+ *          written it to the characteristic. The application forwards the events of the Queued
+ *          Write module instance given at initialization here.
+ *
+ * @param[in]   p_dls   Door Lock Service structure.
+ * @param[in]   p_qwr   Queued Write module instance.
+ * @param[in]   p_evt   Queued Write module event.
+ *
+ * @return      BLE_GATT_STATUS_SUCCESS to accept the queued write, otherwise a GATT status code.
+ */
+uint16_t ble_dls_on_qwr_evt(ble_dls_t* p_dls, nrf_ble_qwr_t* p_qwr, nrf_ble_qwr_evt_t* p_evt);
+
+
 
 /**@brief Function for updating the door lock value.
  *
@@ -109,12 +198,27 @@ void ble_dls_on_ble_evt(const ble_evt_t* p_ble_evt, void* p_context);
  * @param[in]   p_dls             Door Lock Service structure
  * @param[in]   lock_state_value  Door lock state value
  *
- * @return      NRF_SUCCESS on success, otherwise an error code.
+ * @return      NRF_SUCCESS on success, otherwise an error code. BLE_DLS_EVT_WRITE is raised
+ *              whenever the value was stored, also if the notification then failed, in which
+ *              case the notification error is returned.
  */
 uint32_t ble_dls_lock_state_set(ble_dls_t* p_dls, uint8_t lock_state_value);
 
 
 
+/**@brief Function for reporting the door lock value without raising BLE_DLS_EVT_WRITE.
+ *
+ * @details Updates the characteristic and notifies it if connected, for state changes the
+ *          application has already acted on, such as an authenticated command or the lock button.
+ *
+ * @param[in]   p_dls             Door Lock Service structure
+ * @param[in]   lock_state_value  Door lock state value
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dls_lock_state_report(ble_dls_t* p_dls, uint8_t lock_state_value);
+
+
 /**@brief Function for retrieving the door lock value.
  *
  * @details The application calls this function when it wants to retrieve the value of
@@ -130,6 +234,72 @@ uint32_t ble_dls_lock_state_set(ble_dls_t* p_dls, uint8_t lock_state_value);
 uint32_t ble_dls_lock_state_get(ble_dls_t* p_dls, uint8_t* p_lock_state_value);
 
 
+/**@brief Function for sending a diagnostic record.
+ *
+ * @details Updates the diagnostic characteristic and notifies it if the peer has enabled
+ *          notifications. The SoftDevice queue is small, wait for BLE_DLS_EVT_TX_COMPLETE
+ *          when NRF_ERROR_RESOURCES is returned.
+ *
+ * @param[in]   p_dls   Door Lock Service structure
+ * @param[in]   p_data  Record
+ * @param[in]   len     Record length, at most BLE_DLS_DIAG_MAX_LEN
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dls_diag_send(ble_dls_t* p_dls, const uint8_t* p_data, uint16_t len);
+
+
+/**@brief Function for acknowledging a command.
+ *
+ * @details Updates the acknowledgement characteristic and notifies it if the peer has enabled
+ *          notifications. Once hvx_pending is back to 0 after BLE_DLS_EVT_TX_COMPLETE, the
+ *          acknowledgement has been transmitted.
+ *
+ * @param[in]   p_dls       Door Lock Service structure
+ * @param[in]   seq         Sequence number, to tell a new acknowledgement from a stale one
+ * @param[in]   result      Result, @ref ble_dls_ack_result_t
+ * @param[in]   locked      Lock state after the command
+ *
+ * @return      NRF_SUCCESS if the notification was queued, NRF_ERROR_INVALID_STATE if not
+ *              connected or notifications are disabled, BLE_ERROR_GATTS_SYS_ATTR_MISSING if
+ *              the peer has not written the CCCD yet on this link and is not bonded,
+ *              NRF_ERROR_RESOURCES if the SoftDevice queue is full, otherwise an error code.
+ *              The value is stored, and can be read, in all four cases.
+ */
+uint32_t ble_dls_ack_send(ble_dls_t* p_dls, uint16_t seq, ble_dls_ack_result_t result, bool locked);
+
+
+/**@brief Function for answering a long command.
+ *
+ * @details Updates the response characteristic and notifies it if the peer has enabled
+ *          notifications.
+ *
+ * @param[in]   p_dls   Door Lock Service structure
+ * @param[in]   p_data  Response, starting with the opcode of the long command
+ * @param[in]   len     Response length, at most BLE_DLS_RESPONSE_MAX_LEN
+ *
+ * @return      NRF_SUCCESS if the notification was queued, NRF_ERROR_INVALID_STATE if not
+ *              connected or notifications are disabled, BLE_ERROR_GATTS_SYS_ATTR_MISSING if
+ *              the peer has not written the CCCD yet on this link and is not bonded,
+ *              NRF_ERROR_RESOURCES if the SoftDevice queue is full, otherwise an error code.
+ *              The value is stored, and can be read, in all four cases.
+ */
+uint32_t ble_dls_response_send(ble_dls_t* p_dls, const uint8_t* p_data, uint16_t len);
+
+
+/**@brief Function for updating the RAM usage report.
+ *
+ * @details The report is read-only and is not notified, a client reads it when needed.
+ *
+ * @param[in]   p_dls   Door Lock Service structure
+ * @param[in]   p_data  Report
+ * @param[in]   len     Report length, at most BLE_DLS_DIAG_MAX_LEN
+ *
+ * @return      NRF_SUCCESS on success, otherwise an error code.
+ */
+uint32_t ble_dls_ram_usage_set(ble_dls_t* p_dls, const uint8_t* p_data, uint16_t len);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,6 +23,19 @@
 #include "nrf_log_ctrl.h"
 #include "nrf_log_default_backends.h"
 
+#include "diag_service/unlock_latency.h"
+#include "diag_service/unlock_retry.h"
+#include "diag_service/evt_trace.h"
+#include "diag_service/ram_usage.h"
+#include "diag_service/boot_profile.h"
+#include "adv_layout.h"
+#include "adv_policy.h"
+#include "conn_policy.h"
+#include "phy_policy.h"
+#include "gatt_cache.h"
+#include "proximity_scan.h"
+#include "auth_service/auth_prefetch.h"
+
 
 NRF_BLE_GATT_DEF(m_gatt);              /**< GATT module instance. */
 NRF_BLE_QWR_DEF(m_qwr);                /**< Context for the Queued Write module.*/
@@ -31,12 +44,15 @@ BLE_ADVERTISING_DEF(m_advertising);    /**< Advertising module instance. */
 
 // BLE services config storage
 static struct {
-    ble_adv_evt_handler_t adv_evt_handler;
-    ble_evt_handler_t     ble_evt_handler;
+    ble_adv_evt_handler_t     adv_evt_handler;
+    ble_evt_handler_t         ble_evt_handler;
+    nrf_ble_qwr_evt_handler_t qwr_evt_handler;
 } ble_services_config;
 
 
 static uint16_t m_conn_handle = BLE_CONN_HANDLE_INVALID;                        /**< Handle of the current connection. */
+static uint8_t                  m_qwr_mem[QWR_MEM_BUFF_SIZE];                   /**< Prepare Write Requests collected until the Execute Write Request. */
+static bool                     m_advdata_pending;                              /**< The advertising layout changed since it was last given to the advertising module. */
 
 
 /**@brief Function for handling Peer Manager events.
@@ -47,6 +63,8 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
 {
     pm_handler_on_pm_evt(p_evt);
     pm_handler_flash_clean(p_evt);
+    adv_policy_on_pm_evt(p_evt);
+    auth_prefetch_on_pm_evt(p_evt);
 
     switch (p_evt->evt_id)
     {
@@ -64,6 +82,8 @@ static void pm_evt_handler(pm_evt_t const * p_evt)
  *
  * @details This function sets up all the necessary GAP (Generic Access Profile) parameters of the
  *          device including the device name, appearance, and the preferred connection parameters.
+ *          The preferred parameters are the fast ones of the connection parameter policy, a
+ *          central that honours them starts the unlock transaction at full speed.
  */
 static void gap_params_init(void)
 {
@@ -84,9 +104,9 @@ static void gap_params_init(void)
 
     memset(&gap_conn_params, 0, sizeof(gap_conn_params));
 
-    gap_conn_params.min_conn_interval = MIN_CONN_INTERVAL;
-    gap_conn_params.max_conn_interval = MAX_CONN_INTERVAL;
-    gap_conn_params.slave_latency     = SLAVE_LATENCY;
+    gap_conn_params.min_conn_interval = CONN_POLICY_FAST_MIN_INTERVAL;
+    gap_conn_params.max_conn_interval = CONN_POLICY_FAST_MAX_INTERVAL;
+    gap_conn_params.slave_latency     = CONN_POLICY_FAST_SLAVE_LATENCY;
     gap_conn_params.conn_sup_timeout  = CONN_SUP_TIMEOUT;
 
     err_code = sd_ble_gap_ppcp_set(&gap_conn_params);
@@ -124,7 +144,10 @@ static void services_init(void)
  
     // Initialize Queued Write Module
     nrf_ble_qwr_init_t qwr_init = {0};
-    qwr_init.error_handler = nrf_qwr_error_handler;
+    qwr_init.mem_buffer.p_mem = m_qwr_mem;
+    qwr_init.mem_buffer.len   = sizeof(m_qwr_mem);
+    qwr_init.callback         = ble_services_config.qwr_evt_handler;
+    qwr_init.error_handler    = nrf_qwr_error_handler;
     err_code = nrf_ble_qwr_init(&m_qwr, &qwr_init);
     APP_ERROR_CHECK(err_code);
 }
@@ -133,22 +156,14 @@ static void services_init(void)
 /**@brief Function for handling the Connection Parameters Module.
  *
  * @details This function will be called for all events in the Connection Parameters Module which
- *          are passed to the application.
- *          @note All this function does is to disconnect. This could have been done by simply
- *                setting the disconnect_on_fail config parameter, but instead we use the event
- *                handler mechanism to demonstrate its use.
+ *          are passed to the application. The connection parameter policy counts them, a central
+ *          that does not accept the parameters is not disconnected.
  *
  * @param[in] p_evt  Event received from the Connection Parameters Module.
  */
 static void on_conn_params_evt(ble_conn_params_evt_t * p_evt)
 {
-    ret_code_t err_code;
-
-    if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED)
-    {
-        err_code = sd_ble_gap_disconnect(m_conn_handle, BLE_HCI_CONN_INTERVAL_UNACCEPTABLE);
-        APP_ERROR_CHECK(err_code);
-    }
+    conn_policy_on_conn_params_evt(p_evt);
 }
 
 
@@ -182,27 +197,48 @@ static void conn_params_init(void)
 
     err_code = ble_conn_params_init(&cp_init);
     APP_ERROR_CHECK(err_code);
+
+    conn_policy_init();
+}
+
+
+/**@brief Function for giving the advertising layout to the advertising module.
+ *
+ * @details The SoftDevice refuses advertising data on a directed advertising set, and the
+ *          advertising module has no data to swap while not advertising. The layout is then only
+ *          kept, and given when the next undirected phase starts.
+ */
+static void advdata_update(void)
+{
+    const adv_policy_phase_t phase = adv_policy_phase_get();
+
+    if (phase == ADV_POLICY_PHASE_NONE || phase == ADV_POLICY_PHASE_DIRECTED) {
+        m_advdata_pending = true;
+        return;
+    }
+
+    // Encoded into the spare buffer and swapped in, also while advertising
+    m_advdata_pending = false;
+    const ret_code_t err_code = ble_advertising_advdata_update(&m_advertising, adv_layout_advdata_get(), adv_layout_srdata_get());
+    APP_ERROR_CHECK(err_code);
 }
 
 
 /**@brief Function for handling advertising events.
  *
  * @details This function will be called for advertising events which are passed to the application.
+ *          Advertising never goes idle, the policy takes over with the ultra-slow phase.
  *
  * @param[in] ble_adv_evt  Advertising event.
  */
 static void on_adv_evt(ble_adv_evt_t ble_adv_evt)
 {
-    ret_code_t err_code;
-
-    switch (ble_adv_evt)
-    {
-        case BLE_ADV_EVT_FAST:
-            NRF_LOG_INFO("Fast advertising");
-            break;
+    if (!adv_policy_on_adv_evt(ble_adv_evt)) {
+        return;
+    }
 
-        default:
-            break;
+    if (m_advdata_pending) {
+        advdata_update();
     }
 
     if (ble_services_config.adv_evt_handler != NULL) {
@@ -220,13 +256,24 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
 {
     ret_code_t err_code = NRF_SUCCESS;
 
+    evt_trace_record(p_ble_evt);
+    adv_policy_on_ble_evt(p_ble_evt);
+    conn_policy_on_ble_evt(p_ble_evt);
+    phy_policy_on_ble_evt(p_ble_evt);
+    gatt_cache_on_ble_evt(p_ble_evt);
+    proximity_scan_on_ble_evt(p_ble_evt);
+    auth_prefetch_on_ble_evt(p_ble_evt);
+
     switch (p_ble_evt->header.evt_id)
     {
         case BLE_GAP_EVT_DISCONNECTED:
             NRF_LOG_INFO("Disconnected.");
+            unlock_latency_disconnected();
             break;
 
         case BLE_GAP_EVT_CONNECTED: {
+            unlock_latency_mark(UNLOCK_LATENCY_CONNECTED);
+            unlock_retry_connected(&p_ble_evt->evt.gap_evt.params.connected.peer_addr);
             const uint8_t* addr = p_ble_evt->evt.gap_evt.params.connected.peer_addr.addr;
             NRF_LOG_INFO("Connected to %02x:%02x:%02x:%02x:%02x:%02x", addr[0], addr[1], addr[2], addr[3], addr[4], addr[5]);
 
@@ -235,6 +282,13 @@ static void ble_evt_handler(ble_evt_t const * p_ble_evt, void * p_context)
             APP_ERROR_CHECK(err_code);
             } break;
 
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+            // Security mode 1 level 2 and up means the link is encrypted
+            if (p_ble_evt->evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv >= 2) {
+                unlock_latency_mark(UNLOCK_LATENCY_SECURED);
+            }
+            break;
+
         case BLE_GAP_EVT_PHY_UPDATE_REQUEST:
         {
             NRF_LOG_DEBUG("PHY update request.");
@@ -347,6 +401,15 @@ static void delete_bonds(void)
 }
 
 
+/**@brief Function for setting up GATT caching, once all services are added.
+ */
+static void gatt_cache_setup(void)
+{
+    ret_code_t err_code = gatt_cache_init();
+    APP_ERROR_CHECK(err_code);
+}
+
+
 /**@brief Function for initializing the Advertising functionality.
  */
 static void advertising_init(const ble_services_init_t* p_init)
@@ -356,29 +419,23 @@ static void advertising_init(const ble_services_init_t* p_init)
 
     memset(&init, 0, sizeof(init));
 
-    init.advdata.name_type               = BLE_ADVDATA_FULL_NAME;
-    init.advdata.include_appearance      = true;
-    init.advdata.flags                   = BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE;
-    init.advdata.uuids_complete.uuid_cnt = p_init->adv_uuid_count;
-    init.advdata.uuids_complete.p_uuids  = p_init->adv_uuids;
+    err_code = adv_layout_init(p_init->adv_uuids, p_init->adv_uuid_count);
+    APP_ERROR_CHECK(err_code);
 
-    /*
-    ble_advdata_manuf_data_t manuf_response_data;
-    //manuf_response_data.company_identifier = COMPANY_UUID;
-    manuf_response_data.data.p_data = DEVICE_NAME;
-    manuf_response_data.data.size = sizeof(DEVICE_NAME);
-    init.srdata.p_manuf_specific_data = &manuf_response_data;
-    */
+    init.advdata = *adv_layout_advdata_get();
+    if (adv_layout_srdata_get() != NULL) {
+        init.srdata = *adv_layout_srdata_get();
+    }
 
-    init.config.ble_adv_fast_enabled  = true;
-    init.config.ble_adv_fast_interval = APP_ADV_INTERVAL;
-    init.config.ble_adv_fast_timeout  = APP_ADV_DURATION;
+    adv_policy_modes_config_get(&init.config);
 
     init.evt_handler = on_adv_evt;
 
     err_code = ble_advertising_init(&m_advertising, &init);
     APP_ERROR_CHECK(err_code);
 
+    adv_policy_init(&m_advertising);
+
     ble_advertising_conn_cfg_tag_set(&m_advertising, APP_BLE_CONN_CFG_TAG);
 }
 
@@ -394,13 +451,61 @@ void advertising_start(bool erase_bonds)
     }
     else
     {
-        ret_code_t err_code = ble_advertising_start(&m_advertising, BLE_ADV_MODE_FAST);
+        adv_policy_bonds_load();
+
+        ret_code_t err_code = ble_advertising_start(&m_advertising, BLE_ADV_MODE_DIRECTED_HIGH_DUTY);
 
         APP_ERROR_CHECK(err_code);
     }
 }
 
 
+/**@brief Function for setting the manufacturer specific data of the scan response.
+ *
+ * @param[in] p_data  Payload, after the company identifier.
+ * @param[in] len     Payload length, at most ADV_MANUF_DATA_MAX_LEN.
+ */
+void advertising_manuf_data_set(const uint8_t* p_data, uint8_t len)
+{
+    const ret_code_t err_code = adv_layout_manuf_data_set(p_data, len);
+    APP_ERROR_CHECK(err_code);
+
+    advdata_update();
+}
+
+
+/**@brief Function for setting the status in the advertising data.
+ *
+ * @param[in] p_data  Payload, after the company identifier.
+ * @param[in] len     Payload length, at most ADV_STATUS_MAX_LEN.
+ */
+void advertising_status_set(const uint8_t* p_data, uint8_t len)
+{
+    const ret_code_t err_code = adv_layout_status_set(p_data, len);
+    APP_ERROR_CHECK(err_code);
+
+    advdata_update();
+}
+
+
+/**@brief Function for getting the Queued Write module instance, for services to register
+ *        their attributes with.
+ */
+nrf_ble_qwr_t* ble_services_qwr_get(void)
+{
+    return &m_qwr;
+}
+
+
+/**@brief Function for running the application's service init functions.
+ */
+static void app_services_init(const ble_services_init_t* p_init) {
+    for (unsigned int i = 0; i < p_init->service_init_func_count; ++i) {
+        p_init->service_init_funcs[i]();
+    }
+}
+
+
 /**@brief Function for initializing BLE services.
  *
  * @param[in] p_init  BLE service initialization config.
@@ -412,17 +517,21 @@ void ble_services_init(const ble_services_init_t* p_init) {
 
     ble_services_config.adv_evt_handler = p_init->adv_evt_handler;
     ble_services_config.ble_evt_handler = p_init->ble_evt_handler;
+    ble_services_config.qwr_evt_handler = p_init->qwr_evt_handler;
 
-    ble_stack_init();
-    gap_params_init();
-    gatt_init();
+    BOOT_PROFILE_STEP(BOOT_STEP_BLE_STACK_INIT, ble_stack_init());
+    BOOT_PROFILE_STEP(BOOT_STEP_GAP_PARAMS_INIT, gap_params_init());
+    BOOT_PROFILE_STEP(BOOT_STEP_GATT_INIT, gatt_init());
 
-    services_init();
-    for (unsigned int i = 0; i < p_init->service_init_func_count; ++i) {
-        p_init->service_init_funcs[i]();
-    }
+    BOOT_PROFILE_STEP(BOOT_STEP_SERVICES_INIT, services_init());
+    BOOT_PROFILE_STEP(BOOT_STEP_APP_SERVICES_INIT, app_services_init(p_init));
+    BOOT_PROFILE_STEP(BOOT_STEP_GATT_CACHE_INIT, gatt_cache_setup());
+
+    BOOT_PROFILE_STEP(BOOT_STEP_ADVERTISING_INIT, advertising_init(p_init));
+    BOOT_PROFILE_STEP(BOOT_STEP_CONN_PARAMS_INIT, conn_params_init());
+    BOOT_PROFILE_STEP(BOOT_STEP_PEER_MANAGER_INIT, peer_manager_init());
 
-    advertising_init(p_init);
-    conn_params_init();
-    peer_manager_init();
+    ram_usage_static_set(RAM_USAGE_ADVERTISING, sizeof(m_advertising));
+    ram_usage_static_set(RAM_USAGE_QWR, sizeof(m_qwr) + sizeof(m_qwr_mem));
+    ram_usage_static_set(RAM_USAGE_GATT, sizeof(m_gatt));
 }
\ No newline at end of file
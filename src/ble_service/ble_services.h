@@ -5,6 +5,7 @@
 #include "bsp.h"
 #include "ble.h"
 #include "ble_advertising.h"
+#include "nrf_ble_qwr.h"
 
 
 #ifdef __cplusplus
@@ -23,12 +24,13 @@ typedef void (*ble_service_init_func_t)(void);
 
 /**@brief BLE services init structure */
 typedef struct {
-    ble_adv_evt_handler_t    adv_evt_handler;
-    ble_evt_handler_t        ble_evt_handler;
-    ble_service_init_func_t* service_init_funcs;
-    unsigned int             service_init_func_count;
-    ble_uuid_t*              adv_uuids;
-    unsigned int             adv_uuid_count;
+    ble_adv_evt_handler_t     adv_evt_handler;
+    ble_evt_handler_t         ble_evt_handler;
+    nrf_ble_qwr_evt_handler_t qwr_evt_handler;
+    ble_service_init_func_t*  service_init_funcs;
+    unsigned int              service_init_func_count;
+    ble_uuid_t*               adv_uuids;
+    unsigned int              adv_uuid_count;
 } ble_services_init_t;
 
 
@@ -40,6 +42,14 @@ typedef struct {
 void ble_services_init(const ble_services_init_t* p_init);
 
 
+/**@brief Function for getting the Queued Write module instance.
+ *
+ * @details Valid from the service init functions on. Attributes registered with it have their
+ *          queued writes reported to the qwr_evt_handler of the init structure.
+ */
+nrf_ble_qwr_t* ble_services_qwr_get(void);
+
+
 /**@brief Function for starting BLE advertising.
  *
  * @param[in] erase_bonds  True if existing bonds should be erased.
@@ -47,6 +57,29 @@ void ble_services_init(const ble_services_init_t* p_init);
 void advertising_start(bool erase_bonds);
 
 
+/**@brief Function for setting the manufacturer specific data of the scan response.
+ *
+ * @details Takes effect immediately while advertising undirected, otherwise when the next
+ *          undirected phase starts.
+ *
+ * @param[in] p_data  Payload, after the company identifier.
+ * @param[in] len     Payload length, at most ADV_MANUF_DATA_MAX_LEN.
+ */
+void advertising_manuf_data_set(const uint8_t* p_data, uint8_t len);
+
+
+/**@brief Function for setting the status, manufacturer specific data of the advertising data
+ *        read by scanners without connecting.
+ *
+ * @details Takes effect immediately while advertising undirected, otherwise when the next
+ *          undirected phase starts.
+ *
+ * @param[in] p_data  Payload, after the company identifier.
+ * @param[in] len     Payload length, at most ADV_STATUS_MAX_LEN.
+ */
+void advertising_status_set(const uint8_t* p_data, uint8_t len);
+
+
 #ifdef __cplusplus
 }
 #endif
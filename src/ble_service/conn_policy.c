@@ -0,0 +1,159 @@
+#include "conn_policy.h"
+#include "config.h"
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+
+
+#define IDLE_TIMEOUT_TICKS  APP_TIMER_TICKS(CONN_POLICY_IDLE_TIMEOUT_MS)
+
+
+APP_TIMER_DEF(m_idle_timer);    /**< Idle detection timer */
+
+static ble_gap_conn_params_t m_fast_params = {
+    .min_conn_interval = CONN_POLICY_FAST_MIN_INTERVAL,
+    .max_conn_interval = CONN_POLICY_FAST_MAX_INTERVAL,
+    .slave_latency     = CONN_POLICY_FAST_SLAVE_LATENCY,
+    .conn_sup_timeout  = CONN_SUP_TIMEOUT
+};
+
+static ble_gap_conn_params_t m_idle_params = {
+    .min_conn_interval = MIN_CONN_INTERVAL,
+    .max_conn_interval = MAX_CONN_INTERVAL,
+    .slave_latency     = SLAVE_LATENCY,
+    .conn_sup_timeout  = CONN_SUP_TIMEOUT
+};
+
+static conn_policy_stats_t m_stats;
+static uint16_t            m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static bool                m_idle;              /**< Idle parameters requested for the current link */
+static uint32_t            m_last_activity;     /**< RTC ticks of the last GATT activity */
+
+
+/**@brief Function for requesting new parameters for the current link.
+ *
+ * @return True if the request was sent.
+ */
+static bool params_request(ble_gap_conn_params_t* p_params, uint32_t* p_counter) {
+    const ret_code_t err_code = ble_conn_params_change_conn_params(m_conn_handle, p_params);
+    if (err_code != NRF_SUCCESS) {
+        ++m_stats.request_errors;
+        return false;
+    }
+
+    ++*p_counter;
+    return true;
+}
+
+
+/**@brief Function for starting the idle timer.
+ */
+static void idle_timer_start(uint32_t timeout_ticks) {
+    const ret_code_t err_code = app_timer_start(m_idle_timer, timeout_ticks, NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Called when the idle timer times out, relaxes the link if there was no activity since
+ *        it was started, otherwise waits for the rest of the idle time.
+ *
+ * @param[in] p_context  Unused
+ */
+static void idle_timeout(void* p_context) {
+    if (m_conn_handle == BLE_CONN_HANDLE_INVALID) {
+        return;
+    }
+
+    const uint32_t idle_ticks = app_timer_cnt_diff_compute(app_timer_cnt_get(), m_last_activity);
+    if (idle_ticks < IDLE_TIMEOUT_TICKS) {
+        idle_timer_start(IDLE_TIMEOUT_TICKS - idle_ticks);
+        return;
+    }
+
+    m_idle = params_request(&m_idle_params, &m_stats.idle_requests);
+    if (!m_idle) {
+        // Procedure still running, try again later
+        idle_timer_start(IDLE_TIMEOUT_TICKS);
+    }
+}
+
+
+/**@brief Function for noting GATT activity on the current link.
+ *
+ * @details Only stamps the time while the link is fast, so the write path does not touch the
+ *          timer. The idle timer is restarted when the link goes back to fast.
+ */
+static void on_activity(void) {
+    m_last_activity = app_timer_cnt_get();
+
+    if (m_idle && params_request(&m_fast_params, &m_stats.fast_requests)) {
+        m_idle = false;
+        idle_timer_start(IDLE_TIMEOUT_TICKS);
+    }
+}
+
+
+void conn_policy_init(void) {
+    const ret_code_t err_code = app_timer_create(&m_idle_timer, APP_TIMER_MODE_SINGLE_SHOT, idle_timeout);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+void conn_policy_on_ble_evt(const ble_evt_t* p_ble_evt) {
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONNECTED:
+            m_conn_handle   = p_ble_evt->evt.gap_evt.conn_handle;
+            m_idle          = false;
+            m_last_activity = app_timer_cnt_get();
+
+            // The phone picked its own interval, ask for a fast one right away
+            params_request(&m_fast_params, &m_stats.fast_requests);
+            idle_timer_start(IDLE_TIMEOUT_TICKS);
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_ble_evt->evt.gap_evt.conn_handle == m_conn_handle) {
+                m_conn_handle = BLE_CONN_HANDLE_INVALID;
+                const ret_code_t err_code = app_timer_stop(m_idle_timer);
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            ++m_stats.updates;
+            if (p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval <= CONN_POLICY_FAST_MAX_INTERVAL) {
+                ++m_stats.fast_updates;
+            }
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+        case BLE_GATTS_EVT_RW_AUTHORIZE_REQUEST:
+        case BLE_GATTS_EVT_HVN_TX_COMPLETE:
+            on_activity();
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void conn_policy_on_conn_params_evt(const ble_conn_params_evt_t* p_evt) {
+    if (p_evt->evt_type == BLE_CONN_PARAMS_EVT_FAILED) {
+        ++m_stats.rejected;
+    }
+}
+
+
+const conn_policy_stats_t* conn_policy_stats_get(void) {
+    return &m_stats;
+}
+
+
+void conn_policy_log(void) {
+    NRF_LOG_INFO("Conn params: %u fast, %u idle requests, %u errors",
+                 m_stats.fast_requests, m_stats.idle_requests, m_stats.request_errors);
+    NRF_LOG_INFO("Conn params: %u updates, %u fast, %u rejected",
+                 m_stats.updates, m_stats.fast_updates, m_stats.rejected);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ble.h"
+#include "ble_conn_params.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Connection parameter policy counters, since boot */
+typedef struct {
+    uint32_t fast_requests;     /**< Fast parameters requested, on connect or on activity after idle */
+    uint32_t idle_requests;     /**< Idle parameters requested after CONN_POLICY_IDLE_TIMEOUT_MS without activity */
+    uint32_t request_errors;    /**< Requests the SoftDevice refused, e.g. with a procedure in progress */
+    uint32_t updates;           /**< Connection parameter updates */
+    uint32_t fast_updates;      /**< Updates to an interval of at most CONN_POLICY_FAST_MAX_INTERVAL */
+    uint32_t rejected;          /**< Negotiations given up after MAX_CONN_PARAMS_UPDATE_COUNT attempts */
+} conn_policy_stats_t;
+
+
+/**@brief Function for initializing the connection parameter policy.
+ *
+ * @details Must be called after ble_conn_params_init. The policy requests
+ *          CONN_POLICY_FAST_MIN_INTERVAL to CONN_POLICY_FAST_MAX_INTERVAL on connect, relaxes to
+ *          MIN_CONN_INTERVAL to MAX_CONN_INTERVAL with SLAVE_LATENCY after
+ *          CONN_POLICY_IDLE_TIMEOUT_MS without GATT activity, and goes back to fast on the next
+ *          write.
+ */
+void conn_policy_init(void);
+
+
+/**@brief Function for handling BLE events, called for every event.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ */
+void conn_policy_on_ble_evt(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Function for handling Connection Parameters Module events.
+ *
+ * @details A central refusing the parameters only costs speed or power, the link is kept.
+ *
+ * @param[in] p_evt  Event received from the Connection Parameters Module.
+ */
+void conn_policy_on_conn_params_evt(const ble_conn_params_evt_t* p_evt);
+
+
+/**@brief Function for getting the policy counters. */
+const conn_policy_stats_t* conn_policy_stats_get(void);
+
+
+/**@brief Function for logging the policy counters. */
+void conn_policy_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
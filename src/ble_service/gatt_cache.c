@@ -0,0 +1,239 @@
+#include "gatt_cache.h"
+#include "config.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "sdk_macros.h"
+#include "nrf_crypto.h"
+#include "nrf_log.h"
+#include "fds.h"
+#include "peer_manager.h"
+
+
+static uint32_t                 m_hash[GATT_CACHE_HASH_LEN / sizeof(uint32_t)];    /**< Database hash, word aligned for FDS */
+static fds_record_desc_t        m_record_desc;
+static bool                     m_record_found;
+static bool                     m_store_pending;                                    /**< Hash still to be written, the FDS queue was full */
+static bool                     m_gc_pending;                                       /**< Hash to be written once garbage collection completes */
+static bool                     m_gc_done;                                          /**< Garbage collection already ran for this write */
+
+static gatt_cache_stats_t       m_stats;
+static uint16_t                 m_conn_interval;        /**< Current connection interval, 1.25 ms units */
+static uint32_t                 m_window_start;         /**< RTC ticks at connection, or encryption if the link is encrypted */
+static bool                     m_first_write_seen;
+
+
+/**@brief Function for computing the database hash.
+ *
+ * @details SHA-256, truncated, over the handle, UUID and permissions of every attribute. Any
+ *          change that moves a handle or changes what a client may do with an attribute changes
+ *          the hash. Vendor UUIDs are hashed by their index, the bases are added in a fixed
+ *          order.
+ */
+static ret_code_t hash_compute(void) {
+    nrf_crypto_hash_context_t       context;
+    nrf_crypto_hash_sha256_digest_t digest;
+    size_t                          digest_len = sizeof(digest);
+
+    ret_code_t err_code = nrf_crypto_hash_init(&context, &g_nrf_crypto_hash_sha256_info);
+    VERIFY_SUCCESS(err_code);
+
+    for (uint16_t handle = BLE_GATT_HANDLE_START; handle != BLE_GATT_HANDLE_END; ++handle) {
+        ble_uuid_t          uuid;
+        ble_gatts_attr_md_t md;
+
+        // Handles are contiguous, the first one not found is the end of the table
+        if (sd_ble_gatts_attr_get(handle, &uuid, &md) != NRF_SUCCESS) {
+            break;
+        }
+
+        const uint8_t attr[] = {
+            (uint8_t)handle,
+            (uint8_t)(handle >> 8),
+            (uint8_t)uuid.uuid,
+            (uint8_t)(uuid.uuid >> 8),
+            uuid.type,
+            (uint8_t)((md.read_perm.sm << 4) | md.read_perm.lv),
+            (uint8_t)((md.write_perm.sm << 4) | md.write_perm.lv),
+            (uint8_t)((md.vlen << 2) | (md.rd_auth << 1) | md.wr_auth)
+        };
+        err_code = nrf_crypto_hash_update(&context, attr, sizeof(attr));
+        VERIFY_SUCCESS(err_code);
+    }
+
+    err_code = nrf_crypto_hash_finalize(&context, digest, &digest_len);
+    VERIFY_SUCCESS(err_code);
+
+    memcpy(m_hash, digest, GATT_CACHE_HASH_LEN);
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for queueing the write of the database hash.
+ *
+ * @details If the FDS queue is full, the write is retried on the next FDS event. If flash is
+ *          full, it is retried once garbage collection completes, and given up if that freed
+ *          nothing, so a flash full of valid records does not collect forever.
+ */
+static void hash_store(void) {
+    fds_record_t record;
+    ret_code_t   err_code;
+
+    record.file_id           = GATT_CACHE_FILE_ID;
+    record.key               = GATT_CACHE_HASH_KEY;
+    record.data.p_data       = m_hash;
+    record.data.length_words = sizeof(m_hash) / sizeof(uint32_t);
+
+    if (m_record_found) {
+        err_code = fds_record_update(&m_record_desc, &record);
+    }
+    else {
+        err_code = fds_record_write(&m_record_desc, &record);
+    }
+
+    m_store_pending = (err_code == FDS_ERR_NO_SPACE_IN_QUEUES);
+    if (err_code == NRF_SUCCESS) {
+        m_record_found = true;
+        m_gc_done      = false;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH && m_gc_done) {
+        NRF_LOG_WARNING("GATT cache: no flash left for the database hash");
+        m_gc_done = false;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH) {
+        err_code = fds_gc();
+        m_gc_pending    = (err_code == NRF_SUCCESS);
+        m_store_pending = (err_code == FDS_ERR_NO_SPACE_IN_QUEUES);
+        if (err_code != NRF_SUCCESS && err_code != FDS_ERR_NO_SPACE_IN_QUEUES) {
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+    else if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for comparing the database hash with the one stored, once FDS is ready.
+ *
+ * @details Bonded peers cache the handles, tell them through Service Changed when the table
+ *          changed, e.g. after a firmware update.
+ */
+static void hash_check(void) {
+    fds_find_token_t   token = {0};
+    fds_flash_record_t record;
+
+    ret_code_t err_code = fds_record_find(GATT_CACHE_FILE_ID, GATT_CACHE_HASH_KEY, &m_record_desc, &token);
+    if (err_code == NRF_SUCCESS) {
+        err_code = fds_record_open(&m_record_desc, &record);
+        APP_ERROR_CHECK(err_code);
+        const bool same = (memcmp(record.p_data, m_hash, sizeof(m_hash)) == 0);
+        err_code = fds_record_close(&m_record_desc);
+        APP_ERROR_CHECK(err_code);
+
+        m_record_found = true;
+        if (same) {
+            return;
+        }
+    }
+    else if (err_code != FDS_ERR_NOT_FOUND) {
+        APP_ERROR_CHECK(err_code);
+    }
+
+    NRF_LOG_INFO("GATT database changed, sending Service Changed to bonded peers");
+    ++m_stats.db_changes;
+    pm_local_database_has_changed();
+    hash_store();
+}
+
+
+/**@brief Function for handling FDS events.
+ */
+static void fds_evt_handler(const fds_evt_t* p_evt) {
+    if (p_evt->id == FDS_EVT_INIT && p_evt->result == NRF_SUCCESS) {
+        hash_check();
+    }
+    else if (p_evt->id == FDS_EVT_GC && m_gc_pending) {
+        m_gc_pending = false;
+        m_gc_done    = true;
+        hash_store();
+    }
+    else if (m_store_pending) {
+        hash_store();
+    }
+}
+
+
+/**@brief Function for checking if the first write of a connection came too soon for the client
+ *        to have discovered the services.
+ *
+ * @details Discovering the services takes at least GATT_CACHE_SKIP_EVENTS round trips, one per
+ *          connection event at best. A client writing earlier used its cached handles.
+ */
+static void on_write(void) {
+    if (m_first_write_seen) {
+        return;
+    }
+    m_first_write_seen = true;
+
+    const uint32_t window_ms = (GATT_CACHE_SKIP_EVENTS * m_conn_interval * 5) / 4;
+    if (app_timer_cnt_diff_compute(app_timer_cnt_get(), m_window_start) < APP_TIMER_TICKS(window_ms)) {
+        ++m_stats.discovery_skipped;
+    }
+}
+
+
+ret_code_t gatt_cache_init(void) {
+    const ret_code_t err_code = hash_compute();
+    VERIFY_SUCCESS(err_code);
+
+    return fds_register(fds_evt_handler);
+}
+
+
+void gatt_cache_on_ble_evt(const ble_evt_t* p_ble_evt) {
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONNECTED:
+            ++m_stats.connections;
+            m_conn_interval    = p_ble_evt->evt.gap_evt.params.connected.conn_params.max_conn_interval;
+            m_window_start     = app_timer_cnt_get();
+            m_first_write_seen = false;
+            break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            NRF_LOG_INFO("GATT cache: %u of %u connections skipped discovery",
+                         m_stats.discovery_skipped, m_stats.connections);
+            break;
+
+        case BLE_GAP_EVT_CONN_PARAM_UPDATE:
+            m_conn_interval = p_ble_evt->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval;
+            break;
+
+        case BLE_GAP_EVT_CONN_SEC_UPDATE:
+            // Bonded clients write once the link is encrypted
+            if (p_ble_evt->evt.gap_evt.params.conn_sec_update.conn_sec.sec_mode.lv >= 2 && !m_first_write_seen) {
+                m_window_start = app_timer_cnt_get();
+            }
+            break;
+
+        case BLE_GATTS_EVT_WRITE:
+            on_write();
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+const uint8_t* gatt_cache_hash_get(void) {
+    return (const uint8_t*)m_hash;
+}
+
+
+const gatt_cache_stats_t* gatt_cache_stats_get(void) {
+    return &m_stats;
+}
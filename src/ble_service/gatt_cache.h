@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ble.h"
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define GATT_CACHE_HASH_LEN     16      /**< Length of the database hash kept in flash */
+
+
+/**@brief GATT caching counters, since boot */
+typedef struct {
+    uint32_t connections;           /**< Connections */
+    uint32_t discovery_skipped;     /**< Connections whose first write came too soon for a service discovery */
+    uint32_t db_changes;            /**< Boots with a database different from the stored one, 0 or 1 */
+} gatt_cache_stats_t;
+
+
+/**@brief Function for initializing GATT caching, once all services are added.
+ *
+ * @details Computes the hash of the attribute table. Once FDS is initialized the hash is
+ *          compared with the one stored in flash, and if it differs bonded peers are told
+ *          through Service Changed and the new hash is stored. Handles are only assigned by the
+ *          order services are added in, so they are stable across boots as long as the hash is.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t gatt_cache_init(void);
+
+
+/**@brief Function for handling BLE events, called for every event.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ */
+void gatt_cache_on_ble_evt(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Function for getting the database hash. */
+const uint8_t* gatt_cache_hash_get(void);
+
+
+/**@brief Function for getting the GATT caching counters. */
+const gatt_cache_stats_t* gatt_cache_stats_get(void);
+
+
+#ifdef __cplusplus
+}
+#endif
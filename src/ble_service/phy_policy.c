@@ -0,0 +1,171 @@
+#include "phy_policy.h"
+#include "config.h"
+
+#include "ble_hci.h"
+#include "app_error.h"
+#include "app_util.h"
+#include "nrf_log.h"
+
+
+STATIC_ASSERT(PHY_POLICY_CODED_RSSI_DBM + PHY_POLICY_HYSTERESIS_DB < PHY_POLICY_2M_RSSI_DBM - PHY_POLICY_HYSTERESIS_DB);
+
+
+static phy_policy_conn_t  m_conn = {.phy = BLE_GAP_PHY_1MBPS};
+static phy_policy_stats_t m_stats;
+static uint16_t           m_conn_handle = BLE_CONN_HANDLE_INVALID;
+static uint8_t            m_pending;            /**< PHY requested and not yet reported by BLE_GAP_EVT_PHY_UPDATE, 0 if none */
+static bool               m_rssi_valid;         /**< m_conn.rssi holds at least one sample */
+
+
+/**@brief Function for picking the PHY for an RSSI, with hysteresis around the current PHY.
+ */
+static uint8_t phy_target(int8_t rssi, uint8_t current) {
+    if (rssi >= PHY_POLICY_2M_RSSI_DBM) {
+        return BLE_GAP_PHY_2MBPS;
+    }
+    if (rssi <= PHY_POLICY_CODED_RSSI_DBM) {
+        return BLE_GAP_PHY_CODED;
+    }
+    if (current == BLE_GAP_PHY_2MBPS && rssi > PHY_POLICY_2M_RSSI_DBM - PHY_POLICY_HYSTERESIS_DB) {
+        return BLE_GAP_PHY_2MBPS;
+    }
+    if (current == BLE_GAP_PHY_CODED && rssi < PHY_POLICY_CODED_RSSI_DBM + PHY_POLICY_HYSTERESIS_DB) {
+        return BLE_GAP_PHY_CODED;
+    }
+    return BLE_GAP_PHY_1MBPS;
+}
+
+
+/**@brief Function for updating the filtered RSSI and requesting a PHY change if needed.
+ */
+static void on_rssi_changed(int8_t rssi) {
+    // Exponential average over about 4 samples, the SoftDevice already drops small changes
+    m_conn.rssi  = m_rssi_valid ? (int8_t)((3 * m_conn.rssi + rssi) / 4) : rssi;
+    m_rssi_valid = true;
+
+    const uint8_t target = phy_target(m_conn.rssi, m_conn.phy);
+    if (target == m_conn.phy || m_pending != 0 || (target & m_conn.refused) != 0) {
+        return;
+    }
+
+    const ble_gap_phys_t phys = {
+        .tx_phys = target,
+        .rx_phys = target
+    };
+    const ret_code_t err_code = sd_ble_gap_phy_update(m_conn_handle, &phys);
+    if (err_code != NRF_SUCCESS) {
+        // Retried on the next RSSI change
+        ++m_stats.request_errors;
+        return;
+    }
+
+    ++m_stats.requests;
+    m_pending = target;
+}
+
+
+/**@brief Function for recording the outcome of a PHY update procedure.
+ */
+static void on_phy_update(const ble_gap_evt_phy_update_t* p_update) {
+    if (m_pending != 0 && (p_update->status != BLE_HCI_STATUS_CODE_SUCCESS || p_update->tx_phy != m_pending)) {
+        // The central does not support it, or does not want it
+        ++m_stats.refused;
+        m_conn.refused |= m_pending;
+    }
+    m_pending = 0;
+
+    if (p_update->status == BLE_HCI_STATUS_CODE_SUCCESS && p_update->tx_phy != m_conn.phy) {
+        m_conn.phy = p_update->tx_phy;
+        ++m_conn.switches;
+    }
+}
+
+
+/**@brief Function for reporting the PHY of a connection that ended.
+ */
+static void on_disconnected(void) {
+    switch (m_conn.phy) {
+        case BLE_GAP_PHY_2MBPS:
+            ++m_stats.conns_2m;
+            break;
+
+        case BLE_GAP_PHY_CODED:
+            ++m_stats.conns_coded;
+            break;
+
+        default:
+            ++m_stats.conns_1m;
+            break;
+    }
+
+    NRF_LOG_INFO("PHY: ended on %s, %u switches, RSSI %d dBm",
+                 phy_policy_phy_name(m_conn.phy), m_conn.switches, m_conn.rssi);
+}
+
+
+void phy_policy_on_ble_evt(const ble_evt_t* p_ble_evt) {
+    const ble_gap_evt_t* p_gap_evt = &p_ble_evt->evt.gap_evt;
+
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_CONNECTED: {
+            m_conn_handle = p_gap_evt->conn_handle;
+            m_conn        = (phy_policy_conn_t){.phy = BLE_GAP_PHY_1MBPS};
+            m_pending     = 0;
+            m_rssi_valid  = false;
+
+            const ret_code_t err_code = sd_ble_gap_rssi_start(m_conn_handle,
+                                                              PHY_POLICY_RSSI_THRESHOLD_DB,
+                                                              PHY_POLICY_RSSI_SKIP_COUNT);
+            APP_ERROR_CHECK(err_code);
+        } break;
+
+        case BLE_GAP_EVT_DISCONNECTED:
+            if (p_gap_evt->conn_handle == m_conn_handle) {
+                m_conn_handle = BLE_CONN_HANDLE_INVALID;
+                on_disconnected();
+            }
+            break;
+
+        case BLE_GAP_EVT_RSSI_CHANGED:
+            if (p_gap_evt->conn_handle == m_conn_handle) {
+                on_rssi_changed(p_gap_evt->params.rssi_changed.rssi);
+            }
+            break;
+
+        case BLE_GAP_EVT_PHY_UPDATE:
+            if (p_gap_evt->conn_handle == m_conn_handle) {
+                on_phy_update(&p_gap_evt->params.phy_update);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+const phy_policy_conn_t* phy_policy_conn_get(void) {
+    return &m_conn;
+}
+
+
+const phy_policy_stats_t* phy_policy_stats_get(void) {
+    return &m_stats;
+}
+
+
+const char* phy_policy_phy_name(uint8_t phy) {
+    switch (phy) {
+        case BLE_GAP_PHY_1MBPS:
+            return "1M";
+
+        case BLE_GAP_PHY_2MBPS:
+            return "2M";
+
+        case BLE_GAP_PHY_CODED:
+            return "Coded";
+
+        default:
+            return "?";
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ble.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief PHY report of one connection */
+typedef struct {
+    uint8_t  phy;               /**< Current PHY, BLE_GAP_PHY_1MBPS, BLE_GAP_PHY_2MBPS or BLE_GAP_PHY_CODED */
+    uint8_t  refused;           /**< PHYs the central did not switch to, not requested again on this link */
+    int8_t   rssi;              /**< Filtered RSSI, dBm */
+    uint16_t switches;          /**< PHY changes on this link */
+} phy_policy_conn_t;
+
+/**@brief PHY policy counters, since boot */
+typedef struct {
+    uint32_t conns_1m;          /**< Connections that ended on 1M */
+    uint32_t conns_2m;          /**< Connections that ended on 2M */
+    uint32_t conns_coded;       /**< Connections that ended on Coded */
+    uint32_t requests;          /**< PHY updates requested by the policy */
+    uint32_t request_errors;    /**< Requests the SoftDevice refused, e.g. with a procedure in progress */
+    uint32_t refused;           /**< Requests the central answered with another PHY */
+} phy_policy_stats_t;
+
+
+/**@brief Function for handling BLE events, called for every event.
+ *
+ * @details The link starts on 1M. RSSI reporting is started on connect, and every change
+ *          updates a filtered RSSI. The policy requests 2M at PHY_POLICY_2M_RSSI_DBM and up,
+ *          Coded at PHY_POLICY_CODED_RSSI_DBM and down, and 1M in between. A link leaves 2M or
+ *          Coded only once the RSSI is PHY_POLICY_HYSTERESIS_DB past the threshold.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ */
+void phy_policy_on_ble_evt(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Function for getting the report of the current connection, or of the last one if not
+ *        connected. */
+const phy_policy_conn_t* phy_policy_conn_get(void);
+
+
+/**@brief Function for getting the policy counters. */
+const phy_policy_stats_t* phy_policy_stats_get(void);
+
+
+/**@brief Function for getting the name of a PHY, for logs and reports. */
+const char* phy_policy_phy_name(uint8_t phy);
+
+
+#ifdef __cplusplus
+}
+#endif
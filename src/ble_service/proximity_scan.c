@@ -0,0 +1,306 @@
+#include "proximity_scan.h"
+#include "config.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "app_error.h"
+#include "app_util.h"
+#include "ble_gap.h"
+#include "sdk_macros.h"
+#include "nrf_log.h"
+#include "time_service/local_time.h"
+
+
+STATIC_ASSERT(PROXIMITY_REARM_RSSI_DBM < PROXIMITY_UNLOCK_RSSI_DBM);
+STATIC_ASSERT(PROXIMITY_SCAN_WINDOW_MS <= PROXIMITY_BOOST_INTERVAL_MS);
+STATIC_ASSERT(PROXIMITY_BOOST_INTERVAL_MS <= PROXIMITY_ACTIVE_INTERVAL_MS);
+STATIC_ASSERT(PROXIMITY_SCAN_PERIOD_S * 100 <= UINT16_MAX);
+STATIC_ASSERT(PROXIMITY_BOOST_S <= PROXIMITY_SCAN_PERIOD_S);
+
+
+#define MANUF_DATA_LEN  (2 + UNLOCK_AUTH_COMMAND_LEN)   /**< Company identifier and command. */
+
+
+/**@brief Enrolled wearable in range */
+typedef struct {
+    uint16_t cred_id;                                   /**< Credential of the wearable, 0 if the slot is free */
+    int8_t   rssi[PROXIMITY_RSSI_WINDOW];               /**< Last RSSI samples, a ring */
+    uint8_t  rssi_count;                                /**< Samples in the ring, up to PROXIMITY_RSSI_WINDOW */
+    uint8_t  rssi_next;                                 /**< Next sample slot */
+    int16_t  rssi_sum;                                  /**< Sum of the samples in the ring */
+    bool     armed;                                     /**< Can unlock, cleared by an unlock until the wearable walks away */
+    bool     heard;                                     /**< Heard during the current scan period */
+    bool     boosted;                                   /**< Has had its boost period since it came in range or was rearmed */
+    uint8_t  rejected_mac[UNLOCK_AUTH_MAC_LEN];         /**< MAC of the last command that failed verification, not tried again */
+} wearable_t;
+
+
+static proximity_scan_unlock_handler_t m_handler;
+static proximity_scan_stats_t          m_stats;
+static bool                            m_boosting;     /**< The current scan period is a boost period */
+static wearable_t                      m_wearables[UNLOCK_AUTH_MAX_CREDENTIALS];
+static uint8_t                         m_scan_buffer[BLE_GAP_SCAN_BUFFER_MIN];
+static ble_data_t                      m_scan_data = {
+    .p_data = m_scan_buffer,
+    .len    = sizeof(m_scan_buffer)
+};
+
+
+/**@brief Function for checking if the local time is within active hours.
+ */
+static bool active_hours(void) {
+    if (!local_time_is_set()) {
+        return false;
+    }
+
+    const uint8_t hour = local_time_hour_of_day();
+    return hour >= PROXIMITY_ACTIVE_FROM_HOUR && hour < PROXIMITY_ACTIVE_TO_HOUR;
+}
+
+
+/**@brief Function for starting a scan period.
+ *
+ * @param[in] boost  true for a boost period, false for a period at the duty cycle of the local time.
+ */
+static ret_code_t scan_start(bool boost) {
+    const bool     active      = !boost && active_hours();
+    const uint32_t interval_ms = boost ? PROXIMITY_BOOST_INTERVAL_MS
+                                       : (active ? PROXIMITY_ACTIVE_INTERVAL_MS : PROXIMITY_QUIET_INTERVAL_MS);
+
+    ble_gap_scan_params_t params;
+    memset(&params, 0, sizeof(params));
+    params.active        = 0;
+    params.interval      = MSEC_TO_UNITS(interval_ms, UNIT_0_625_MS);
+    params.window        = MSEC_TO_UNITS(PROXIMITY_SCAN_WINDOW_MS, UNIT_0_625_MS);
+    params.timeout       = (boost ? PROXIMITY_BOOST_S : PROXIMITY_SCAN_PERIOD_S) * 100;
+    params.scan_phys     = BLE_GAP_PHY_1MBPS;
+    params.filter_policy = BLE_GAP_SCAN_FP_ACCEPT_ALL;
+
+    const ret_code_t err_code = sd_ble_gap_scan_start(&params, &m_scan_data);
+    VERIFY_SUCCESS(err_code);
+
+    m_boosting = boost;
+    if (boost) {
+        ++m_stats.boost_periods;
+    }
+    else if (active) {
+        ++m_stats.active_periods;
+    }
+    else {
+        ++m_stats.quiet_periods;
+    }
+    return NRF_SUCCESS;
+}
+
+
+/**@brief Function for finding the unlock command in an advertisement.
+ *
+ * @param[in] p_data  Advertising data.
+ * @param[in] len     Advertising data length.
+ *
+ * @return Command, @ref UNLOCK_AUTH_COMMAND_LEN bytes, or NULL if there is none.
+ */
+static const uint8_t* command_find(const uint8_t* p_data, uint16_t len) {
+    uint16_t offset = 0;
+
+    // AD structures: length, type, data
+    while (offset + 1 < len && p_data[offset] != 0) {
+        const uint8_t field_len = p_data[offset];
+        if (offset + 1 + field_len > len) {
+            return NULL;
+        }
+
+        const uint8_t* p_field = &p_data[offset + 2];
+        if (p_data[offset + 1] == BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA &&
+            field_len - 1 == MANUF_DATA_LEN &&
+            uint16_decode(p_field) == ADV_COMPANY_IDENTIFIER &&
+            p_field[2] == UNLOCK_AUTH_OP_UNLOCK) {
+            return &p_field[2];
+        }
+
+        offset += 1 + field_len;
+    }
+
+    return NULL;
+}
+
+
+/**@brief Function for finding the slot of a wearable, or a free one for a new wearable.
+ */
+static wearable_t* wearable_get(uint16_t cred_id) {
+    wearable_t* p_free = NULL;
+
+    for (unsigned int i = 0; i < ARRAY_SIZE(m_wearables); ++i) {
+        if (m_wearables[i].cred_id == cred_id) {
+            return &m_wearables[i];
+        }
+        if (m_wearables[i].cred_id == 0 && p_free == NULL) {
+            p_free = &m_wearables[i];
+        }
+    }
+
+    if (p_free != NULL) {
+        memset(p_free, 0, sizeof(*p_free));
+        p_free->cred_id = cred_id;
+        p_free->armed   = true;
+    }
+    return p_free;
+}
+
+
+/**@brief Function for verifying the command of a wearable that came close.
+ */
+static void wearable_unlock(wearable_t* p_wearable, const uint8_t* p_command) {
+    const uint8_t* p_mac = &p_command[UNLOCK_AUTH_SIGNED_LEN];
+
+    // The wearable keeps advertising a rejected command until it signs a new one
+    if (memcmp(p_mac, p_wearable->rejected_mac, UNLOCK_AUTH_MAC_LEN) == 0) {
+        return;
+    }
+
+    unlock_auth_command_t command;
+    ret_code_t err_code = unlock_auth_command_verify(p_command, UNLOCK_AUTH_COMMAND_LEN, &command);
+    if (err_code == NRF_ERROR_BUSY) {
+        // Counter not read from flash yet, try again on the next advertisement
+        return;
+    }
+    if (err_code == NRF_SUCCESS && command.opcode != UNLOCK_AUTH_OP_UNLOCK) {
+        // Locking and enrolling need a connection
+        err_code = NRF_ERROR_NOT_SUPPORTED;
+    }
+    if (err_code != NRF_SUCCESS) {
+        NRF_LOG_WARNING("Wearable 0x%04x rejected: 0x%x", p_wearable->cred_id, err_code);
+        memcpy(p_wearable->rejected_mac, p_mac, UNLOCK_AUTH_MAC_LEN);
+        ++m_stats.rejected;
+        return;
+    }
+
+    NRF_LOG_INFO("Wearable 0x%04x unlocked at %d dBm", p_wearable->cred_id,
+                 p_wearable->rssi_sum / PROXIMITY_RSSI_WINDOW);
+    p_wearable->armed = false;
+    ++m_stats.unlocks;
+    m_handler(&command);
+}
+
+
+/**@brief Function for handling an advertising report.
+ */
+static void on_adv_report(const ble_gap_evt_adv_report_t* p_report) {
+    bool           boost     = false;
+    const uint8_t* p_command = command_find(p_report->data.p_data, p_report->data.len);
+    if (p_command != NULL) {
+        const uint16_t cred_id    = uint16_decode(&p_command[1]);
+        wearable_t*    p_wearable = unlock_auth_credential_exists(cred_id) ? wearable_get(cred_id) : NULL;
+
+        if (p_wearable != NULL) {
+            ++m_stats.reports;
+
+            // Moving average over the last PROXIMITY_RSSI_WINDOW advertisements
+            if (p_wearable->rssi_count == PROXIMITY_RSSI_WINDOW) {
+                p_wearable->rssi_sum -= p_wearable->rssi[p_wearable->rssi_next];
+            }
+            else {
+                ++p_wearable->rssi_count;
+            }
+            p_wearable->rssi[p_wearable->rssi_next] = p_report->rssi;
+            p_wearable->rssi_sum                   += p_report->rssi;
+            p_wearable->rssi_next                   = (p_wearable->rssi_next + 1) % PROXIMITY_RSSI_WINDOW;
+            p_wearable->heard                       = true;
+
+            // At the quiet duty cycle, filling the window would take about a minute. An armed
+            // wearable gets one boost period to walk up to the door.
+            if (p_wearable->armed && !p_wearable->boosted && !m_boosting) {
+                p_wearable->boosted = true;
+                boost = true;
+            }
+
+            // Only a full window, a single strong packet does not unlock
+            if (p_wearable->rssi_count == PROXIMITY_RSSI_WINDOW) {
+                if (p_wearable->armed && p_wearable->rssi_sum >= PROXIMITY_UNLOCK_RSSI_DBM * PROXIMITY_RSSI_WINDOW) {
+                    wearable_unlock(p_wearable, p_command);
+                }
+                else if (!p_wearable->armed && p_wearable->rssi_sum <= PROXIMITY_REARM_RSSI_DBM * PROXIMITY_RSSI_WINDOW) {
+                    p_wearable->armed   = true;
+                    p_wearable->boosted = false;
+                }
+            }
+        }
+    }
+
+    // The SoftDevice pauses scanning for every report until the buffer is handed back, a boost
+    // needs new parameters so the scanner is restarted instead
+    ret_code_t err_code;
+    if (boost) {
+        err_code = sd_ble_gap_scan_stop();
+        APP_ERROR_CHECK(err_code);
+
+        err_code = scan_start(true);
+    }
+    else {
+        err_code = sd_ble_gap_scan_start(NULL, &m_scan_data);
+    }
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for ending a scan period and starting the next one.
+ */
+static void on_scan_timeout(void) {
+    for (unsigned int i = 0; i < ARRAY_SIZE(m_wearables); ++i) {
+        wearable_t* p_wearable = &m_wearables[i];
+        if (p_wearable->cred_id == 0) {
+            continue;
+        }
+
+        // Gone for a whole period, it walked away
+        if (!p_wearable->heard) {
+            p_wearable->cred_id = 0;
+            ++m_stats.lost;
+        }
+        p_wearable->heard = false;
+    }
+
+    const ret_code_t err_code = scan_start(false);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+ret_code_t proximity_scan_init(proximity_scan_unlock_handler_t handler) {
+    VERIFY_PARAM_NOT_NULL(handler);
+
+    m_handler = handler;
+    return scan_start(false);
+}
+
+
+void proximity_scan_on_ble_evt(const ble_evt_t* p_ble_evt) {
+    const ble_gap_evt_t* p_gap_evt = &p_ble_evt->evt.gap_evt;
+
+    switch (p_ble_evt->header.evt_id) {
+        case BLE_GAP_EVT_ADV_REPORT:
+            on_adv_report(&p_gap_evt->params.adv_report);
+            break;
+
+        case BLE_GAP_EVT_TIMEOUT:
+            if (p_gap_evt->params.timeout.src == BLE_GAP_TIMEOUT_SRC_SCAN) {
+                on_scan_timeout();
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+const proximity_scan_stats_t* proximity_scan_stats_get(void) {
+    return &m_stats;
+}
+
+
+void proximity_scan_log(void) {
+    NRF_LOG_INFO("Proximity: %u unlocks, %u rejected, %u lost, periods %u active %u quiet %u boost",
+                 m_stats.unlocks, m_stats.rejected, m_stats.lost,
+                 m_stats.active_periods, m_stats.quiet_periods, m_stats.boost_periods);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ble.h"
+#include "sdk_errors.h"
+#include "auth_service/unlock_auth.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Proximity unlock counters, since boot */
+typedef struct {
+    uint32_t reports;           /**< Advertisements from enrolled wearables */
+    uint32_t unlocks;           /**< Unlocks by an approaching wearable */
+    uint32_t rejected;          /**< Commands that failed verification when a wearable came close */
+    uint32_t lost;              /**< Wearables forgotten after a scan period without advertisements */
+    uint32_t active_periods;    /**< Scan periods at the active hours duty cycle */
+    uint32_t quiet_periods;     /**< Scan periods at the quiet duty cycle */
+    uint32_t boost_periods;     /**< Scan periods boosted for an approaching wearable */
+} proximity_scan_stats_t;
+
+
+/**@brief Proximity unlock handler type, called with the verified unlock command.
+ */
+typedef void (*proximity_scan_unlock_handler_t)(const unlock_auth_command_t* p_command);
+
+
+/**@brief Function for initializing proximity unlock and starting to scan.
+ *
+ * @details Wearables advertise an unlock command, as written to the command characteristic, as
+ *          manufacturer specific data with company identifier ADV_COMPANY_IDENTIFIER. They
+ *          sign it over the challenge in the scan response of the lock, like phones do. The
+ *          scanner is passive and runs alongside advertising and connections.
+ *
+ *          The RSSI of every enrolled wearable is averaged over its last PROXIMITY_RSSI_WINDOW
+ *          advertisements. When the average reaches PROXIMITY_UNLOCK_RSSI_DBM, the command is
+ *          verified and, if it is an accepted unlock command, @p handler is called. The wearable
+ *          can only unlock again once its average drops to PROXIMITY_REARM_RSSI_DBM or it is not
+ *          heard for a scan period.
+ *
+ *          Every PROXIMITY_SCAN_PERIOD_S the duty cycle is picked from the local time:
+ *          PROXIMITY_ACTIVE_INTERVAL_MS from PROXIMITY_ACTIVE_FROM_HOUR to
+ *          PROXIMITY_ACTIVE_TO_HOUR, PROXIMITY_QUIET_INTERVAL_MS otherwise or while the time
+ *          is unknown. When an armed wearable is first heard, the scanner switches to
+ *          PROXIMITY_BOOST_INTERVAL_MS for PROXIMITY_BOOST_S, so the RSSI window fills in
+ *          seconds. A wearable gets one boost until it unlocks and walks away, or is forgotten.
+ *
+ * @param[in] handler  Called when a wearable unlocks.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t proximity_scan_init(proximity_scan_unlock_handler_t handler);
+
+
+/**@brief Function for handling BLE events, called for every event.
+ *
+ * @param[in] p_ble_evt  Bluetooth stack event.
+ */
+void proximity_scan_on_ble_evt(const ble_evt_t* p_ble_evt);
+
+
+/**@brief Function for getting the proximity unlock counters. */
+const proximity_scan_stats_t* proximity_scan_stats_get(void);
+
+
+/**@brief Function for logging the proximity unlock counters. */
+void proximity_scan_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
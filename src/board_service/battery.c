@@ -0,0 +1,103 @@
+#include "battery.h"
+#include "config.h"
+
+#include "app_timer.h"
+#include "app_util.h"
+#include "sdk_macros.h"
+
+#ifndef HOST_SIM
+#include "nrf_saadc.h"
+#endif
+
+
+STATIC_ASSERT(BATTERY_EMPTY_MV < BATTERY_FULL_MV);
+
+// VDD through the 1/6 gain against the 0.6 V internal reference, on 12 bits
+#define VDD_FULL_SCALE_MV   3600
+#define SAMPLE_FULL_SCALE   4096
+
+
+APP_TIMER_DEF(m_sample_timer);
+
+static uint16_t m_vdd_mv;   /**< Supply voltage of the last measurement, in millivolts */
+
+
+/**@brief Function for measuring the supply voltage with one SAADC conversion.
+ */
+static uint16_t vdd_measure(void) {
+#ifndef HOST_SIM
+    nrf_saadc_value_t                sample  = 0;
+    const nrf_saadc_channel_config_t channel = {
+        .resistor_p = NRF_SAADC_RESISTOR_DISABLED,
+        .resistor_n = NRF_SAADC_RESISTOR_DISABLED,
+        .gain       = NRF_SAADC_GAIN1_6,
+        .reference  = NRF_SAADC_REFERENCE_INTERNAL,
+        .acq_time   = NRF_SAADC_ACQTIME_10US,
+        .mode       = NRF_SAADC_MODE_SINGLE_ENDED,
+        .burst      = NRF_SAADC_BURST_DISABLED,
+        .pin_p      = NRF_SAADC_INPUT_VDD,
+        .pin_n      = NRF_SAADC_INPUT_DISABLED
+    };
+
+    nrf_saadc_resolution_set(NRF_SAADC_RESOLUTION_12BIT);
+    nrf_saadc_oversample_set(NRF_SAADC_OVERSAMPLE_DISABLED);
+    nrf_saadc_enable();
+    nrf_saadc_channel_init(0, &channel);
+    nrf_saadc_buffer_init(&sample, 1);
+
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_STARTED);
+    nrf_saadc_task_trigger(NRF_SAADC_TASK_START);
+    while (!nrf_saadc_event_check(NRF_SAADC_EVENT_STARTED)) {
+    }
+
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_END);
+    nrf_saadc_task_trigger(NRF_SAADC_TASK_SAMPLE);
+    while (!nrf_saadc_event_check(NRF_SAADC_EVENT_END)) {
+    }
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_STARTED);
+    nrf_saadc_event_clear(NRF_SAADC_EVENT_END);
+
+    nrf_saadc_channel_input_set(0, NRF_SAADC_INPUT_DISABLED, NRF_SAADC_INPUT_DISABLED);
+    nrf_saadc_disable();
+
+    // Noise can take a single ended sample slightly below zero
+    return (sample > 0) ? (uint16_t)(((uint32_t)sample * VDD_FULL_SCALE_MV) / SAMPLE_FULL_SCALE) : 0;
+#else
+    return BATTERY_FULL_MV;
+#endif
+}
+
+
+/**@brief Called every BATTERY_SAMPLE_INTERVAL_MS to measure the supply voltage
+ *
+ * @param[in] p_context  Unused
+ */
+static void sample_timeout(void* p_context) {
+    m_vdd_mv = vdd_measure();
+}
+
+
+ret_code_t battery_init(void) {
+    m_vdd_mv = vdd_measure();
+
+    ret_code_t err_code = app_timer_create(&m_sample_timer, APP_TIMER_MODE_REPEATED, sample_timeout);
+    VERIFY_SUCCESS(err_code);
+
+    return app_timer_start(m_sample_timer, APP_TIMER_TICKS(BATTERY_SAMPLE_INTERVAL_MS), NULL);
+}
+
+
+uint16_t battery_vdd_get(void) {
+    return m_vdd_mv;
+}
+
+
+uint8_t battery_level_from_mv(uint16_t vdd_mv) {
+    if (vdd_mv <= BATTERY_EMPTY_MV) {
+        return 0;
+    }
+    if (vdd_mv >= BATTERY_FULL_MV) {
+        return 100;
+    }
+    return (uint8_t)(((uint32_t)(vdd_mv - BATTERY_EMPTY_MV) * 100) / (BATTERY_FULL_MV - BATTERY_EMPTY_MV));
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Function for initializing the battery monitor.
+ *
+ * @details Measures the supply voltage now and then every BATTERY_SAMPLE_INTERVAL_MS on an
+ *          application timer. Each measurement blocks for one SAADC conversion of VDD, a few tens
+ *          of microseconds. The SAADC is only enabled during the conversion, so it draws nothing
+ *          in between.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t battery_init(void);
+
+
+/**@brief Function for getting the supply voltage of the last measurement.
+ *
+ * @return Supply voltage, in millivolts.
+ */
+uint16_t battery_vdd_get(void);
+
+
+/**@brief Function for converting a supply voltage to a battery level.
+ *
+ * @param[in] vdd_mv  Supply voltage, in millivolts.
+ *
+ * @return Battery level in percent, linear from BATTERY_EMPTY_MV to BATTERY_FULL_MV.
+ */
+uint8_t battery_level_from_mv(uint16_t vdd_mv);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -13,6 +13,8 @@
 #include "app_timer.h"
 #include "fds.h"
 
+#include "diag_service/boot_profile.h"
+
 
 // Board services config storage
 static struct {
@@ -38,8 +40,6 @@ static void timers_init(void)
  */
 static void bsp_event_handler(bsp_event_t event)
 {
-    ret_code_t err_code;
-
     switch (event) {
         default:
             break;
@@ -105,8 +105,8 @@ void board_services_init(board_services_init_t* p_init) {
 
     board_services_config.bsp_evt_handler = p_init->bsp_evt_handler;
 
-    log_init();
-    timers_init();
-    buttons_leds_init(p_init->erase_bonds);
-    power_management_init();
+    BOOT_PROFILE_STEP(BOOT_STEP_LOG_INIT, log_init());
+    BOOT_PROFILE_STEP(BOOT_STEP_TIMERS_INIT, timers_init());
+    BOOT_PROFILE_STEP(BOOT_STEP_BSP_INIT, buttons_leds_init(p_init->erase_bonds));
+    BOOT_PROFILE_STEP(BOOT_STEP_POWER_INIT, power_management_init());
 }
\ No newline at end of file
@@ -9,21 +9,47 @@
 // BLE Services Config
 #define DEVICE_NAME                     "BLE_Door"                              /**< Name of device. Will be included in the advertising data. */
 #define MANUFACTURER_NAME               "NordicSemiconductor"                   /**< Manufacturer. Will be passed to Device Information Service. */
-#define APP_ADV_INTERVAL                300                                     /**< The advertising interval (in units of 0.625 ms. This value corresponds to 187.5 ms). */
-
-#define APP_ADV_DURATION                18000                                   /**< The advertising duration (180 seconds) in units of 10 milliseconds. */
+#define APP_ADV_DIRECTED_INTERVAL       160                                     /**< The low duty directed advertising interval, after the high duty one (100 ms). */
+#define APP_ADV_DIRECTED_DURATION       500                                     /**< The low duty directed advertising duration (5 seconds) in units of 10 milliseconds, the high duty one always lasts 1.28 seconds. */
+#define APP_ADV_WHITELIST_DURATION      1000                                    /**< How long the fast phase only accepts bonded peers (10 seconds) in units of 10 milliseconds. */
+#define APP_ADV_INTERVAL                300                                     /**< The fast advertising interval (in units of 0.625 ms. This value corresponds to 187.5 ms). */
+#define APP_ADV_DURATION                3000                                    /**< The fast advertising duration (30 seconds) in units of 10 milliseconds. */
+#define APP_ADV_SLOW_INTERVAL           668                                     /**< The slow advertising interval, after the fast phase (417.5 ms). */
+#define APP_ADV_SLOW_DURATION           18000                                   /**< The slow advertising duration (180 seconds) in units of 10 milliseconds. */
+#define APP_ADV_ULTRA_SLOW_INTERVAL     2056                                    /**< The advertising interval after the slow phase outside habitual arrival windows, until a connection or a button wake (1285 ms). */
+#define APP_ADV_SCHEDULE_CHECK_MS       60000                                   /**< How often the idle advertising interval is matched to the usage schedule (1 minute). */
+#define POWER_BUDGET_UA                 100                                     /**< Average current the lock must stay within at the default usage of the energy estimator, which checks it. */
+#define ADV_COMPANY_IDENTIFIER          0xFFFF                                  /**< Company identifier of the manufacturer specific data, 0xFFFF is reserved for testing. */
+#define ADV_MANUF_DATA_MAX_LEN          8                                       /**< Largest manufacturer specific scan response payload. */
+#define ADV_EXTENDED_ENABLED            0                                       /**< Advertise with extended advertising PDUs and the full status record, for sites where gateways watch many doors. Phones need Bluetooth 5 to see the lock. */
+#define ADV_STATUS_MAX_LEN              (ADV_EXTENDED_ENABLED ? 10 : 4)         /**< Largest status payload, manufacturer specific data of the advertising data. */
+#define ADV_SHORT_NAME_LEN              8                                       /**< Longest name in the scan response, longer names are shortened. */
+#define ADV_UUID128_MAX_COUNT           1                                       /**< 128-bit service UUIDs in the advertising data, for scanners filtering on them. */
 #define APP_BLE_OBSERVER_PRIO           3                                       /**< Application's BLE observer priority. You shouldn't need to modify this value. */
 #define APP_BLE_CONN_CFG_TAG            1                                       /**< A tag identifying the SoftDevice BLE configuration. */
+#define QWR_MAX_WRITE_LEN               512                                     /**< Longest value written with queued writes, a whole long command. */
+#define QWR_MEM_BUFF_SIZE               (QWR_MAX_WRITE_LEN + 6 * CEIL_DIV(QWR_MAX_WRITE_LEN, NRF_SDH_BLE_GATT_MAX_MTU_SIZE - 5) + 2)  /**< Queued write buffer: a 6 byte header per Prepare Write Request of up to ATT_MTU - 5 bytes, and a 2 byte end marker. */
 
-#define MIN_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)        /**< Minimum acceptable connection interval (0.1 seconds). */
-#define MAX_CONN_INTERVAL               MSEC_TO_UNITS(200, UNIT_1_25_MS)        /**< Maximum acceptable connection interval (0.2 second). */
-#define SLAVE_LATENCY                   0                                       /**< Slave latency. */
+#define MIN_CONN_INTERVAL               MSEC_TO_UNITS(100, UNIT_1_25_MS)        /**< Minimum connection interval once idle (0.1 seconds). */
+#define MAX_CONN_INTERVAL               MSEC_TO_UNITS(200, UNIT_1_25_MS)        /**< Maximum connection interval once idle (0.2 second). */
+#define SLAVE_LATENCY                   4                                       /**< Slave latency once idle. */
 #define CONN_SUP_TIMEOUT                MSEC_TO_UNITS(4000, UNIT_10_MS)         /**< Connection supervisory timeout (4 seconds). */
 
 #define FIRST_CONN_PARAMS_UPDATE_DELAY  APP_TIMER_TICKS(5000)                   /**< Time from initiating event (connect or start of notification) to first time sd_ble_gap_conn_param_update is called (5 seconds). */
 #define NEXT_CONN_PARAMS_UPDATE_DELAY   APP_TIMER_TICKS(30000)                  /**< Time between each call to sd_ble_gap_conn_param_update after the first call (30 seconds). */
 #define MAX_CONN_PARAMS_UPDATE_COUNT    3                                       /**< Number of attempts before giving up the connection parameter negotiation. */
 
+#define CONN_POLICY_FAST_MIN_INTERVAL   MSEC_TO_UNITS(7.5, UNIT_1_25_MS)        /**< Minimum connection interval requested on connect, for the unlock transaction (7.5 ms). */
+#define CONN_POLICY_FAST_MAX_INTERVAL   MSEC_TO_UNITS(15, UNIT_1_25_MS)         /**< Maximum connection interval requested on connect, for the unlock transaction (15 ms). */
+#define CONN_POLICY_FAST_SLAVE_LATENCY  0                                       /**< Slave latency requested on connect. */
+#define CONN_POLICY_IDLE_TIMEOUT_MS     2000                                    /**< Time without GATT activity before the link is relaxed to the idle parameters (2 seconds). */
+
+#define PHY_POLICY_2M_RSSI_DBM          -65                                     /**< Filtered RSSI at or above which the link is switched to 2M. */
+#define PHY_POLICY_CODED_RSSI_DBM       -85                                     /**< Filtered RSSI at or below which the link is switched to Coded. */
+#define PHY_POLICY_HYSTERESIS_DB        5                                       /**< RSSI margin past a threshold before the link goes back to 1M. */
+#define PHY_POLICY_RSSI_THRESHOLD_DB    2                                       /**< Smallest RSSI change reported by the SoftDevice. */
+#define PHY_POLICY_RSSI_SKIP_COUNT      4                                       /**< Samples an RSSI change must hold before it is reported. */
+
 #define SEC_PARAM_BOND                  1                                       /**< Perform bonding. */
 #define SEC_PARAM_MITM                  0                                       /**< Man In The Middle protection not required. */
 #define SEC_PARAM_LESC                  0                                       /**< LE Secure Connections not enabled. */
@@ -36,6 +62,68 @@
 #define CONNECTED_LED                   BSP_BOARD_LED_3                         /**< The LED that indicates an active connection */
 
 
+// GATT Caching Config
+#define GATT_CACHE_FILE_ID              0x1A01                                  /**< FDS file of the database hash. */
+#define GATT_CACHE_HASH_KEY             0x0001                                  /**< FDS record key of the database hash. */
+#define GATT_CACHE_SKIP_EVENTS          3                                       /**< A first write within this many connection intervals of connecting or encrypting skipped service discovery. */
+
+
+// Battery Config
+#define BATTERY_EMPTY_MV                2000                                    /**< Supply voltage reported as 0 % battery, two alkaline cells near their end. */
+#define BATTERY_FULL_MV                 3000                                    /**< Supply voltage reported as 100 % battery. */
+#define BATTERY_SAMPLE_INTERVAL_MS      600000                                  /**< Interval between supply voltage measurements (10 minutes), the advertised status carries the last one. */
+
+
 // BLE Door Lock Service Config
 #define DOOR_LOCK_BUTTON_EVT            BSP_EVENT_KEY_0                         /**< The button event fired when the door lock button is pressed */
 #define DOOR_LOCK_LED                   BSP_BOARD_LED_0                         /**< The LED that indicates the door is locked */
+#define DOOR_AUTOLOCK_TIMEOUT_MS        5000                                    /**< Time the door stays unlocked before it locks itself (5 seconds). */
+#define DOOR_ACK_LINGER_MS              500                                     /**< Longest time the link stays up after an unlock for the acknowledgement to be transmitted. */
+#define DOOR_RETRY_WINDOW_MS            30000                                   /**< An unlock by the same peer within this time of its previous one counts as a retry. */
+
+
+// Unlock Authentication Config
+#define UNLOCK_AUTH_MAX_CREDENTIALS     4                                       /**< Number of credentials the lock accepts commands from. */
+#define UNLOCK_AUTH_FILE_ID             0x1A00                                  /**< FDS file of the key and the last accepted counter of every credential. */
+#define UNLOCK_AUTH_CHALLENGE_ROTATE_MS 10000                                   /**< Time a challenge is published while advertising, the previous one is accepted for as long again. */
+#ifndef DOOR_DEV_KEY_ENABLED
+#define DOOR_DEV_KEY_ENABLED            0                                       /**< Provision the development credential at boot. Its key is public and can enroll credentials, so release builds refuse it. */
+#endif
+#define UNLOCK_AUTH_DEV_CRED_ID         0x0001                                  /**< Development credential, provisioned at boot with DOOR_DEV_KEY_ENABLED. */
+#define UNLOCK_AUTH_DEV_KEY             { 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,   \
+                                          0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,   \
+                                          0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57,   \
+                                          0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f }  /**< Key of the development credential. */
+#define AUTH_PREFETCH_PEERS             8                                       /**< Peers whose credential is remembered, to prepare the verification of their command on connect. */
+
+
+// Usage Schedule Config
+#define USAGE_SCHEDULE_FILE_ID          0x1A02                                  /**< FDS file of the unlock histogram. */
+#define USAGE_SCHEDULE_KEY              0x0001                                  /**< FDS record key of the unlock histogram. */
+#define USAGE_SCHEDULE_MIN_UNLOCKS      3                                       /**< Unlocks an hour of the week needs to be a habitual arrival window. */
+#define USAGE_SCHEDULE_PEAK_RATIO       4                                       /**< Times the mean unlocks per hour an hour of the week needs to be a habitual arrival window. */
+#define USAGE_SCHEDULE_STORE_BATCH      8                                       /**< Unlocks recorded between writes of the histogram, a reset loses fewer than this. */
+
+
+// Proximity Unlock Config
+#define PROXIMITY_SCAN_ENABLED          1                                       /**< Scan for enrolled wearables and unlock when one comes close. */
+#define PROXIMITY_UNLOCK_RSSI_DBM       -60                                     /**< Averaged RSSI at which an approaching wearable unlocks the door. */
+#define PROXIMITY_REARM_RSSI_DBM        -75                                     /**< Averaged RSSI at which a wearable has walked away and may unlock again. */
+#define PROXIMITY_RSSI_WINDOW           4                                       /**< Advertisements averaged per wearable. */
+#define PROXIMITY_SCAN_WINDOW_MS        30                                      /**< Time listened on one advertising channel every scan interval. */
+#define PROXIMITY_ACTIVE_INTERVAL_MS    4000                                    /**< Scan interval during active hours (0.75 % duty cycle), until a wearable is heard. */
+#define PROXIMITY_QUIET_INTERVAL_MS     10240                                   /**< Scan interval outside active hours, or until a phone sets the time (about 0.3 % duty cycle). */
+#define PROXIMITY_ACTIVE_FROM_HOUR      6                                       /**< Local hour active hours start at. */
+#define PROXIMITY_ACTIVE_TO_HOUR        23                                      /**< Local hour active hours end at. */
+#define PROXIMITY_SCAN_PERIOD_S         30                                      /**< Scan duration before the duty cycle is picked again; wearables not heard for a whole period are forgotten. */
+#define PROXIMITY_BOOST_INTERVAL_MS     120                                     /**< Scan interval once an armed wearable is first heard (25 % duty cycle), so its RSSI window fills in seconds. */
+#define PROXIMITY_BOOST_S               20                                      /**< Length of the boost, time for the wearable to walk up to the door. */
+
+
+// Diagnostics Config
+#define PROBE_ENABLED                   1                                       /**< Record hot path durations in probe histograms. */
+#define EVT_TRACE_ENABLED               1                                       /**< Record BLE events to RTT for replay in the host simulation. */
+#define EVT_TRACE_BUFFER_SIZE           2048                                    /**< Size of the RTT up buffer holding the BLE event trace. */
+#define BOOT_PROFILE_ENABLED            1                                       /**< Time every initialization step from main() to advertising_start and log it on boot. */
+#define CRYPTO_BENCH_ENABLED            0                                       /**< Benchmark the unlock authentication primitives once at boot and log the results. */
+#define CRYPTO_BENCH_ITERATIONS         16                                      /**< Timed verifications per primitive in the boot benchmark. */
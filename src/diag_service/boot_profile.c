@@ -0,0 +1,87 @@
+#include "boot_profile.h"
+
+#include <stdbool.h>
+
+#include "nrf_log.h"
+
+
+static probe_stamp_t m_boot_start;
+static probe_stamp_t m_boot_end;
+static uint32_t      m_durations[BOOT_STEP_COUNT];
+static bool          m_recorded[BOOT_STEP_COUNT];
+
+static const char* const m_step_names[BOOT_STEP_COUNT] = {
+    [BOOT_STEP_LOG_INIT]            = "log init",
+    [BOOT_STEP_TIMERS_INIT]         = "timers init",
+    [BOOT_STEP_BSP_INIT]            = "bsp init",
+    [BOOT_STEP_POWER_INIT]          = "power init",
+    [BOOT_STEP_BLE_STACK_INIT]      = "ble stack init",
+    [BOOT_STEP_GAP_PARAMS_INIT]     = "gap params init",
+    [BOOT_STEP_GATT_INIT]           = "gatt init",
+    [BOOT_STEP_SERVICES_INIT]       = "services init",
+    [BOOT_STEP_APP_SERVICES_INIT]   = "door service init",
+    [BOOT_STEP_GATT_CACHE_INIT]     = "gatt cache init",
+    [BOOT_STEP_ADVERTISING_INIT]    = "advertising init",
+    [BOOT_STEP_CONN_PARAMS_INIT]    = "conn params init",
+    [BOOT_STEP_PEER_MANAGER_INIT]   = "peer manager init",
+    [BOOT_STEP_ADVERTISING_START]   = "advertising start"
+};
+
+
+void boot_profile_start(void) {
+    m_boot_start = probe_timestamp_get();
+}
+
+
+void boot_profile_record(boot_step_t step, probe_stamp_t start) {
+    if (step >= BOOT_STEP_COUNT) {
+        return;
+    }
+
+    const probe_stamp_t now = probe_timestamp_get();
+    m_durations[step] = now - start;
+    m_recorded[step]  = true;
+
+    if (step == BOOT_STEP_ADVERTISING_START) {
+        m_boot_end = now;
+    }
+}
+
+
+uint32_t boot_profile_step_us(boot_step_t step) {
+    if (step >= BOOT_STEP_COUNT || !m_recorded[step]) {
+        return 0;
+    }
+    return probe_duration_us(m_durations[step]);
+}
+
+
+uint32_t boot_profile_total_us(void) {
+    if (!m_recorded[BOOT_STEP_ADVERTISING_START]) {
+        return 0;
+    }
+    return probe_duration_us(m_boot_end - m_boot_start);
+}
+
+
+void boot_profile_log(void) {
+    bool logged[BOOT_STEP_COUNT] = {false};
+
+    NRF_LOG_INFO("Boot to advertising: %u us", boot_profile_total_us());
+
+    // Selection sort, there are only a handful of steps
+    for (unsigned int n = 0; n < BOOT_STEP_COUNT; ++n) {
+        int slowest = -1;
+        for (unsigned int i = 0; i < BOOT_STEP_COUNT; ++i) {
+            if (m_recorded[i] && !logged[i] && (slowest < 0 || m_durations[i] > m_durations[slowest])) {
+                slowest = (int)i;
+            }
+        }
+        if (slowest < 0) {
+            break;
+        }
+
+        logged[slowest] = true;
+        NRF_LOG_INFO("  %s: %u us", m_step_names[slowest], probe_duration_us(m_durations[slowest]));
+    }
+}
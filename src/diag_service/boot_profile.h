@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "config.h"
+#include "probe.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Initialization steps timed from main() to the start of advertising, in boot order */
+typedef enum {
+    BOOT_STEP_LOG_INIT,             /**< log_init */
+    BOOT_STEP_TIMERS_INIT,          /**< timers_init, app_timer_init */
+    BOOT_STEP_BSP_INIT,             /**< buttons_leds_init */
+    BOOT_STEP_POWER_INIT,           /**< power_management_init */
+    BOOT_STEP_BLE_STACK_INIT,       /**< ble_stack_init, including the LF clock start */
+    BOOT_STEP_GAP_PARAMS_INIT,      /**< gap_params_init */
+    BOOT_STEP_GATT_INIT,            /**< gatt_init */
+    BOOT_STEP_SERVICES_INIT,        /**< services_init, Queued Write module */
+    BOOT_STEP_APP_SERVICES_INIT,    /**< Application service init functions, the Door Lock Service */
+    BOOT_STEP_GATT_CACHE_INIT,      /**< gatt_cache_init, database hash */
+    BOOT_STEP_ADVERTISING_INIT,     /**< advertising_init */
+    BOOT_STEP_CONN_PARAMS_INIT,     /**< conn_params_init */
+    BOOT_STEP_PEER_MANAGER_INIT,    /**< peer_manager_init */
+    BOOT_STEP_ADVERTISING_START,    /**< advertising_start */
+    BOOT_STEP_COUNT
+} boot_step_t;
+
+
+#if BOOT_PROFILE_ENABLED
+/**@brief Macro for running an initialization step and recording its duration. */
+#define BOOT_PROFILE_STEP(_step, _call)                             \
+    do {                                                            \
+        const probe_stamp_t _boot_start = probe_timestamp_get();    \
+        _call;                                                      \
+        boot_profile_record((_step), _boot_start);                  \
+    } while (0)
+#else
+#define BOOT_PROFILE_STEP(_step, _call) _call
+#endif
+
+
+/**@brief Function for marking the start of the boot.
+ *
+ * @details Call from main() right after probe_init(), which starts the timestamp counter. Time
+ *          spent before main(), in the SoftDevice and the C runtime startup, is not included.
+ */
+void boot_profile_start(void);
+
+
+/**@brief Function for recording the duration of an initialization step.
+ *
+ * @param[in] step   Step.
+ * @param[in] start  Timestamp taken at the start of the step.
+ */
+void boot_profile_record(boot_step_t step, probe_stamp_t start);
+
+
+/**@brief Function for getting the duration of an initialization step.
+ *
+ * @param[in] step  Step.
+ *
+ * @return Duration in microseconds, 0 if the step was not recorded.
+ */
+uint32_t boot_profile_step_us(boot_step_t step);
+
+
+/**@brief Function for getting the time from boot_profile_start to the end of advertising_start.
+ *
+ * @return Duration in microseconds, 0 if advertising has not been started yet.
+ */
+uint32_t boot_profile_total_us(void);
+
+
+/**@brief Function for writing the breakdown to the log, slowest steps first.
+ */
+void boot_profile_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,360 @@
+#include "crypto_bench.h"
+
+#include <string.h>
+
+#include "sdk_config.h"
+#include "nrf_crypto.h"
+#include "nrf_log.h"
+
+
+// Primitives with a backend enabled in sdk_config.h, and selected by CRYPTO_BENCH_PRIMITIVES
+#define BACKEND_ENABLED(_backend, _feature) \
+    (NRF_MODULE_ENABLED(NRF_CRYPTO_BACKEND_##_backend) && NRF_MODULE_ENABLED(NRF_CRYPTO_BACKEND_##_backend##_##_feature))
+
+#define BENCH_HMAC_SHA256       ((CRYPTO_BENCH_PRIMITIVES & CRYPTO_BENCH_MASK_HMAC_SHA256) &&       \
+                                 (BACKEND_ENABLED(CC310, HMAC_SHA256) ||                            \
+                                  BACKEND_ENABLED(MBEDTLS, HMAC_SHA256) ||                          \
+                                  BACKEND_ENABLED(OBERON, HMAC_SHA256)))
+
+#define BENCH_AES_CMAC          ((CRYPTO_BENCH_PRIMITIVES & CRYPTO_BENCH_MASK_AES_CMAC) &&          \
+                                 (BACKEND_ENABLED(CC310, AES_CMAC) ||                               \
+                                  BACKEND_ENABLED(MBEDTLS, AES_CMAC)))
+
+#define BENCH_CHACHA_POLY       ((CRYPTO_BENCH_PRIMITIVES & CRYPTO_BENCH_MASK_CHACHA_POLY) &&       \
+                                 (BACKEND_ENABLED(CC310, CHACHA_POLY) ||                            \
+                                  BACKEND_ENABLED(OBERON, CHACHA_POLY)))
+
+#define BENCH_ECDSA_SECP256R1   ((CRYPTO_BENCH_PRIMITIVES & CRYPTO_BENCH_MASK_ECDSA_SECP256R1) &&   \
+                                 ((BACKEND_ENABLED(CC310, ECC_SECP256R1) &&                         \
+                                   BACKEND_ENABLED(CC310, HASH_SHA256)) ||                          \
+                                  (BACKEND_ENABLED(MBEDTLS, ECC_SECP256R1) &&                       \
+                                   BACKEND_ENABLED(MBEDTLS, HASH_SHA256)) ||                        \
+                                  (BACKEND_ENABLED(OBERON, ECC_SECP256R1) &&                        \
+                                   BACKEND_ENABLED(OBERON, HASH_SHA256))))
+
+#define BENCH_EDDSA_ED25519     ((CRYPTO_BENCH_PRIMITIVES & CRYPTO_BENCH_MASK_EDDSA_ED25519) &&     \
+                                 (BACKEND_ENABLED(CC310, ECC_ED25519) ||                            \
+                                  BACKEND_ENABLED(OBERON, ECC_ED25519)))
+
+
+static crypto_bench_result_t m_results[CRYPTO_BENCH_COUNT];
+
+static const char* const m_names[CRYPTO_BENCH_COUNT] = {
+    [CRYPTO_BENCH_HMAC_SHA256]     = "HMAC-SHA256",
+    [CRYPTO_BENCH_AES_CMAC]        = "AES-128-CMAC",
+    [CRYPTO_BENCH_CHACHA_POLY]     = "ChaCha20-Poly1305",
+    [CRYPTO_BENCH_ECDSA_SECP256R1] = "ECDSA secp256r1",
+    [CRYPTO_BENCH_EDDSA_ED25519]   = "Ed25519"
+};
+
+
+#if CRYPTO_BENCH_PRIMITIVES
+// Test vectors. The token is opcode, credential ID, counter and a nonce, as an unlock
+// request would carry it.
+static uint8_t m_token[16] = {
+    0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x5a, 0x3c, 0x96, 0xe1, 0xf0, 0x0d, 0x2b, 0x47, 0x00
+};
+#endif
+
+#if BENCH_HMAC_SHA256 || BENCH_CHACHA_POLY
+static uint8_t m_key_256[32] = {
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f
+};
+#endif
+
+#if BENCH_HMAC_SHA256
+static const uint8_t m_hmac_sha256_tag[32] = {
+    0x17, 0x9b, 0xba, 0x84, 0xbc, 0xc4, 0xa7, 0x5a, 0x53, 0x1f, 0xec, 0xd1, 0xb9, 0x87, 0x28, 0xd3,
+    0xca, 0xfb, 0xf8, 0x77, 0xec, 0x2c, 0x3f, 0x41, 0x77, 0xce, 0x04, 0xe6, 0x52, 0xc5, 0x3f, 0x90
+};
+#endif
+
+#if BENCH_AES_CMAC
+static uint8_t m_key_128[16] = {
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f
+};
+
+static const uint8_t m_aes_cmac_tag[16] = {
+    0xe3, 0xc8, 0x78, 0x9b, 0x75, 0x7d, 0xee, 0x3d, 0x28, 0x87, 0xec, 0x71, 0x86, 0xb7, 0xc4, 0x4c
+};
+#endif
+
+#if BENCH_CHACHA_POLY
+static uint8_t m_chacha_poly_nonce[12] = {
+    0x00, 0x00, 0x00, 0x00, 0x4a, 0x6f, 0x75, 0x72, 0x64, 0x61, 0x6e, 0x31
+};
+
+static uint8_t m_chacha_poly_ciphertext[16] = {
+    0x56, 0x5e, 0xce, 0xad, 0x26, 0xf6, 0x32, 0x16, 0xb1, 0x41, 0x7d, 0xdb, 0x1c, 0xd2, 0x85, 0xac
+};
+
+static uint8_t m_chacha_poly_tag[16] = {
+    0x8c, 0x52, 0x10, 0x2c, 0x74, 0x77, 0xab, 0xd9, 0x92, 0x69, 0xae, 0xd3, 0x5f, 0xbd, 0x60, 0xec
+};
+#endif
+
+#if BENCH_ECDSA_SECP256R1
+static const uint8_t m_secp256r1_public_key[64] = {
+    0xba, 0x2a, 0xaf, 0x92, 0xbf, 0x6f, 0x38, 0xda, 0x4c, 0xdd, 0xe7, 0xe7, 0x4f, 0xd6, 0xd1, 0x67,
+    0x7a, 0x6a, 0x47, 0x24, 0xe5, 0xf5, 0x1f, 0x9b, 0x6f, 0x21, 0x2b, 0x45, 0x9d, 0xb8, 0x69, 0x8a,
+    0x83, 0x9c, 0xb5, 0x80, 0xf1, 0x32, 0x0a, 0xd7, 0x34, 0x03, 0xef, 0x1f, 0xcb, 0x69, 0x0e, 0xb0,
+    0xd7, 0x2d, 0x42, 0x55, 0x09, 0x61, 0x57, 0x9c, 0x2a, 0xa2, 0xcb, 0x7a, 0xd0, 0x49, 0x0f, 0x9a
+};
+
+static const uint8_t m_secp256r1_signature[64] = {
+    0x3d, 0x96, 0x09, 0x61, 0x82, 0xd3, 0x87, 0xe9, 0xa7, 0xb7, 0xe6, 0xbf, 0x2d, 0xff, 0x89, 0x8b,
+    0xbe, 0x91, 0x1f, 0x9a, 0xd9, 0x45, 0xd3, 0x1c, 0x57, 0x32, 0xd6, 0x52, 0x04, 0x66, 0x77, 0x38,
+    0x4b, 0xea, 0xd2, 0x0d, 0xa5, 0xc0, 0x9a, 0x1a, 0x0f, 0x79, 0x4e, 0x5a, 0xf1, 0x00, 0xeb, 0x02,
+    0x9b, 0x15, 0x66, 0x42, 0x9f, 0x50, 0xd5, 0x81, 0xfb, 0x3e, 0xe9, 0xf4, 0x0c, 0x72, 0x28, 0x6d
+};
+#endif
+
+#if BENCH_EDDSA_ED25519
+static const uint8_t m_ed25519_public_key[32] = {
+    0x62, 0x24, 0xf2, 0xcc, 0x2e, 0xf4, 0xd0, 0x6d, 0xda, 0x3f, 0x91, 0xb4, 0x1a, 0xce, 0x0b, 0xe8,
+    0x06, 0x48, 0xbe, 0x5f, 0xeb, 0x44, 0x22, 0x1d, 0x11, 0xa8, 0xb8, 0x8e, 0x7d, 0x4b, 0x65, 0x43
+};
+
+static const uint8_t m_ed25519_signature[64] = {
+    0x22, 0x01, 0xcd, 0x00, 0xdb, 0xba, 0xac, 0xc1, 0xaf, 0xf1, 0xf3, 0x3f, 0xf3, 0xb3, 0x8b, 0xff,
+    0x61, 0x44, 0x69, 0xc8, 0xf5, 0x52, 0xd1, 0xa3, 0xc4, 0x9c, 0x84, 0xa1, 0x01, 0x31, 0x50, 0x5f,
+    0x65, 0x61, 0xf6, 0xd5, 0xa2, 0xb9, 0xe3, 0x68, 0x54, 0x67, 0x71, 0x57, 0x0a, 0xd4, 0xa9, 0x40,
+    0x61, 0xde, 0xef, 0x7c, 0x30, 0x2c, 0x0f, 0x8d, 0x96, 0x4f, 0x2d, 0xb5, 0x6c, 0x06, 0x88, 0x00
+};
+#endif
+
+
+#if CRYPTO_BENCH_PRIMITIVES
+/**@brief Function for recording one verification.
+ *
+ * @return true to keep going, false if the verification failed.
+ */
+static bool result_record(crypto_bench_result_t* p_result, probe_stamp_t start, ret_code_t err_code) {
+    const uint32_t duration = probe_timestamp_get() - start;
+
+    if (err_code != NRF_SUCCESS) {
+        p_result->status = err_code;
+        return false;
+    }
+
+    p_result->runs  += 1;
+    p_result->total += duration;
+    if (duration < p_result->min) {
+        p_result->min = duration;
+    }
+    if (duration > p_result->max) {
+        p_result->max = duration;
+    }
+    return true;
+}
+#endif
+
+
+#if BENCH_HMAC_SHA256
+static void hmac_sha256_bench(uint32_t iterations, crypto_bench_result_t* p_result) {
+    static nrf_crypto_hmac_context_t context;
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+        uint8_t tag[sizeof(m_hmac_sha256_tag)];
+        size_t  tag_size = sizeof(tag);
+
+        const probe_stamp_t start = probe_timestamp_get();
+        ret_code_t err_code = nrf_crypto_hmac_calculate(&context, &g_nrf_crypto_hmac_sha256_info,
+                                                        tag, &tag_size,
+                                                        m_key_256, sizeof(m_key_256),
+                                                        m_token, sizeof(m_token));
+        if (err_code == NRF_SUCCESS && memcmp(tag, m_hmac_sha256_tag, sizeof(tag)) != 0) {
+            err_code = NRF_ERROR_INVALID_DATA;
+        }
+        if (!result_record(p_result, start, err_code)) {
+            return;
+        }
+    }
+}
+#endif
+
+
+#if BENCH_AES_CMAC
+static void aes_cmac_bench(uint32_t iterations, crypto_bench_result_t* p_result) {
+    static nrf_crypto_aes_context_t context;
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+        uint8_t tag[sizeof(m_aes_cmac_tag)];
+        size_t  tag_size = sizeof(tag);
+
+        const probe_stamp_t start = probe_timestamp_get();
+        ret_code_t err_code = nrf_crypto_aes_crypt(&context, &g_nrf_crypto_aes_cmac_128_info,
+                                                   NRF_CRYPTO_MAC_CALCULATE, m_key_128, NULL,
+                                                   m_token, sizeof(m_token), tag, &tag_size);
+        if (err_code == NRF_SUCCESS && memcmp(tag, m_aes_cmac_tag, sizeof(tag)) != 0) {
+            err_code = NRF_ERROR_INVALID_DATA;
+        }
+        if (!result_record(p_result, start, err_code)) {
+            return;
+        }
+    }
+}
+#endif
+
+
+#if BENCH_CHACHA_POLY
+static void chacha_poly_bench(uint32_t iterations, crypto_bench_result_t* p_result) {
+    static nrf_crypto_aead_context_t context;
+
+    // The key is provisioned once, like a stored credential
+    ret_code_t err_code = nrf_crypto_aead_init(&context, &g_nrf_crypto_chacha_poly_256_info, m_key_256);
+    if (err_code != NRF_SUCCESS) {
+        p_result->status = err_code;
+        return;
+    }
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+        uint8_t plaintext[sizeof(m_chacha_poly_ciphertext)];
+
+        const probe_stamp_t start = probe_timestamp_get();
+        err_code = nrf_crypto_aead_crypt(&context, NRF_CRYPTO_DECRYPT,
+                                         m_chacha_poly_nonce, sizeof(m_chacha_poly_nonce),
+                                         NULL, 0,
+                                         m_chacha_poly_ciphertext, sizeof(m_chacha_poly_ciphertext),
+                                         plaintext,
+                                         m_chacha_poly_tag, sizeof(m_chacha_poly_tag));
+        if (err_code == NRF_SUCCESS && memcmp(plaintext, m_token, sizeof(plaintext)) != 0) {
+            err_code = NRF_ERROR_INVALID_DATA;
+        }
+        if (!result_record(p_result, start, err_code)) {
+            break;
+        }
+    }
+
+    (void)nrf_crypto_aead_uninit(&context);
+}
+#endif
+
+
+#if BENCH_ECDSA_SECP256R1
+static void ecdsa_secp256r1_bench(uint32_t iterations, crypto_bench_result_t* p_result) {
+    static nrf_crypto_ecc_public_key_t public_key;
+    static nrf_crypto_hash_context_t   hash_context;
+
+    ret_code_t err_code = nrf_crypto_ecc_public_key_from_raw(&g_nrf_crypto_ecc_secp256r1_curve_info,
+                                                             &public_key,
+                                                             m_secp256r1_public_key,
+                                                             sizeof(m_secp256r1_public_key));
+    if (err_code != NRF_SUCCESS) {
+        p_result->status = err_code;
+        return;
+    }
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+        nrf_crypto_hash_sha256_digest_t digest;
+        size_t                          digest_size = sizeof(digest);
+
+        const probe_stamp_t start = probe_timestamp_get();
+        err_code = nrf_crypto_hash_calculate(&hash_context, &g_nrf_crypto_hash_sha256_info,
+                                             m_token, sizeof(m_token), digest, &digest_size);
+        if (err_code == NRF_SUCCESS) {
+            err_code = nrf_crypto_ecdsa_verify(NULL, &public_key, digest, digest_size,
+                                               m_secp256r1_signature, sizeof(m_secp256r1_signature));
+        }
+        if (!result_record(p_result, start, err_code)) {
+            break;
+        }
+    }
+
+    (void)nrf_crypto_ecc_public_key_free(&public_key);
+}
+#endif
+
+
+#if BENCH_EDDSA_ED25519
+static void eddsa_ed25519_bench(uint32_t iterations, crypto_bench_result_t* p_result) {
+    static nrf_crypto_ecc_public_key_t public_key;
+
+    ret_code_t err_code = nrf_crypto_ecc_public_key_from_raw(&g_nrf_crypto_ecc_ed25519_curve_info,
+                                                             &public_key,
+                                                             m_ed25519_public_key,
+                                                             sizeof(m_ed25519_public_key));
+    if (err_code != NRF_SUCCESS) {
+        p_result->status = err_code;
+        return;
+    }
+
+    for (uint32_t i = 0; i < iterations; ++i) {
+        const probe_stamp_t start = probe_timestamp_get();
+        err_code = nrf_crypto_eddsa_verify(NULL, &public_key, m_token, sizeof(m_token),
+                                           m_ed25519_signature, sizeof(m_ed25519_signature));
+        if (!result_record(p_result, start, err_code)) {
+            break;
+        }
+    }
+
+    (void)nrf_crypto_ecc_public_key_free(&public_key);
+}
+#endif
+
+
+ret_code_t crypto_bench_run(uint32_t iterations) {
+    for (unsigned int i = 0; i < CRYPTO_BENCH_COUNT; ++i) {
+        memset(&m_results[i], 0, sizeof(m_results[i]));
+        m_results[i].status = NRF_ERROR_NOT_SUPPORTED;
+        m_results[i].min    = UINT32_MAX;
+    }
+
+    const ret_code_t err_code = nrf_crypto_init();
+    if (err_code != NRF_SUCCESS) {
+        return err_code;
+    }
+
+#if BENCH_HMAC_SHA256
+    m_results[CRYPTO_BENCH_HMAC_SHA256].status = NRF_SUCCESS;
+    hmac_sha256_bench(iterations, &m_results[CRYPTO_BENCH_HMAC_SHA256]);
+#endif
+#if BENCH_AES_CMAC
+    m_results[CRYPTO_BENCH_AES_CMAC].status = NRF_SUCCESS;
+    aes_cmac_bench(iterations, &m_results[CRYPTO_BENCH_AES_CMAC]);
+#endif
+#if BENCH_CHACHA_POLY
+    m_results[CRYPTO_BENCH_CHACHA_POLY].status = NRF_SUCCESS;
+    chacha_poly_bench(iterations, &m_results[CRYPTO_BENCH_CHACHA_POLY]);
+#endif
+#if BENCH_ECDSA_SECP256R1
+    m_results[CRYPTO_BENCH_ECDSA_SECP256R1].status = NRF_SUCCESS;
+    ecdsa_secp256r1_bench(iterations, &m_results[CRYPTO_BENCH_ECDSA_SECP256R1]);
+#endif
+#if BENCH_EDDSA_ED25519
+    m_results[CRYPTO_BENCH_EDDSA_ED25519].status = NRF_SUCCESS;
+    eddsa_ed25519_bench(iterations, &m_results[CRYPTO_BENCH_EDDSA_ED25519]);
+#endif
+
+    return NRF_SUCCESS;
+}
+
+
+const crypto_bench_result_t* crypto_bench_result_get(crypto_bench_id_t id) {
+    return (id < CRYPTO_BENCH_COUNT) ? &m_results[id] : NULL;
+}
+
+
+const char* crypto_bench_name_get(crypto_bench_id_t id) {
+    return (id < CRYPTO_BENCH_COUNT) ? m_names[id] : "";
+}
+
+
+void crypto_bench_log(void) {
+    for (unsigned int i = 0; i < CRYPTO_BENCH_COUNT; ++i) {
+        const crypto_bench_result_t* p_result = &m_results[i];
+
+        if (p_result->status != NRF_SUCCESS) {
+            NRF_LOG_INFO("%s: error 0x%x", m_names[i], p_result->status);
+        }
+        else if (p_result->runs > 0) {
+            NRF_LOG_INFO("%s: n=%u mean=%u min=%u max=%u us",
+                         m_names[i],
+                         p_result->runs,
+                         probe_duration_us(p_result->total / p_result->runs),
+                         probe_duration_us(p_result->min),
+                         probe_duration_us(p_result->max));
+        }
+    }
+}
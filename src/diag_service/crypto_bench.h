@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "sdk_errors.h"
+#include "probe.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define CRYPTO_BENCH_MASK_HMAC_SHA256       0x01    /**< CRYPTO_BENCH_PRIMITIVES bit of CRYPTO_BENCH_HMAC_SHA256. */
+#define CRYPTO_BENCH_MASK_AES_CMAC          0x02    /**< CRYPTO_BENCH_PRIMITIVES bit of CRYPTO_BENCH_AES_CMAC. */
+#define CRYPTO_BENCH_MASK_CHACHA_POLY       0x04    /**< CRYPTO_BENCH_PRIMITIVES bit of CRYPTO_BENCH_CHACHA_POLY. */
+#define CRYPTO_BENCH_MASK_ECDSA_SECP256R1   0x08    /**< CRYPTO_BENCH_PRIMITIVES bit of CRYPTO_BENCH_ECDSA_SECP256R1. */
+#define CRYPTO_BENCH_MASK_EDDSA_ED25519     0x10    /**< CRYPTO_BENCH_PRIMITIVES bit of CRYPTO_BENCH_EDDSA_ED25519. */
+
+#ifndef CRYPTO_BENCH_PRIMITIVES
+/**@brief Primitives compiled into the benchmark. Building with a single bit set and comparing
+ *        the image size against a build with 0 gives the code size of that primitive. */
+#define CRYPTO_BENCH_PRIMITIVES             0x1F
+#endif
+
+
+/**@brief Candidate unlock token verification primitives, each verifying a 16 byte token */
+typedef enum {
+    CRYPTO_BENCH_HMAC_SHA256,       /**< HMAC-SHA256 over the token, compared with the expected tag */
+    CRYPTO_BENCH_AES_CMAC,          /**< AES-128-CMAC over the token, compared with the expected tag */
+    CRYPTO_BENCH_CHACHA_POLY,       /**< ChaCha20-Poly1305 decryption of the token, tag checked */
+    CRYPTO_BENCH_ECDSA_SECP256R1,   /**< SHA-256 of the token, then ECDSA secp256r1 signature verification */
+    CRYPTO_BENCH_EDDSA_ED25519,     /**< Ed25519 signature verification of the token */
+    CRYPTO_BENCH_COUNT
+} crypto_bench_id_t;
+
+/**@brief Result of one primitive */
+typedef struct {
+    ret_code_t status;  /**< NRF_SUCCESS, NRF_ERROR_NOT_SUPPORTED if not compiled in or without a backend, otherwise the first error */
+    uint32_t   runs;    /**< Timed verifications */
+    uint32_t   min;     /**< Fastest verification, in PROBE_UNIT */
+    uint32_t   max;     /**< Slowest verification, in PROBE_UNIT */
+    uint64_t   total;   /**< Sum of all verifications, in PROBE_UNIT */
+} crypto_bench_result_t;
+
+
+/**@brief Function for running the benchmark.
+ *
+ * @details Initializes nrf_crypto, then verifies a fixed test vector @p iterations times with
+ *          every primitive that has a backend enabled in sdk_config.h. Key parsing and context
+ *          setup that a lock would do once at boot are not timed. Blocks until done.
+ *
+ * @param[in] iterations  Timed verifications per primitive.
+ *
+ * @return NRF_SUCCESS, or the error of nrf_crypto_init.
+ */
+ret_code_t crypto_bench_run(uint32_t iterations);
+
+
+/**@brief Function for getting the result of a primitive.
+ *
+ * @param[in] id  Primitive.
+ *
+ * @return Result, or NULL if @p id is invalid.
+ */
+const crypto_bench_result_t* crypto_bench_result_get(crypto_bench_id_t id);
+
+
+/**@brief Function for getting the name of a primitive.
+ *
+ * @param[in] id  Primitive.
+ */
+const char* crypto_bench_name_get(crypto_bench_id_t id);
+
+
+/**@brief Function for writing the results to the log, in microseconds.
+ */
+void crypto_bench_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,119 @@
+#include "evt_trace.h"
+
+#include <stddef.h>
+#include <string.h>
+#include "app_util.h"
+#include "app_timer.h"
+#include "SEGGER_RTT.h"
+
+
+const uint16_t* evt_trace_params_locate(const ble_evt_t* p_ble_evt, const uint8_t** pp_params, uint16_t* p_max_len) {
+    const uint16_t evt_id = p_ble_evt->header.evt_id;
+
+    if (evt_id >= BLE_GAP_EVT_BASE && evt_id <= BLE_GAP_EVT_LAST) {
+        *pp_params = (const uint8_t*)&p_ble_evt->evt.gap_evt.params;
+        *p_max_len = sizeof(p_ble_evt->evt.gap_evt.params);
+        return &p_ble_evt->evt.gap_evt.conn_handle;
+    }
+    if (evt_id >= BLE_GATTS_EVT_BASE && evt_id <= BLE_GATTS_EVT_LAST) {
+        *pp_params = (const uint8_t*)&p_ble_evt->evt.gatts_evt.params;
+        *p_max_len = sizeof(p_ble_evt->evt.gatts_evt.params);
+        return &p_ble_evt->evt.gatts_evt.conn_handle;
+    }
+    if (evt_id >= BLE_GATTC_EVT_BASE && evt_id <= BLE_GATTC_EVT_LAST) {
+        *pp_params = (const uint8_t*)&p_ble_evt->evt.gattc_evt.params;
+        *p_max_len = sizeof(p_ble_evt->evt.gattc_evt.params);
+        return &p_ble_evt->evt.gattc_evt.conn_handle;
+    }
+    if (evt_id >= BLE_L2CAP_EVT_BASE && evt_id <= BLE_L2CAP_EVT_LAST) {
+        *pp_params = (const uint8_t*)&p_ble_evt->evt.l2cap_evt.params;
+        *p_max_len = sizeof(p_ble_evt->evt.l2cap_evt.params);
+        return &p_ble_evt->evt.l2cap_evt.conn_handle;
+    }
+    if (evt_id >= BLE_EVT_BASE && evt_id <= BLE_EVT_LAST) {
+        *pp_params = (const uint8_t*)&p_ble_evt->evt.common_evt.params;
+        *p_max_len = sizeof(p_ble_evt->evt.common_evt.params);
+        return &p_ble_evt->evt.common_evt.conn_handle;
+    }
+    return NULL;
+}
+
+
+#if EVT_TRACE_ENABLED
+
+static uint8_t  m_rtt_buffer[EVT_TRACE_BUFFER_SIZE];
+static uint16_t m_dropped;
+
+
+/**@brief Function for writing one record, whole or not at all.
+ */
+static bool record_write(uint16_t evt_id, uint16_t conn_handle, const uint8_t* p_params, uint16_t params_len) {
+    uint8_t  record[EVT_TRACE_RECORD_HDR_LEN + EVT_TRACE_PARAMS_MAX_LEN];
+    uint16_t len = 0;
+
+    if (params_len > EVT_TRACE_PARAMS_MAX_LEN) {
+        params_len = EVT_TRACE_PARAMS_MAX_LEN;
+    }
+
+    len += uint32_encode(app_timer_cnt_get(), &record[len]);
+    len += uint16_encode(evt_id, &record[len]);
+    len += uint16_encode(conn_handle, &record[len]);
+    len += uint16_encode(params_len, &record[len]);
+    if (params_len > 0) {
+        memcpy(&record[len], p_params, params_len);
+        len += params_len;
+    }
+
+    return SEGGER_RTT_Write(EVT_TRACE_RTT_CHANNEL, record, len) == len;
+}
+
+
+void evt_trace_init(void) {
+    uint8_t params[EVT_TRACE_BOOT_PARAMS_LEN];
+    uint8_t len = 0;
+
+    // Samples are dropped rather than stalling the BLE event handlers when the host is slow
+    SEGGER_RTT_ConfigUpBuffer(EVT_TRACE_RTT_CHANNEL, "BleTrace", m_rtt_buffer, sizeof(m_rtt_buffer),
+                              SEGGER_RTT_MODE_NO_BLOCK_SKIP);
+
+    len += uint32_encode(EVT_TRACE_MAGIC, &params[len]);
+    params[len++] = EVT_TRACE_VERSION;
+    params[len++] = NRF_SD_BLE_API_VERSION;
+    // Rate of app_timer_cnt_get, which runs after the RTC prescaler
+    len += uint16_encode(APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1), &params[len]);
+
+    m_dropped = 0;
+    (void)record_write(EVT_TRACE_ID_BOOT, BLE_CONN_HANDLE_INVALID, params, len);
+}
+
+
+void evt_trace_record(const ble_evt_t* p_ble_evt) {
+    const uint8_t*  p_params;
+    uint16_t        max_len;
+    const uint16_t* p_conn_handle = evt_trace_params_locate(p_ble_evt, &p_params, &max_len);
+
+    // Every advertiser around is reported while scanning, the buffer would hold nothing else
+    if (p_conn_handle == NULL || p_ble_evt->header.evt_id == BLE_GAP_EVT_ADV_REPORT) {
+        return;
+    }
+
+    // The SoftDevice reports the event length including the header
+    const uint16_t offset     = (uint16_t)(p_params - (const uint8_t*)p_ble_evt);
+    uint16_t       params_len = (p_ble_evt->header.evt_len > offset) ? p_ble_evt->header.evt_len - offset : 0;
+    if (params_len > max_len) {
+        params_len = max_len;
+    }
+
+    // Tell the reader about a gap before the next record that fits
+    if (m_dropped != 0) {
+        if (record_write(EVT_TRACE_ID_DROPPED, m_dropped, NULL, 0)) {
+            m_dropped = 0;
+        }
+    }
+
+    if (m_dropped != 0 || !record_write(p_ble_evt->header.evt_id, *p_conn_handle, p_params, params_len)) {
+        m_dropped += (m_dropped < UINT16_MAX) ? 1 : 0;
+    }
+}
+
+#endif // EVT_TRACE_ENABLED
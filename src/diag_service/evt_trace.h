@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "sdk_config.h"
+#include "ble.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@file
+ *
+ * @brief Binary BLE event trace.
+ *
+ * @details Every BLE event reaching the application is written to RTT up channel
+ *          EVT_TRACE_RTT_CHANNEL as one record, all fields little endian:
+ *
+ *          | Size | Field                                                    |
+ *          |------|----------------------------------------------------------|
+ *          | 4    | Application timer ticks (24-bit RTC counter)             |
+ *          | 2    | Event ID                                                 |
+ *          | 2    | Connection handle                                        |
+ *          | 2    | Parameter length                                         |
+ *          | n    | Event parameters, the params union of the module event   |
+ *
+ *          The parameters are stored without the module header, whose layout depends on the
+ *          pointer size, so a trace captured on the target can be replayed by the host build
+ *          (see project/host). A record with event ID EVT_TRACE_ID_BOOT starts every trace,
+ *          one with EVT_TRACE_ID_DROPPED precedes the first record written after records
+ *          were lost to a full RTT buffer.
+ */
+
+#define EVT_TRACE_RTT_CHANNEL     1         /**< RTT up channel, channel 0 is used by the log. */
+#define EVT_TRACE_RECORD_HDR_LEN  10        /**< Length of the record fields before the parameters. */
+#define EVT_TRACE_PARAMS_MAX_LEN  (BLE_EVT_LEN_MAX(NRF_SDH_BLE_GATT_MAX_MTU_SIZE) - offsetof(ble_evt_t, evt))
+
+#define EVT_TRACE_ID_BOOT         0x0000    /**< Boot record, parameters are EVT_TRACE_MAGIC, version, SoftDevice API version and the timestamp rate in Hz. */
+#define EVT_TRACE_ID_DROPPED      0xFFFF    /**< Records lost, the connection handle field holds the count. */
+
+#define EVT_TRACE_MAGIC           0x54454C42    /**< "BLET" */
+#define EVT_TRACE_VERSION         1
+#define EVT_TRACE_BOOT_PARAMS_LEN 8
+
+
+#if EVT_TRACE_ENABLED
+
+/**@brief Function for setting up the RTT channel and writing the boot record.
+ */
+void evt_trace_init(void);
+
+
+/**@brief Function for recording a BLE event.
+ *
+ * @param[in] p_ble_evt  Event received from the BLE stack.
+ */
+void evt_trace_record(const ble_evt_t* p_ble_evt);
+
+#else
+
+#define evt_trace_init()
+#define evt_trace_record(_p_ble_evt)
+
+#endif // EVT_TRACE_ENABLED
+
+
+/**@brief Function for locating the parameters of a BLE event.
+ *
+ * @details All BLE module events are a connection handle followed by a params union.
+ *
+ * @param[in]  p_ble_evt      Event.
+ * @param[out] pp_params      Start of the params union.
+ * @param[out] p_max_len      Size of the params union.
+ *
+ * @return Pointer to the connection handle, or NULL for an unknown event module.
+ */
+const uint16_t* evt_trace_params_locate(const ble_evt_t* p_ble_evt, const uint8_t** pp_params, uint16_t* p_max_len);
+
+
+#ifdef __cplusplus
+}
+#endif
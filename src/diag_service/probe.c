@@ -0,0 +1,94 @@
+#include "probe.h"
+
+#include <string.h>
+#include "nrf_log.h"
+
+
+static probe_histogram_t m_histograms[PROBE_COUNT];   /**< Probe histograms, no allocation */
+
+static const char* const m_probe_names[PROBE_COUNT] = {
+    [PROBE_DLS_ON_BLE_EVT]     = "dls_on_ble_evt",
+    [PROBE_DLS_ON_WRITE]       = "dls_on_write",
+    [PROBE_DLS_LOCK_STATE_SET] = "dls_lock_state_set",
+    [PROBE_DLS_LOCK_STATE_GET] = "dls_lock_state_get",
+    [PROBE_ON_DOOR_EVT]        = "on_door_evt",
+};
+
+
+/**@brief Function for getting the log2 bucket of a duration.
+ */
+static unsigned int bucket_get(uint32_t duration) {
+    unsigned int bucket = 0;
+    while (duration != 0) {
+        duration >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+
+void probe_init(void) {
+#ifndef HOST_SIM
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    memset(m_histograms, 0, sizeof(m_histograms));
+    for (unsigned int i = 0; i < PROBE_COUNT; ++i) {
+        m_histograms[i].min = UINT32_MAX;
+    }
+}
+
+
+void probe_record(probe_id_t id, probe_stamp_t start) {
+    const uint32_t duration = probe_timestamp_get() - start;
+
+    if (id >= PROBE_COUNT) {
+        return;
+    }
+
+    probe_histogram_t* p_hist = &m_histograms[id];
+    p_hist->count += 1;
+    p_hist->total += duration;
+    if (duration < p_hist->min) {
+        p_hist->min = duration;
+    }
+    if (duration > p_hist->max) {
+        p_hist->max = duration;
+    }
+    p_hist->buckets[bucket_get(duration)] += 1;
+}
+
+
+const probe_histogram_t* probe_histogram_get(probe_id_t id) {
+    return (id < PROBE_COUNT) ? &m_histograms[id] : NULL;
+}
+
+
+const char* probe_name_get(probe_id_t id) {
+    return (id < PROBE_COUNT) ? m_probe_names[id] : "";
+}
+
+
+void probe_log_dump(void) {
+    for (unsigned int i = 0; i < PROBE_COUNT; ++i) {
+        const probe_histogram_t* p_hist = &m_histograms[i];
+        if (p_hist->count == 0) {
+            continue;
+        }
+
+        NRF_LOG_INFO("Probe %s: n=%u min=%u mean=%u max=%u " PROBE_UNIT,
+                     m_probe_names[i],
+                     p_hist->count,
+                     p_hist->min,
+                     (uint32_t)(p_hist->total / p_hist->count),
+                     p_hist->max);
+
+        for (unsigned int b = 0; b < PROBE_HISTOGRAM_BUCKETS; ++b) {
+            if (p_hist->buckets[b] != 0) {
+                NRF_LOG_DEBUG("  < 2^%u: %u", b, p_hist->buckets[b]);
+            }
+        }
+    }
+}
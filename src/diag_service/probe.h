@@ -0,0 +1,125 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+#ifdef HOST_SIM
+#include <time.h>
+#else
+#include "nrf.h"
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define PROBE_HISTOGRAM_BUCKETS 33      /**< One bucket for 0, then one per power of two of a 32-bit duration. */
+
+#ifdef HOST_SIM
+#define PROBE_UNIT              "ns"    /**< Unit of probe durations, host monotonic clock. */
+#else
+#define PROBE_UNIT              "cyc"   /**< Unit of probe durations, CPU cycles from DWT->CYCCNT. */
+#endif
+
+
+/**@brief Instrumented code sections */
+typedef enum {
+    PROBE_DLS_ON_BLE_EVT,       /**< ble_dls_on_ble_evt */
+    PROBE_DLS_ON_WRITE,         /**< Door Lock Service write handling */
+    PROBE_DLS_LOCK_STATE_SET,   /**< ble_dls_lock_state_set */
+    PROBE_DLS_LOCK_STATE_GET,   /**< ble_dls_lock_state_get */
+    PROBE_ON_DOOR_EVT,          /**< Application Door Lock Service event handler */
+    PROBE_COUNT
+} probe_id_t;
+
+/**@brief Probe timestamp, in PROBE_UNIT */
+typedef uint32_t probe_stamp_t;
+
+/**@brief Duration histogram of one probe. Bucket n counts durations d with 2^(n-1) <= d < 2^n. */
+typedef struct {
+    uint32_t count;                             /**< Number of recorded durations */
+    uint32_t min;                               /**< Shortest duration */
+    uint32_t max;                               /**< Longest duration */
+    uint64_t total;                             /**< Sum of all durations */
+    uint32_t buckets[PROBE_HISTOGRAM_BUCKETS];  /**< log2 histogram */
+} probe_histogram_t;
+
+
+#if PROBE_ENABLED
+/**@brief Macro for marking the start of a probed section. Declares the start timestamp @p _name. */
+#define PROBE_BEGIN(_name)      const probe_stamp_t _name = probe_timestamp_get()
+/**@brief Macro for marking the end of a probed section started with PROBE_BEGIN(_name). */
+#define PROBE_END(_id, _name)   probe_record((_id), (_name))
+#else
+#define PROBE_BEGIN(_name)
+#define PROBE_END(_id, _name)
+#endif
+
+
+/**@brief Function for reading the probe timestamp counter.
+ */
+static inline probe_stamp_t probe_timestamp_get(void) {
+#ifdef HOST_SIM
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (probe_stamp_t)((uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec);
+#else
+    return DWT->CYCCNT;
+#endif
+}
+
+
+/**@brief Function for converting a duration in PROBE_UNIT to microseconds.
+ */
+static inline uint32_t probe_duration_us(uint64_t duration) {
+#ifdef HOST_SIM
+    return (uint32_t)(duration / 1000);
+#else
+    return (uint32_t)(duration / (SystemCoreClock / 1000000));
+#endif
+}
+
+
+/**@brief Function for initializing the probes.
+ *
+ * @details Enables the DWT cycle counter on target and clears all histograms.
+ */
+void probe_init(void);
+
+
+/**@brief Function for recording the duration of a probed section.
+ *
+ * @param[in] id     Probe.
+ * @param[in] start  Timestamp taken at the start of the section.
+ */
+void probe_record(probe_id_t id, probe_stamp_t start);
+
+
+/**@brief Function for getting the histogram of a probe.
+ *
+ * @param[in] id  Probe.
+ *
+ * @return Histogram, or NULL if @p id is invalid.
+ */
+const probe_histogram_t* probe_histogram_get(probe_id_t id);
+
+
+/**@brief Function for getting the name of a probe.
+ *
+ * @param[in] id  Probe.
+ */
+const char* probe_name_get(probe_id_t id);
+
+
+/**@brief Function for writing all non-empty histograms to the log.
+ */
+void probe_log_dump(void);
+
+
+#ifdef __cplusplus
+}
+#endif
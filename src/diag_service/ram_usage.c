@@ -0,0 +1,91 @@
+#include "ram_usage.h"
+
+#include "sdk_config.h"
+#include "app_util.h"
+#include "nrf_log.h"
+
+#ifndef HOST_SIM
+#include "nrf.h"
+
+// Main stack bounds, from flash_placement.xml
+extern uint32_t __StackLimit;
+extern uint32_t __StackTop;
+#endif
+
+
+static uint32_t m_static[RAM_USAGE_STATIC_COUNT] = {
+#if NRF_LOG_ENABLED
+    [RAM_USAGE_LOG_BUFFER] = NRF_LOG_BUFSIZE
+#endif
+};
+
+static const char* const m_static_names[RAM_USAGE_STATIC_COUNT] = {
+    [RAM_USAGE_DOOR]        = "m_door",
+    [RAM_USAGE_ADVERTISING] = "m_advertising",
+    [RAM_USAGE_QWR]         = "m_qwr",
+    [RAM_USAGE_GATT]        = "m_gatt",
+    [RAM_USAGE_LOG_BUFFER]  = "log buffer"
+};
+
+
+void ram_usage_stack_paint(void) {
+#ifndef HOST_SIM
+    volatile uint32_t* p_word = &__StackLimit;
+    const uint32_t*    p_end  = (const uint32_t*)(__get_MSP() - RAM_USAGE_PAINT_MARGIN);
+
+    while (p_word < p_end) {
+        *p_word++ = RAM_USAGE_PAINT_PATTERN;
+    }
+#endif
+}
+
+
+uint32_t ram_usage_stack_size(void) {
+#ifndef HOST_SIM
+    return (uint32_t)((uint8_t*)&__StackTop - (uint8_t*)&__StackLimit);
+#else
+    return 0;
+#endif
+}
+
+
+uint32_t ram_usage_stack_peak(void) {
+#ifndef HOST_SIM
+    const volatile uint32_t* p_word = &__StackLimit;
+
+    while (p_word < &__StackTop && *p_word == RAM_USAGE_PAINT_PATTERN) {
+        ++p_word;
+    }
+    return (uint32_t)((uint8_t*)&__StackTop - (uint8_t*)p_word);
+#else
+    return 0;
+#endif
+}
+
+
+void ram_usage_static_set(ram_usage_static_t id, uint32_t size) {
+    if (id < RAM_USAGE_STATIC_COUNT) {
+        m_static[id] = size;
+    }
+}
+
+
+uint8_t ram_usage_encode(uint8_t* p_buf) {
+    uint8_t len = 0;
+
+    len += uint16_encode((uint16_t)ram_usage_stack_size(), &p_buf[len]);
+    len += uint16_encode((uint16_t)ram_usage_stack_peak(), &p_buf[len]);
+    for (uint32_t i = 0; i < RAM_USAGE_STATIC_COUNT; ++i) {
+        len += uint16_encode((uint16_t)m_static[i], &p_buf[len]);
+    }
+
+    return len;
+}
+
+
+void ram_usage_log(void) {
+    NRF_LOG_INFO("Stack: peak %u of %u bytes", ram_usage_stack_peak(), ram_usage_stack_size());
+    for (uint32_t i = 0; i < RAM_USAGE_STATIC_COUNT; ++i) {
+        NRF_LOG_INFO("%s: %u bytes", m_static_names[i], m_static[i]);
+    }
+}
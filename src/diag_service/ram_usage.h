@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define RAM_USAGE_PAINT_PATTERN 0xA5A5A5A5  /**< Value of unused stack words. */
+#define RAM_USAGE_PAINT_MARGIN  64          /**< Bytes below the stack pointer left alone while painting. */
+#define RAM_USAGE_RECORD_LEN    14          /**< Length of an encoded report. */
+
+
+/**@brief Statically allocated objects tracked in the report, in report order */
+typedef enum {
+    RAM_USAGE_DOOR,         /**< Door Lock Service instance, m_door */
+    RAM_USAGE_ADVERTISING,  /**< Advertising module instance, m_advertising */
+    RAM_USAGE_QWR,          /**< Queued Write module instance and its buffer, m_qwr and m_qwr_mem */
+    RAM_USAGE_GATT,         /**< GATT module instance, m_gatt */
+    RAM_USAGE_LOG_BUFFER,   /**< Log buffer, NRF_LOG_BUFSIZE */
+    RAM_USAGE_STATIC_COUNT
+} ram_usage_static_t;
+
+
+/**@brief Function for filling the unused part of the main stack with RAM_USAGE_PAINT_PATTERN.
+ *
+ * @details Call first thing in main, while the stack is shallow.
+ */
+void ram_usage_stack_paint(void);
+
+
+/**@brief Function for getting the size of the main stack.
+ *
+ * @return Size in bytes, 0 in the host build.
+ */
+uint32_t ram_usage_stack_size(void);
+
+
+/**@brief Function for measuring the main stack high-water mark.
+ *
+ * @details The stack is scanned from its limit up to the first overwritten word.
+ *
+ * @return Deepest stack usage since ram_usage_stack_paint, in bytes. 0 in the host build.
+ */
+uint32_t ram_usage_stack_peak(void);
+
+
+/**@brief Function for recording the size of a statically allocated object.
+ *
+ * @param[in] id    Object.
+ * @param[in] size  Size in bytes.
+ */
+void ram_usage_static_set(ram_usage_static_t id, uint32_t size);
+
+
+/**@brief Function for encoding the report, little endian.
+ *
+ * @details Stack size and peak, then every ram_usage_static_t size, 16 bits each.
+ *
+ * @param[out] p_buf  Buffer of at least RAM_USAGE_RECORD_LEN bytes.
+ *
+ * @return Encoded length.
+ */
+uint8_t ram_usage_encode(uint8_t* p_buf);
+
+
+/**@brief Function for writing the report to the log.
+ */
+void ram_usage_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,128 @@
+#include "unlock_latency.h"
+
+#include <string.h>
+#include "app_util.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+
+
+#define TICK_FREQ   (APP_TIMER_CLOCK_FREQ / (APP_TIMER_CONFIG_RTC_FREQUENCY + 1))    /**< Application timer ticks per second, after the RTC prescaler */
+
+
+// Current transaction
+static struct {
+    bool     active;
+    bool     write_pending;
+    uint8_t  flags;
+    uint32_t connected_at;
+    uint32_t secured_at;
+    uint32_t write_at;
+} m_current;
+
+// Ring of recent transactions
+static unlock_latency_record_t m_ring[UNLOCK_LATENCY_RING_SIZE];
+static uint8_t                 m_ring_next;
+static uint8_t                 m_ring_count;
+static uint16_t                m_seq;
+
+
+/**@brief Function for converting an application timer tick interval to microseconds.
+ */
+static uint32_t ticks_to_us(uint32_t from, uint32_t to) {
+    const uint64_t ticks = app_timer_cnt_diff_compute(to, from);
+    return (uint32_t)((ticks * 1000000ull) / TICK_FREQ);
+}
+
+
+/**@brief Function for storing the breakdown of the current transaction.
+ */
+static void record_store(uint32_t actuated_at) {
+    unlock_latency_record_t* p_record = &m_ring[m_ring_next];
+    const uint32_t gatt_from = (m_current.flags & UNLOCK_LATENCY_FLAG_SECURED) ? m_current.secured_at
+                                                                               : m_current.connected_at;
+
+    p_record->seq         = m_seq++;
+    p_record->flags       = m_current.flags;
+    p_record->security_us = (m_current.flags & UNLOCK_LATENCY_FLAG_SECURED) ? ticks_to_us(m_current.connected_at, m_current.secured_at) : 0;
+    p_record->gatt_us     = ticks_to_us(gatt_from, m_current.write_at);
+    p_record->firmware_us = ticks_to_us(m_current.write_at, actuated_at);
+
+    m_ring_next = (m_ring_next + 1) % UNLOCK_LATENCY_RING_SIZE;
+    if (m_ring_count < UNLOCK_LATENCY_RING_SIZE) {
+        ++m_ring_count;
+    }
+
+    NRF_LOG_INFO("Unlock %u: security %u us, gatt %u us, firmware %u us",
+                 p_record->seq, p_record->security_us, p_record->gatt_us, p_record->firmware_us);
+}
+
+
+void unlock_latency_mark(unlock_latency_mark_t mark) {
+    const uint32_t now = app_timer_cnt_get();
+
+    switch (mark) {
+        case UNLOCK_LATENCY_CONNECTED:
+            memset(&m_current, 0, sizeof(m_current));
+            m_current.active       = true;
+            m_current.connected_at = now;
+            break;
+
+        case UNLOCK_LATENCY_SECURED:
+            if (m_current.active && !(m_current.flags & UNLOCK_LATENCY_FLAG_SECURED)) {
+                m_current.flags     |= UNLOCK_LATENCY_FLAG_SECURED;
+                m_current.secured_at = now;
+            }
+            break;
+
+        case UNLOCK_LATENCY_WRITE:
+            m_current.write_pending = true;
+            m_current.write_at      = now;
+            break;
+
+        case UNLOCK_LATENCY_ACTUATED:
+            // Only unlocks triggered by a write within a connection are transactions
+            if (m_current.active && m_current.write_pending) {
+                record_store(now);
+                m_current.write_pending = false;
+            }
+            break;
+
+        case UNLOCK_LATENCY_WRITE_DONE:
+            m_current.write_pending = false;
+            break;
+    }
+}
+
+
+void unlock_latency_disconnected(void) {
+    m_current.active = false;
+}
+
+
+uint8_t unlock_latency_count(void) {
+    return m_ring_count;
+}
+
+
+bool unlock_latency_get(uint8_t index, unlock_latency_record_t* p_record) {
+    if (index >= m_ring_count || p_record == NULL) {
+        return false;
+    }
+
+    const uint8_t oldest = (m_ring_next + UNLOCK_LATENCY_RING_SIZE - m_ring_count) % UNLOCK_LATENCY_RING_SIZE;
+    *p_record = m_ring[(oldest + index) % UNLOCK_LATENCY_RING_SIZE];
+    return true;
+}
+
+
+uint8_t unlock_latency_encode(const unlock_latency_record_t* p_record, uint8_t* p_buf) {
+    uint8_t len = 0;
+
+    len += uint16_encode(p_record->seq, &p_buf[len]);
+    p_buf[len++] = p_record->flags;
+    len += uint32_encode(p_record->security_us, &p_buf[len]);
+    len += uint32_encode(p_record->gatt_us, &p_buf[len]);
+    len += uint32_encode(p_record->firmware_us, &p_buf[len]);
+
+    return len;
+}
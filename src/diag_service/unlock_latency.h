@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define UNLOCK_LATENCY_RING_SIZE    8       /**< Number of recent unlock transactions kept. */
+#define UNLOCK_LATENCY_RECORD_LEN   15      /**< Length of an encoded record, fits a default ATT MTU notification. */
+
+#define UNLOCK_LATENCY_FLAG_SECURED 0x01    /**< The link was encrypted before the unlock write. */
+
+
+/**@brief Points of an unlock transaction that are timestamped */
+typedef enum {
+    UNLOCK_LATENCY_CONNECTED,   /**< BLE_GAP_EVT_CONNECTED */
+    UNLOCK_LATENCY_SECURED,     /**< Encryption complete */
+    UNLOCK_LATENCY_WRITE,       /**< BLE_GATTS_EVT_WRITE on the command characteristic */
+    UNLOCK_LATENCY_ACTUATED,    /**< Lock actuated */
+    UNLOCK_LATENCY_WRITE_DONE   /**< Command handled, whether it unlocked or not */
+} unlock_latency_mark_t;
+
+/**@brief Latency breakdown of one unlock transaction */
+typedef struct {
+    uint16_t seq;           /**< Transaction sequence number */
+    uint8_t  flags;         /**< UNLOCK_LATENCY_FLAG_* */
+    uint32_t security_us;   /**< Connected to encryption complete (connection setup and security) */
+    uint32_t gatt_us;       /**< Encryption complete, or connected if not encrypted, to the unlock write (GATT) */
+    uint32_t firmware_us;   /**< Unlock write to actuation (firmware handling) */
+} unlock_latency_record_t;
+
+
+/**@brief Function for timestamping a point of the current unlock transaction.
+ *
+ * @details UNLOCK_LATENCY_CONNECTED starts a transaction. UNLOCK_LATENCY_ACTUATED completes it
+ *          and stores its breakdown in the ring of recent transactions, if it follows a command
+ *          write before that is marked UNLOCK_LATENCY_WRITE_DONE. A rejected command or a lock
+ *          command thus does not time a later unlock from another source, such as proximity.
+ *
+ * @param[in] mark  Point reached.
+ */
+void unlock_latency_mark(unlock_latency_mark_t mark);
+
+
+/**@brief Function for ending the current transaction when the link goes down.
+ */
+void unlock_latency_disconnected(void);
+
+
+/**@brief Function for getting the number of stored records.
+ */
+uint8_t unlock_latency_count(void);
+
+
+/**@brief Function for getting a stored record.
+ *
+ * @param[in]  index     0 for the oldest stored record, up to unlock_latency_count() - 1.
+ * @param[out] p_record  Record.
+ *
+ * @return True on success, false if @p index is out of range.
+ */
+bool unlock_latency_get(uint8_t index, unlock_latency_record_t* p_record);
+
+
+/**@brief Function for encoding a record for transmission, little endian.
+ *
+ * @param[in]  p_record  Record.
+ * @param[out] p_buf     Buffer of at least UNLOCK_LATENCY_RECORD_LEN bytes.
+ *
+ * @return Encoded length.
+ */
+uint8_t unlock_latency_encode(const unlock_latency_record_t* p_record, uint8_t* p_buf);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+#include "unlock_retry.h"
+#include "config.h"
+
+#include <string.h>
+#include "app_error.h"
+#include "app_timer.h"
+#include "nrf_log.h"
+
+
+APP_TIMER_DEF(m_window_timer);
+
+static unlock_retry_stats_t m_stats;
+static ble_gap_addr_t       m_peer;             /**< Peer of the current connection */
+static ble_gap_addr_t       m_last_peer;        /**< Peer of the previous unlock */
+static bool                 m_window_open;      /**< Within DOOR_RETRY_WINDOW_MS of the previous unlock */
+
+
+/**@brief Called DOOR_RETRY_WINDOW_MS after the last unlock
+ *
+ * @param[in] p_context  Unused
+ */
+static void window_timeout(void* p_context) {
+    m_window_open = false;
+}
+
+
+ret_code_t unlock_retry_init(void) {
+    return app_timer_create(&m_window_timer, APP_TIMER_MODE_SINGLE_SHOT, window_timeout);
+}
+
+
+void unlock_retry_connected(const ble_gap_addr_t* p_peer_addr) {
+    m_peer = *p_peer_addr;
+}
+
+
+void unlock_retry_unlocked(void) {
+    ret_code_t err_code;
+
+    // The window is timed rather than measured on the RTC counter, which wraps every 1024 s, so
+    // an unlock a multiple of that after the previous one is not taken for a retry
+    if (m_window_open && memcmp(m_last_peer.addr, m_peer.addr, BLE_GAP_ADDR_LEN) == 0) {
+        ++m_stats.retries;
+        NRF_LOG_INFO("Unlock retried by the same peer");
+    }
+
+    ++m_stats.unlocks;
+    m_last_peer   = m_peer;
+    m_window_open = true;
+
+    err_code = app_timer_stop(m_window_timer);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_start(m_window_timer, APP_TIMER_TICKS(DOOR_RETRY_WINDOW_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+void unlock_retry_ack_sent(void) {
+    ++m_stats.acks_sent;
+}
+
+
+void unlock_retry_linger_ended(bool delivered) {
+    if (delivered) {
+        ++m_stats.acks_delivered;
+    }
+    else {
+        ++m_stats.linger_timeouts;
+    }
+}
+
+
+const unlock_retry_stats_t* unlock_retry_stats_get(void) {
+    return &m_stats;
+}
+
+
+void unlock_retry_log(void) {
+    NRF_LOG_INFO("Unlocks: %u, retries %u, acks %u sent %u delivered, %u linger timeouts",
+                 m_stats.unlocks, m_stats.retries, m_stats.acks_sent, m_stats.acks_delivered,
+                 m_stats.linger_timeouts);
+}
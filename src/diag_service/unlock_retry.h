@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ble_gap.h"
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**@brief Unlock retry counters, since boot */
+typedef struct {
+    uint32_t unlocks;           /**< Unlocks within a connection */
+    uint32_t retries;           /**< Unlocks from the peer of the previous unlock within DOOR_RETRY_WINDOW_MS */
+    uint32_t acks_sent;         /**< Acknowledgements queued for notification */
+    uint32_t acks_delivered;    /**< Links closed once the acknowledgement was transmitted */
+    uint32_t linger_timeouts;   /**< Links closed by the end of DOOR_ACK_LINGER_MS instead */
+} unlock_retry_stats_t;
+
+
+/**@brief Function for initializing the unlock retry counters, creates the retry window timer.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t unlock_retry_init(void);
+
+
+/**@brief Function for recording the peer of a new connection.
+ *
+ * @param[in] p_peer_addr  Address of the peer, as in BLE_GAP_EVT_CONNECTED.
+ */
+void unlock_retry_connected(const ble_gap_addr_t* p_peer_addr);
+
+
+/**@brief Function for recording an unlock within the current connection.
+ *
+ * @details A phone that does not hear back before the link drops tries again, so an unlock by
+ *          the same peer shortly after its previous one is counted as a retry.
+ */
+void unlock_retry_unlocked(void);
+
+
+/**@brief Function for recording an acknowledgement queued for notification. */
+void unlock_retry_ack_sent(void);
+
+
+/**@brief Function for recording the end of the linger after an unlock.
+ *
+ * @param[in] delivered  True if the link is closed because the acknowledgement was transmitted,
+ *                       false if the linger timed out.
+ */
+void unlock_retry_linger_ended(bool delivered);
+
+
+/**@brief Function for getting the unlock retry counters. */
+const unlock_retry_stats_t* unlock_retry_stats_get(void);
+
+
+/**@brief Function for logging the unlock retry counters. */
+void unlock_retry_log(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -18,19 +18,60 @@
 #include "app_timer.h"
 
 #include "bsp.h"
-#include "bsp_btn_ble.h"
 
 #include "board_service/board_services.h"
+#include "board_service/battery.h"
 #include "ble_service/ble_services.h"
 #include "ble_service/ble_dls/ble_dls.h"
+#include "ble_service/adv_policy.h"
+#include "ble_service/conn_policy.h"
+#include "ble_service/proximity_scan.h"
+#include "auth_service/unlock_auth.h"
+#include "auth_service/auth_prefetch.h"
+#include "time_service/local_time.h"
+#include "time_service/usage_schedule.h"
+#include "diag_service/probe.h"
+#include "diag_service/unlock_latency.h"
+#include "diag_service/unlock_retry.h"
+#include "diag_service/evt_trace.h"
+#include "diag_service/ram_usage.h"
+#include "diag_service/boot_profile.h"
+#include "diag_service/crypto_bench.h"
 
 
 BLE_DLS_DEF(m_door);  /**< Define the door service instance */
 APP_TIMER_DEF(m_door_timer); /**< Define the door lock timer */
+APP_TIMER_DEF(m_challenge_timer); /**< Define the unlock challenge rotation timer */
+APP_TIMER_DEF(m_linger_timer); /**< Define the timer bounding the link after an unlock */
+
+#define DOOR_CREDENTIAL_RECORD_LEN  (sizeof(uint16_t) + UNLOCK_AUTH_KEY_LEN)  /**< Credential ID and key, in a credential batch */
+#define DOOR_RESPONSE_LEN           3                                         /**< Long command response: opcode, result, credentials added */
+#define DOOR_STATUS_LEN             4                                         /**< Advertised status: flags, state sequence number, battery level */
+#define DOOR_STATUS_EXT_LEN         10                                        /**< Status with extended advertising: then VDD, unlocks since boot and time of the change */
+#define DOOR_STATUS_FLAG_LOCKED     0x01                                      /**< Status flag set while the door is locked */
+#define DOOR_STATUS_TIME_UNKNOWN    0xFFFF                                    /**< Time of the change before a phone has set the local time */
+
+STATIC_ASSERT(UNLOCK_AUTH_CHALLENGE_LEN <= ADV_MANUF_DATA_MAX_LEN);
+STATIC_ASSERT((ADV_EXTENDED_ENABLED ? DOOR_STATUS_EXT_LEN : DOOR_STATUS_LEN) <= ADV_STATUS_MAX_LEN);
+STATIC_ASSERT(BLE_DLS_LONG_COMMAND_MAX_LEN <= QWR_MAX_WRITE_LEN);
+
+#if DOOR_DEV_KEY_ENABLED && defined(NDEBUG)
+#error "DOOR_DEV_KEY_ENABLED provisions a credential with a public key, it must be 0 in release builds"
+#endif
+
+static uint8_t  m_diag_stream_index;  /**< Next unlock latency record to stream */
+static bool     m_diag_streaming;     /**< Unlock latency records are being streamed */
+static uint16_t m_ack_seq;            /**< Sequence number of the next acknowledgement */
+static bool     m_lingering;          /**< The link stays up until the acknowledgement is transmitted */
+static bool     m_linger_ack_queued;  /**< The last acknowledgement was queued for notification */
+static uint16_t m_status_seq;         /**< Sequence number of the advertised status, incremented on every lock state change */
+static bool     m_status_published;   /**< The status has been advertised at least once */
+static uint16_t m_status_unlocks;     /**< Unlocks since boot in the extended status, saturating */
+static bool     m_status_locked;      /**< Lock state in the advertised status */
 
 static ble_uuid_t m_adv_uuids[] =                                               /**< Universally unique service identifiers. */
 {
-    //{DLS_UUID_SERVICE, BLE_UUID_TYPE_VENDOR_BEGIN}
+    {DLS_UUID_SERVICE, BLE_UUID_TYPE_UNKNOWN}                                   // Type set once the vendor base UUID is added
     //{BLE_UUID_DEVICE_INFORMATION_SERVICE, BLE_UUID_TYPE_BLE}
 };
 
@@ -53,27 +94,188 @@ void assert_nrf_callback(uint16_t line_num, const uint8_t * p_file_name)
 
 
 
-/**@brief Function for putting the chip into sleep mode.
- *
- * @note This function will not return.
+/**@brief Function for starting the door autolock timer.
  */
-static void sleep_mode_enter(void)
+static void door_timer_start(void)
 {
     ret_code_t err_code;
-
-    err_code = bsp_indication_set(BSP_INDICATE_IDLE);
+    err_code = app_timer_start(m_door_timer, APP_TIMER_TICKS(DOOR_AUTOLOCK_TIMEOUT_MS), NULL);
     APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Function for writing the last published lock state to the advertising data.
+ *
+ * @details The battery level is the last one measured. With extended advertising, gateways also
+ *          get the supply voltage, the unlocks since boot and the local time of the change.
+ */
+static void door_status_advertise(void)
+{
+    const uint16_t vdd_mv = battery_vdd_get();
+
+    uint8_t status[DOOR_STATUS_EXT_LEN];
+    status[0] = m_status_locked ? DOOR_STATUS_FLAG_LOCKED : 0;
+    uint16_encode(m_status_seq, &status[1]);
+    status[3] = battery_level_from_mv(vdd_mv);
+    uint16_encode(vdd_mv, &status[4]);
+    uint16_encode(m_status_unlocks, &status[6]);
+    uint16_encode(local_time_is_set() ? local_time_minute_of_week() : DOOR_STATUS_TIME_UNKNOWN, &status[8]);
+
+    advertising_status_set(status, ADV_EXTENDED_ENABLED ? DOOR_STATUS_EXT_LEN : DOOR_STATUS_LEN);
+}
+
+
+/**@brief Function for publishing the lock state in the advertising data.
+ *
+ * @details Phones that only show the lock state read it while scanning, without taking the link.
+ *          The sequence number changes with the state, so they can tell a relock from a missed
+ *          unlock. It restarts from 0 at boot.
+ *
+ * @param[in] locked  Lock state.
+ */
+static void door_status_publish(bool locked)
+{
+    if (m_status_published && locked == m_status_locked) {
+        return;
+    }
+    if (m_status_published) {
+        ++m_status_seq;
+    }
+    m_status_published = true;
+    m_status_locked    = locked;
+    if (!locked && m_status_unlocks < UINT16_MAX) {
+        ++m_status_unlocks;
+    }
+
+    door_status_advertise();
+}
 
-    // Prepare wakeup buttons.
-    err_code = bsp_btn_ble_sleep_mode_prepare();
+
+/**@brief Function for drawing a new unlock challenge and publishing it in the scan response.
+ *
+ * @details Phones read it while scanning and sign their command before connecting. If the RNG
+ *          pool is short, the current challenge stays up until the next rotation.
+ */
+static void challenge_publish(void)
+{
+    const ret_code_t err_code = unlock_auth_challenge_rotate();
+    if (err_code == NRF_ERROR_SOC_RAND_NOT_ENOUGH_VALUES) {
+        return;
+    }
     APP_ERROR_CHECK(err_code);
 
-    // Go to system-off mode (this function will not return; wakeup will cause a reset).
-    err_code = sd_power_system_off();
+    advertising_manuf_data_set(unlock_auth_challenge_get(), UNLOCK_AUTH_CHALLENGE_LEN);
+}
+
+
+/**@brief Called when the unlock challenge timer times out
+ *
+ * @param[in] p_context  Unused
+*/
+static void challenge_timeout(void* p_context)
+{
+    challenge_publish();
+}
+
+
+/**@brief Function for streaming the next unlock latency record over the diagnostic characteristic.
+ *
+ * @details Records are sent one at a time, the next one goes out when the previous one has
+ *          left the SoftDevice queue.
+ */
+static void diag_stream_next(void)
+{
+    unlock_latency_record_t record;
+    uint8_t                 buf[UNLOCK_LATENCY_RECORD_LEN];
+
+    if (!m_diag_streaming || !unlock_latency_get(m_diag_stream_index, &record)) {
+        m_diag_streaming = false;
+        return;
+    }
+
+    const uint8_t  len      = unlock_latency_encode(&record, buf);
+    const uint32_t err_code = ble_dls_diag_send(&m_door, buf, len);
+    if (err_code == NRF_SUCCESS) {
+        ++m_diag_stream_index;
+    }
+    else if (err_code != NRF_ERROR_RESOURCES) {
+        // Peer gone or notifications disabled, stop until the next subscription
+        m_diag_streaming = false;
+    }
+}
+
+
+/**@brief Function for logging the RAM usage and updating the RAM usage characteristic.
+ */
+static void ram_usage_publish(void)
+{
+    uint8_t buf[RAM_USAGE_RECORD_LEN];
+
+    ram_usage_log();
+
+    const uint32_t err_code = ble_dls_ram_usage_set(&m_door, buf, ram_usage_encode(buf));
     APP_ERROR_CHECK(err_code);
 }
 
 
+/**@brief Function for driving the lock to a new state.
+ *
+ * @details An unlock starts the autolock timer.
+ *
+ * @param[in]   locked   true to lock, false to unlock.
+ */
+static void door_actuate(bool locked)
+{
+    if (locked) {
+        NRF_LOG_INFO("Door locked");
+        bsp_board_led_on(DOOR_LOCK_LED);
+    }
+    else {
+        NRF_LOG_INFO("Door unlocked");
+        bsp_board_led_off(DOOR_LOCK_LED);
+        unlock_latency_mark(UNLOCK_LATENCY_ACTUATED);
+        door_timer_start();
+        usage_schedule_unlock_record();
+    }
+    door_status_publish(locked);
+}
+
+
+/**@brief Function for telling a notification the peer cannot take from a failure.
+ *
+ * @details The value is stored whether or not the notification goes out, so the peer can still
+ *          read it. Not being connected, notifications disabled, system attributes not restored
+ *          yet for an unbonded peer, a full queue or a pending indication are all expected.
+ *
+ * @param[in]   err_code   Result of the notification.
+ *
+ * @return      true if the error is one of the expected ones.
+ */
+static bool notification_error_tolerated(uint32_t err_code)
+{
+    return err_code == NRF_ERROR_INVALID_STATE ||
+           err_code == NRF_ERROR_RESOURCES ||
+           err_code == NRF_ERROR_BUSY ||
+           err_code == BLE_ERROR_GATTS_SYS_ATTR_MISSING;
+}
+
+
+/**@brief Function for locking the door locally, at boot, on autolock or with the lock button.
+ *
+ * @details The lock state characteristic is read and notify only, so it is reported here
+ *          rather than written.
+ */
+static void door_lock(void)
+{
+    door_actuate(true);
+
+    const uint32_t err_code = ble_dls_lock_state_report(&m_door, true);
+    if (!notification_error_tolerated(err_code)) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
 /**@brief Called when the the timer for the auto door lock times out
  *
  * @param[in] p_context  Unused
@@ -81,18 +283,276 @@ static void sleep_mode_enter(void)
 static void door_lock_timeout(void* p_context)
 {
     NRF_LOG_INFO("Door autolock engaged");
-    ble_dls_lock_state_set(&m_door, true);
+    door_lock();
 }
 
 
-/**@brief Function for starting the door autolock timer.
+/**@brief Function for acknowledging a command to the phone.
+ *
+ * @details Without notifications enabled the acknowledgement can still be read.
+ *
+ * @param[in]   result   Result of the command.
+ * @param[in]   locked   Lock state after it.
  */
-static void door_timer_start(void)
+static void door_ack_send(ble_dls_ack_result_t result, bool locked)
 {
-    ret_code_t err_code;
-    err_code = app_timer_start(m_door_timer, APP_TIMER_TICKS(5000), NULL);
+    const uint32_t err_code = ble_dls_ack_send(&m_door, m_ack_seq++, result, locked);
+
+    m_linger_ack_queued = (err_code == NRF_SUCCESS);
+    if (err_code == NRF_SUCCESS) {
+        unlock_retry_ack_sent();
+    }
+    else if (!notification_error_tolerated(err_code)) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for ending the linger after an unlock and terminating the link.
+ *
+ * @param[in]   delivered   True if the acknowledgement was transmitted, false on timeout.
+ */
+static void door_linger_end(bool delivered)
+{
+    m_lingering = false;
+    unlock_retry_linger_ended(delivered);
+
+    ret_code_t err_code = app_timer_stop(m_linger_timer);
     APP_ERROR_CHECK(err_code);
+
+    err_code = sd_ble_gap_disconnect(m_door.conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+    if (err_code != NRF_ERROR_INVALID_STATE && err_code != BLE_ERROR_INVALID_CONN_HANDLE) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for keeping the link up after an unlock until the acknowledgement is out.
+ *
+ * @details The phone has nothing left to do once it has heard back, but a link terminated
+ *          before the acknowledgement leaves the SoftDevice queue makes it retry. The link is
+ *          terminated on the first BLE_DLS_EVT_TX_COMPLETE that empties the notification queue,
+ *          or after DOOR_ACK_LINGER_MS.
+ */
+static void door_linger_start(void)
+{
+    if (m_door.conn_handle == BLE_CONN_HANDLE_INVALID || m_lingering) {
+        return;
+    }
+
+    m_lingering = true;
+
+    const ret_code_t err_code = app_timer_start(m_linger_timer, APP_TIMER_TICKS(DOOR_ACK_LINGER_MS), NULL);
+    APP_ERROR_CHECK(err_code);
+}
+
+
+/**@brief Called when the linger after an unlock times out
+ *
+ * @param[in] p_context  Unused
+*/
+static void linger_timeout(void* p_context)
+{
+    if (m_lingering) {
+        NRF_LOG_WARNING("Acknowledgement not transmitted in time");
+        door_linger_end(false);
+    }
+}
+
+
+/**@brief Function for mapping a command verification error to an acknowledgement result.
+ *
+ * @param[in]   err_code   Error code of unlock_auth_command_verify.
+ */
+static ble_dls_ack_result_t door_ack_result(ret_code_t err_code)
+{
+    switch (err_code) {
+        case NRF_SUCCESS:
+            return BLE_DLS_ACK_OK;
+
+        case NRF_ERROR_INVALID_LENGTH:
+            return BLE_DLS_ACK_INVALID_LENGTH;
+
+        case NRF_ERROR_NOT_SUPPORTED:
+            return BLE_DLS_ACK_INVALID_OPCODE;
+
+        case NRF_ERROR_NOT_FOUND:
+            return BLE_DLS_ACK_UNKNOWN_CREDENTIAL;
+
+        case NRF_ERROR_INVALID_STATE:
+            return BLE_DLS_ACK_REPLAYED;
+
+        case NRF_ERROR_INVALID_DATA:
+            return BLE_DLS_ACK_INVALID_MAC;
+
+        default:
+            return BLE_DLS_ACK_BUSY;
+    }
+}
+
+
+/**@brief Function for acting on a verified lock or unlock command.
+ *
+ * @details Shared by the command characteristic and proximity unlocks. The lock state
+ *          characteristic is updated either way, so a subscribed phone learns of every change.
+ *
+ * @param[in]   p_command   Verified command.
+ * @param[in]   from_peer   The command was written by the connected peer. The retry and prefetch
+ *                          statistics track that peer, so they leave out commands of wearables,
+ *                          which proximity_scan counts itself.
+ */
+static void door_command_accept(const unlock_auth_command_t* p_command, bool from_peer)
+{
+    const bool locked = (p_command->opcode == UNLOCK_AUTH_OP_LOCK);
+
+    door_actuate(locked);
+    if (from_peer) {
+        auth_prefetch_command_accepted(p_command->cred_id);
+        if (!locked) {
+            unlock_retry_unlocked();
+        }
+    }
+
+    const uint32_t err_code = ble_dls_lock_state_report(&m_door, locked);
+    if (!notification_error_tolerated(err_code)) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for acting on a command written to the command characteristic.
+ *
+ * @details Verified and acted on within the write event, the lock state characteristic is only
+ *          updated to report the new state. Every command is acknowledged, a rejected one leaves
+ *          the link up for the phone to try again.
+ *
+ * @param[in]   p_door      Door Service structure.
+ * @param[in]   p_command   Command as written by the phone.
+ */
+static void door_command_handle(ble_dls_t* p_door, const ble_dls_command_t* p_command)
+{
+    unlock_auth_command_t command;
+    uint32_t              err_code;
+
+    ret_code_t auth_err_code = unlock_auth_command_verify(p_command->p_data, p_command->len, &command);
+    if (auth_err_code == NRF_SUCCESS && command.opcode == UNLOCK_AUTH_OP_ENROLL) {
+        // Only valid at the head of a credential batch
+        auth_err_code = NRF_ERROR_NOT_SUPPORTED;
+    }
+    if (auth_err_code != NRF_SUCCESS) {
+        NRF_LOG_WARNING("Command rejected: 0x%x", auth_err_code);
+
+        uint8_t door_locked;
+        err_code = ble_dls_lock_state_get(p_door, &door_locked);
+        APP_ERROR_CHECK(err_code);
+        door_ack_send(door_ack_result(auth_err_code), door_locked);
+        return;
+    }
+
+    const bool locked = (command.opcode == UNLOCK_AUTH_OP_LOCK);
+    door_command_accept(&command, true);
+
+    door_ack_send(BLE_DLS_ACK_OK, locked);
+    if (!locked) {
+        door_linger_start();
+    }
+}
+
+
+/**@brief Function for enrolling a batch of credentials.
+ *
+ * @details The batch starts with an enroll command signed by an enrolled credential, followed by
+ *          records of a 16-bit credential ID and a key. Credentials are added in order until one
+ *          is rejected, the ones before it stay enrolled.
+ *
+ * @param[in]   p_data    Batch, after the long command opcode.
+ * @param[in]   len       Batch length.
+ * @param[out]  p_added   Credentials added.
+ *
+ * @return      Result of the batch.
+ */
+static ble_dls_ack_result_t door_credentials_add(const uint8_t* p_data, uint16_t len, uint8_t* p_added)
+{
+    unlock_auth_command_t command;
+
+    *p_added = 0;
+    if (len < UNLOCK_AUTH_COMMAND_LEN || (len - UNLOCK_AUTH_COMMAND_LEN) % DOOR_CREDENTIAL_RECORD_LEN != 0) {
+        return BLE_DLS_ACK_INVALID_LENGTH;
+    }
+
+    ret_code_t err_code = unlock_auth_command_verify(p_data, UNLOCK_AUTH_COMMAND_LEN, &command);
+    if (err_code == NRF_SUCCESS && command.opcode != UNLOCK_AUTH_OP_ENROLL) {
+        err_code = NRF_ERROR_NOT_SUPPORTED;
+    }
+    if (err_code != NRF_SUCCESS) {
+        NRF_LOG_WARNING("Enrollment rejected: 0x%x", err_code);
+        return door_ack_result(err_code);
+    }
+
+    for (uint16_t offset = UNLOCK_AUTH_COMMAND_LEN; offset < len; offset += DOOR_CREDENTIAL_RECORD_LEN) {
+        const uint16_t cred_id = uint16_decode(&p_data[offset]);
+
+        err_code = unlock_auth_credential_add(cred_id, &p_data[offset + sizeof(uint16_t)]);
+        if (err_code != NRF_SUCCESS) {
+            NRF_LOG_WARNING("Credential 0x%04x not enrolled: 0x%x", cred_id, err_code);
+            return BLE_DLS_ACK_REJECTED;
+        }
+        ++*p_added;
+    }
+
+    NRF_LOG_INFO("%u credentials enrolled by 0x%04x", *p_added, command.cred_id);
+    return BLE_DLS_ACK_OK;
+}
+
+
+/**@brief Function for acting on a command written to the long command characteristic.
+ *
+ * @details Answered on the response characteristic with the opcode, the result and the number
+ *          of credentials added.
+ *
+ * @param[in]   p_door      Door Service structure.
+ * @param[in]   p_command   Long command as written by the phone.
+ */
+static void door_long_command_handle(ble_dls_t* p_door, const ble_dls_command_t* p_command)
+{
+    uint8_t response[DOOR_RESPONSE_LEN] = {0};
+
+    if (p_command->len == 0) {
+        response[1] = BLE_DLS_ACK_INVALID_LENGTH;
+    }
+    else {
+        response[0] = p_command->p_data[0];
+        switch (p_command->p_data[0]) {
+            case BLE_DLS_LONG_OP_CREDENTIALS_ADD:
+                response[1] = door_credentials_add(&p_command->p_data[1], p_command->len - 1, &response[2]);
+                break;
+
+            default:
+                response[1] = BLE_DLS_ACK_INVALID_OPCODE;
+                break;
+        }
+    }
+
+    const uint32_t err_code = ble_dls_response_send(p_door, response, sizeof(response));
+    if (!notification_error_tolerated(err_code)) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+#if PROXIMITY_SCAN_ENABLED
+/**@brief Function for unlocking for a wearable that came close to the door.
+ *
+ * @details Takes the accept path of the command characteristic. The wearable has no link, so
+ *          there is no acknowledgement and no linger.
+ *
+ * @param[in]   p_command   Verified unlock command the wearable advertised.
+ */
+static void on_proximity_unlock(const unlock_auth_command_t* p_command)
+{
+    door_command_accept(p_command, false);
 }
+#endif
 
 
 /**@brief Function for handling the Door Service Service events.
@@ -106,8 +566,8 @@ static void door_timer_start(void)
  */
 static void on_door_evt(ble_dls_t* p_door, ble_dls_evt_t* p_evt) {
     uint32_t err_code;
-    uint8_t door_locked;
 
+    PROBE_BEGIN(probe_start);
     switch(p_evt->evt_type) {
         case BLE_DLS_EVT_NOTIFICATION_ENABLED:
             break;
@@ -119,27 +579,56 @@ static void on_door_evt(ble_dls_t* p_door, ble_dls_evt_t* p_evt) {
             break;
 
         case BLE_DLS_EVT_DISCONNECTED:
+            m_diag_streaming    = false;
+            m_linger_ack_queued = false;
+            if (m_lingering) {
+                // The phone closed the link first, it has what it needs
+                m_lingering = false;
+                err_code = app_timer_stop(m_linger_timer);
+                APP_ERROR_CHECK(err_code);
+            }
             break;
 
-        case BLE_DLS_EVT_WRITE: {
-            err_code = ble_dls_lock_state_get(p_door, &door_locked);
-            APP_ERROR_CHECK(err_code);
-            if (door_locked) {
-                NRF_LOG_INFO("Door locked");
-                bsp_board_led_on(DOOR_LOCK_LED);
+        case BLE_DLS_EVT_DIAG_NOTIFICATION_ENABLED:
+            m_diag_stream_index = 0;
+            m_diag_streaming    = true;
+            diag_stream_next();
+            break;
+
+        case BLE_DLS_EVT_DIAG_NOTIFICATION_DISABLED:
+            m_diag_streaming = false;
+            break;
+
+        case BLE_DLS_EVT_TX_COMPLETE:
+            if (m_lingering && m_linger_ack_queued && p_door->hvx_pending == 0) {
+                door_linger_end(true);
+                break;
+            }
+            diag_stream_next();
+            break;
+
+        case BLE_DLS_EVT_COMMAND:
+            door_command_handle(p_door, &p_evt->params.command);
+            break;
+
+        case BLE_DLS_EVT_LONG_COMMAND:
+            door_long_command_handle(p_door, &p_evt->params.command);
+            break;
+
+        case BLE_DLS_EVT_TIME_WRITE:
+            err_code = local_time_set(p_evt->params.minute_of_week);
+            if (err_code == NRF_ERROR_INVALID_PARAM) {
+                NRF_LOG_WARNING("Local time out of range: %u", p_evt->params.minute_of_week);
             }
             else {
-                NRF_LOG_INFO("Door unlocked");
-                bsp_board_led_off(DOOR_LOCK_LED);
-                door_timer_start();
-                sd_ble_gap_disconnect(p_door->conn_handle, BLE_HCI_REMOTE_USER_TERMINATED_CONNECTION);
+                APP_ERROR_CHECK(err_code);
             }
             break;
-        }
 
         default:
             break;
     }
+    PROBE_END(PROBE_ON_DOOR_EVT, probe_start);
 }
 
 
@@ -148,13 +637,27 @@ static void on_door_evt(ble_dls_t* p_door, ble_dls_evt_t* p_evt) {
  * @param[in]   event   Event generated when button is pressed.
  */
 void bsp_event_handler(bsp_event_t event) {
+    ret_code_t err_code;
+
     switch (event) {
         case BSP_EVENT_SLEEP:
-            sleep_mode_enter();
+            // Raised by releasing the wake-up button while advertising, the lock never sleeps
+            err_code = adv_policy_wake();
+            if (err_code != NRF_ERROR_INVALID_STATE) {
+                APP_ERROR_CHECK(err_code);
+            }
+            break;
+
+        case BSP_EVENT_WHITELIST_OFF:
+            // Lets a phone that is not bonded yet in while the whitelist phase runs
+            err_code = adv_policy_whitelist_off();
+            if (err_code != NRF_ERROR_INVALID_STATE) {
+                APP_ERROR_CHECK(err_code);
+            }
             break;
 
         case DOOR_LOCK_BUTTON_EVT:
-            ble_dls_lock_state_set(&m_door, true);
+            door_lock();
             break;
 
         /* Don't want these for now
@@ -166,18 +669,10 @@ void bsp_event_handler(bsp_event_t event) {
                 APP_ERROR_CHECK(err_code);
             }
             break; // BSP_EVENT_DISCONNECT
-
-        case BSP_EVENT_WHITELIST_OFF:
-            if (m_conn_handle == BLE_CONN_HANDLE_INVALID)
-            {
-                err_code = ble_advertising_restart_without_whitelist(&m_advertising);
-                if (err_code != NRF_ERROR_INVALID_STATE)
-                {
-                    APP_ERROR_CHECK(err_code);
-                }
-            }
-            break; // BSP_EVENT_KEY_0
         */
+
+        default:
+            break;
     }
 }
 
@@ -187,9 +682,19 @@ void bsp_event_handler(bsp_event_t event) {
  * @param[in]   ble_adv_evt   Advertising event.
  */
 void ble_adv_evt_handler(ble_adv_evt_t ble_adv_evt) {
+    ret_code_t err_code;
+
     switch (ble_adv_evt) {
-        case BLE_ADV_EVT_IDLE:
-            sleep_mode_enter();
+        case BLE_ADV_EVT_FAST_WHITELIST:
+        case BLE_ADV_EVT_FAST:
+            // Every advertising session starts with a fresh challenge, a wake restarts the
+            // session while the timer runs. Not on the directed phases, which carry no scan
+            // response, so a phone reconnecting right away still holds a valid challenge
+            challenge_publish();
+            err_code = app_timer_stop(m_challenge_timer);
+            APP_ERROR_CHECK(err_code);
+            err_code = app_timer_start(m_challenge_timer, APP_TIMER_TICKS(UNLOCK_AUTH_CHALLENGE_ROTATE_MS), NULL);
+            APP_ERROR_CHECK(err_code);
             break;
 
         default:
@@ -198,6 +703,18 @@ void ble_adv_evt_handler(ble_adv_evt_t ble_adv_evt) {
 }
 
 
+/**@brief User function for handling Queued Write module events.
+ *
+ * @details The long command characteristic is the only attribute registered.
+ *
+ * @param[in]   p_qwr   Queued Write module instance.
+ * @param[in]   p_evt   Queued Write module event.
+ */
+static uint16_t qwr_evt_handler(nrf_ble_qwr_t* p_qwr, nrf_ble_qwr_evt_t* p_evt) {
+    return ble_dls_on_qwr_evt(&m_door, p_qwr, p_evt);
+}
+
+
 /**@brief User function for handling BLE events.
  *
  * @param[in]   p_ble_evt   Bluetooth stack event.
@@ -210,10 +727,19 @@ void ble_evt_handler(const ble_evt_t* p_ble_evt, void* p_context) {
     {
         case BLE_GAP_EVT_CONNECTED: {
             bsp_board_led_on(CONNECTED_LED);
+
+            // Nobody can read the scan response while connected
+            err_code = app_timer_stop(m_challenge_timer);
+            APP_ERROR_CHECK(err_code);
         } break;
 
         case BLE_GAP_EVT_DISCONNECTED: {
             bsp_board_led_off(CONNECTED_LED);
+            probe_log_dump();
+            conn_policy_log();
+            unlock_retry_log();
+            auth_prefetch_log();
+            ram_usage_publish();
         } break;
     }
 }
@@ -244,6 +770,12 @@ static void application_timers_init(void)
     ret_code_t err_code;
     err_code = app_timer_create(&m_door_timer, APP_TIMER_MODE_SINGLE_SHOT, door_lock_timeout);
     APP_ERROR_CHECK(err_code);
+    err_code = app_timer_create(&m_challenge_timer, APP_TIMER_MODE_REPEATED, challenge_timeout);
+    APP_ERROR_CHECK(err_code);
+    err_code = app_timer_create(&m_linger_timer, APP_TIMER_MODE_SINGLE_SHOT, linger_timeout);
+    APP_ERROR_CHECK(err_code);
+    err_code = unlock_retry_init();
+    APP_ERROR_CHECK(err_code);
 }
 
 
@@ -251,14 +783,41 @@ static void application_timers_init(void)
  */
 static void door_service_init(void) {
     ble_dls_init_t door_init = {0};
-    
+    ret_code_t     err_code;
+
+    err_code = unlock_auth_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = usage_schedule_init();
+    APP_ERROR_CHECK(err_code);
+
+#if DOOR_DEV_KEY_ENABLED
+    static const uint8_t dev_key[UNLOCK_AUTH_KEY_LEN] = UNLOCK_AUTH_DEV_KEY;
+
+    NRF_LOG_WARNING("Development credential enabled");
+    err_code = unlock_auth_credential_add(UNLOCK_AUTH_DEV_CRED_ID, dev_key);
+    APP_ERROR_CHECK(err_code);
+#endif
+
     door_init.evt_handler = on_door_evt;
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&door_init.lock_state_char_attr_md.cccd_write_perm);
     BLE_GAP_CONN_SEC_MODE_SET_OPEN(&door_init.lock_state_char_attr_md.read_perm);
-    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&door_init.lock_state_char_attr_md.write_perm);
-
-    const ret_code_t err_code = ble_dls_init(&m_door, &door_init);
+    // Read and notify only, every unlock is a signed command
+    BLE_GAP_CONN_SEC_MODE_SET_NO_ACCESS(&door_init.lock_state_char_attr_md.write_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&door_init.diag_char_attr_md.cccd_write_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&door_init.diag_char_attr_md.read_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&door_init.command_write_perm);
+    // The clock drives the scan duty cycle and the learned schedule, only paired phones set it
+    BLE_GAP_CONN_SEC_MODE_SET_ENC_NO_MITM(&door_init.time_write_perm);
+    BLE_GAP_CONN_SEC_MODE_SET_OPEN(&door_init.long_command_write_perm);
+    door_init.p_qwr = ble_services_qwr_get();
+
+    err_code = ble_dls_init(&m_door, &door_init);
     APP_ERROR_CHECK(err_code);
+
+    // Advertised for hardware scan filters, advertising is initialized after the services
+    m_adv_uuids[0].type = m_door.uuid_type;
+
+    ram_usage_static_set(RAM_USAGE_DOOR, sizeof(m_door));
 }
 
 
@@ -281,22 +840,47 @@ int main(void)
 
     ble_init.adv_evt_handler         = ble_adv_evt_handler;
     ble_init.ble_evt_handler         = ble_evt_handler;
+    ble_init.qwr_evt_handler         = qwr_evt_handler;
     ble_init.service_init_funcs      = init_funcs;
     ble_init.service_init_func_count = sizeof(init_funcs) / sizeof(init_funcs[0]);
-    ble_init.adv_uuids               = NULL;//m_adv_uuids;
-    ble_init.adv_uuid_count          = 0;//sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
+    ble_init.adv_uuids               = m_adv_uuids;
+    ble_init.adv_uuid_count          = sizeof(m_adv_uuids) / sizeof(m_adv_uuids[0]);
 
     // Initialize
+    ram_usage_stack_paint();
+    probe_init();
+    boot_profile_start();
     board_services_init(&board_init);
+    evt_trace_init();
     ble_services_init(&ble_init);
     application_timers_init();
+    door_lock();
+
+    // Start execution. Every reset boots through here, so anything not needed to accept a
+    // connection is done after advertising has started.
+    BOOT_PROFILE_STEP(BOOT_STEP_ADVERTISING_START, advertising_start(erase_bonds));
+
+    ret_code_t err_code = local_time_init();
+    APP_ERROR_CHECK(err_code);
+    err_code = battery_init();
+    APP_ERROR_CHECK(err_code);
+    // The boot status went out before the first measurement, without a battery level
+    door_status_advertise();
 
-    const ret_code_t err_code = ble_dls_lock_state_set(&m_door, true);
+#if PROXIMITY_SCAN_ENABLED
+    err_code = proximity_scan_init(on_proximity_unlock);
     APP_ERROR_CHECK(err_code);
+#endif
 
-    // Start execution
     NRF_LOG_INFO("Door lock server started");
-    advertising_start(erase_bonds);
+    boot_profile_log();
+    ram_usage_publish();
+
+#if CRYPTO_BENCH_ENABLED
+    const ret_code_t bench_err_code = crypto_bench_run(CRYPTO_BENCH_ITERATIONS);
+    APP_ERROR_CHECK(bench_err_code);
+    crypto_bench_log();
+#endif
 
     // Enter main loop
     for (;;) {
@@ -0,0 +1,69 @@
+#include "local_time.h"
+
+#include "app_error.h"
+#include "app_timer.h"
+#include "sdk_macros.h"
+#include "nrf_log.h"
+
+
+#define LOCAL_TIME_TICK_MS  60000   /**< Resolution of the clock, one minute. */
+
+
+APP_TIMER_DEF(m_minute_timer);
+
+static uint16_t m_minute_of_week;
+static bool     m_set;
+
+
+/**@brief Called every minute to advance the clock
+ *
+ * @param[in] p_context  Unused
+ */
+static void minute_timeout(void* p_context) {
+    m_minute_of_week = (m_minute_of_week + 1) % LOCAL_TIME_MINUTES_PER_WEEK;
+}
+
+
+ret_code_t local_time_init(void) {
+    ret_code_t err_code = app_timer_create(&m_minute_timer, APP_TIMER_MODE_REPEATED, minute_timeout);
+    VERIFY_SUCCESS(err_code);
+
+    return app_timer_start(m_minute_timer, APP_TIMER_TICKS(LOCAL_TIME_TICK_MS), NULL);
+}
+
+
+ret_code_t local_time_set(uint16_t minute_of_week) {
+    if (minute_of_week >= LOCAL_TIME_MINUTES_PER_WEEK) {
+        return NRF_ERROR_INVALID_PARAM;
+    }
+
+    // Restart the minute so the next tick is a full minute away
+    ret_code_t err_code = app_timer_stop(m_minute_timer);
+    VERIFY_SUCCESS(err_code);
+    err_code = app_timer_start(m_minute_timer, APP_TIMER_TICKS(LOCAL_TIME_TICK_MS), NULL);
+    VERIFY_SUCCESS(err_code);
+
+    if (!m_set || minute_of_week != m_minute_of_week) {
+        NRF_LOG_INFO("Local time set: day %u %02u:%02u", minute_of_week / LOCAL_TIME_MINUTES_PER_DAY,
+                     (minute_of_week % LOCAL_TIME_MINUTES_PER_DAY) / 60, minute_of_week % 60);
+    }
+
+    m_minute_of_week = minute_of_week;
+    m_set            = true;
+    return NRF_SUCCESS;
+}
+
+
+bool local_time_is_set(void) {
+    return m_set;
+}
+
+
+uint16_t local_time_minute_of_week(void) {
+    return m_minute_of_week;
+}
+
+
+uint8_t local_time_hour_of_day(void) {
+    return (uint8_t)((m_minute_of_week % LOCAL_TIME_MINUTES_PER_DAY) / 60);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define LOCAL_TIME_MINUTES_PER_DAY   (24 * 60)                          /**< Minutes in a day. */
+#define LOCAL_TIME_MINUTES_PER_WEEK  (7 * LOCAL_TIME_MINUTES_PER_DAY)   /**< Minutes in a week, the range of the clock. */
+
+
+/**@brief Function for initializing the local time clock.
+ *
+ * @details The lock has no calendar, phones tell it the local time when they connect. The
+ *          clock then counts minutes on an application timer, so it drifts with the low
+ *          frequency clock until the next phone corrects it. It is not set until then.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t local_time_init(void);
+
+
+/**@brief Function for setting the local time.
+ *
+ * @param[in] minute_of_week  Minutes since Monday 00:00 local time, below LOCAL_TIME_MINUTES_PER_WEEK.
+ *
+ * @return NRF_SUCCESS, or NRF_ERROR_INVALID_PARAM if @p minute_of_week is out of range.
+ */
+ret_code_t local_time_set(uint16_t minute_of_week);
+
+
+/**@brief Function for checking if the local time has been set since boot. */
+bool local_time_is_set(void);
+
+
+/**@brief Function for getting the local time, in minutes since Monday 00:00. */
+uint16_t local_time_minute_of_week(void);
+
+
+/**@brief Function for getting the local hour of the day, 0 to 23. */
+uint8_t local_time_hour_of_day(void);
+
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,221 @@
+#include "usage_schedule.h"
+#include "config.h"
+
+#include <string.h>
+
+#include "app_error.h"
+#include "app_util.h"
+#include "sdk_macros.h"
+#include "nrf_log.h"
+#include "fds.h"
+#include "local_time.h"
+
+
+STATIC_ASSERT(USAGE_SCHEDULE_HOURS % sizeof(uint32_t) == 0);
+STATIC_ASSERT(USAGE_SCHEDULE_MIN_UNLOCKS > 0 && USAGE_SCHEDULE_MIN_UNLOCKS <= UINT8_MAX);
+STATIC_ASSERT(USAGE_SCHEDULE_STORE_BATCH > 0);
+
+#define MASK_WORDS  ((USAGE_SCHEDULE_HOURS + 31) / 32)
+
+
+static union {
+    uint8_t  counts[USAGE_SCHEDULE_HOURS];
+    uint32_t words[USAGE_SCHEDULE_HOURS / sizeof(uint32_t)];    /**< Word aligned for FDS */
+} m_histogram;
+
+static uint32_t               m_habitual[MASK_WORDS];   /**< Habitual hours of the week, one bit each */
+static bool                   m_stale;                  /**< m_habitual does not reflect m_histogram */
+static bool                   m_saturated;              /**< An hour reached UINT8_MAX, halve on the next recompute */
+static fds_record_desc_t      m_record_desc;
+static bool                   m_record_found;
+static uint8_t                m_unstored;               /**< Unlocks recorded since the histogram was last written */
+static bool                   m_store_pending;          /**< Histogram still to be written, FDS was not ready or its queue was full */
+static bool                   m_gc_pending;             /**< Histogram to be written once garbage collection completes */
+static bool                   m_gc_done;                /**< Garbage collection already ran for this write */
+static usage_schedule_stats_t m_stats;
+
+
+/**@brief Function for queueing the write of the histogram.
+ *
+ * @details If FDS is not ready or its queue is full, the write is retried on the next FDS event.
+ *          If flash is full, it is retried once garbage collection completes, and given up if
+ *          that freed nothing. The histogram in RAM is authoritative until then.
+ */
+static void histogram_store(void) {
+    fds_record_t record;
+    ret_code_t   err_code;
+
+    record.file_id           = USAGE_SCHEDULE_FILE_ID;
+    record.key               = USAGE_SCHEDULE_KEY;
+    record.data.p_data       = m_histogram.words;
+    record.data.length_words = ARRAY_SIZE(m_histogram.words);
+
+    if (m_record_found) {
+        err_code = fds_record_update(&m_record_desc, &record);
+    }
+    else {
+        err_code = fds_record_write(&m_record_desc, &record);
+    }
+
+    m_store_pending = (err_code == FDS_ERR_NO_SPACE_IN_QUEUES || err_code == FDS_ERR_NOT_INITIALIZED);
+    if (err_code == NRF_SUCCESS) {
+        m_record_found = true;
+        m_gc_done      = false;
+        m_unstored     = 0;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH && m_gc_done) {
+        NRF_LOG_WARNING("Usage schedule: no flash left for the histogram");
+        m_gc_done = false;
+    }
+    else if (err_code == FDS_ERR_NO_SPACE_IN_FLASH) {
+        err_code = fds_gc();
+        m_gc_pending    = (err_code == NRF_SUCCESS);
+        m_store_pending = (err_code == FDS_ERR_NO_SPACE_IN_QUEUES);
+        if (err_code != NRF_SUCCESS && err_code != FDS_ERR_NO_SPACE_IN_QUEUES) {
+            APP_ERROR_CHECK(err_code);
+        }
+    }
+    else if (err_code != FDS_ERR_NO_SPACE_IN_QUEUES && err_code != FDS_ERR_NOT_INITIALIZED) {
+        APP_ERROR_CHECK(err_code);
+    }
+}
+
+
+/**@brief Function for adding the histogram stored in flash to the unlocks recorded since boot.
+ */
+static void histogram_load(void) {
+    fds_find_token_t   token = {0};
+    fds_flash_record_t record;
+
+    ret_code_t err_code = fds_record_find(USAGE_SCHEDULE_FILE_ID, USAGE_SCHEDULE_KEY, &m_record_desc, &token);
+    if (err_code == FDS_ERR_NOT_FOUND) {
+        return;
+    }
+    APP_ERROR_CHECK(err_code);
+
+    err_code = fds_record_open(&m_record_desc, &record);
+    APP_ERROR_CHECK(err_code);
+    if (record.p_header->length_words == ARRAY_SIZE(m_histogram.words)) {
+        const uint8_t* p_counts = record.p_data;
+        for (unsigned int hour = 0; hour < USAGE_SCHEDULE_HOURS; ++hour) {
+            const unsigned int count = m_histogram.counts[hour] + p_counts[hour];
+            m_histogram.counts[hour] = (count < UINT8_MAX) ? count : UINT8_MAX;
+            m_saturated             |= (count >= UINT8_MAX);
+        }
+    }
+    err_code = fds_record_close(&m_record_desc);
+    APP_ERROR_CHECK(err_code);
+
+    m_record_found = true;
+    m_stats.loaded = true;
+    m_stale        = true;
+}
+
+
+/**@brief Function for handling FDS events, loads the histogram once FDS is ready and retries
+ *        writes that did not fit before.
+ */
+static void fds_evt_handler(const fds_evt_t* p_evt) {
+    if (p_evt->id == FDS_EVT_INIT && p_evt->result == NRF_SUCCESS) {
+        histogram_load();
+        if (m_store_pending) {
+            // A batch completed before FDS was ready
+            histogram_store();
+        }
+    }
+    else if (p_evt->id == FDS_EVT_GC && m_gc_pending) {
+        m_gc_pending = false;
+        m_gc_done    = true;
+        histogram_store();
+    }
+    else if (m_store_pending) {
+        histogram_store();
+    }
+}
+
+
+/**@brief Function for picking the habitual hours from the histogram.
+ *
+ * @details Halves the histogram first if an hour saturated, which keeps the proportions.
+ */
+static void schedule_recompute(void) {
+    uint32_t total = 0;
+
+    if (m_saturated) {
+        for (unsigned int hour = 0; hour < USAGE_SCHEDULE_HOURS; ++hour) {
+            m_histogram.counts[hour] /= 2;
+        }
+        m_saturated = false;
+        histogram_store();
+    }
+
+    for (unsigned int hour = 0; hour < USAGE_SCHEDULE_HOURS; ++hour) {
+        total += m_histogram.counts[hour];
+    }
+
+    memset(m_habitual, 0, sizeof(m_habitual));
+    m_stats.habitual_hours = 0;
+    for (unsigned int hour = 0; hour < USAGE_SCHEDULE_HOURS; ++hour) {
+        const uint32_t count = m_histogram.counts[hour];
+
+        // At least the minimum, and the peak ratio times the mean
+        if (count >= USAGE_SCHEDULE_MIN_UNLOCKS && count * USAGE_SCHEDULE_HOURS >= total * USAGE_SCHEDULE_PEAK_RATIO) {
+            m_habitual[hour / 32] |= 1UL << (hour % 32);
+            ++m_stats.habitual_hours;
+        }
+    }
+
+    m_stale = false;
+    ++m_stats.recomputes;
+    NRF_LOG_INFO("Usage schedule: %u unlocks, %u habitual hours", total, m_stats.habitual_hours);
+}
+
+
+ret_code_t usage_schedule_init(void) {
+    memset(&m_histogram, 0, sizeof(m_histogram));
+    memset(m_habitual, 0, sizeof(m_habitual));
+    m_stale     = false;
+    m_saturated = false;
+    m_unstored  = 0;
+
+    return fds_register(fds_evt_handler);
+}
+
+
+void usage_schedule_unlock_record(void) {
+    if (!local_time_is_set()) {
+        ++m_stats.untimed;
+        return;
+    }
+
+    const unsigned int hour = local_time_minute_of_week() / 60;
+    if (m_histogram.counts[hour] < UINT8_MAX) {
+        ++m_histogram.counts[hour];
+    }
+    m_saturated |= (m_histogram.counts[hour] == UINT8_MAX);
+    m_stale      = true;
+    ++m_stats.unlocks;
+
+    // Written in batches, a reset loses fewer than USAGE_SCHEDULE_STORE_BATCH unlocks
+    if (++m_unstored >= USAGE_SCHEDULE_STORE_BATCH) {
+        histogram_store();
+    }
+}
+
+
+bool usage_schedule_is_habitual(void) {
+    if (!local_time_is_set()) {
+        return false;
+    }
+    if (m_stale) {
+        schedule_recompute();
+    }
+
+    const unsigned int hour = local_time_minute_of_week() / 60;
+    return (m_habitual[hour / 32] & (1UL << (hour % 32))) != 0;
+}
+
+
+const usage_schedule_stats_t* usage_schedule_stats_get(void) {
+    return &m_stats;
+}
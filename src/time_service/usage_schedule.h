@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sdk_errors.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define USAGE_SCHEDULE_HOURS    (7 * 24)    /**< Hours in a week, one histogram bin each. */
+
+
+/**@brief Usage schedule counters, since boot */
+typedef struct {
+    uint32_t unlocks;           /**< Unlocks recorded */
+    uint32_t untimed;           /**< Unlocks not recorded, the local time was not set */
+    uint32_t recomputes;        /**< Schedule recomputations */
+    uint16_t habitual_hours;    /**< Hours of the week in the current schedule */
+    bool     loaded;            /**< The histogram was found in flash at boot */
+} usage_schedule_stats_t;
+
+
+/**@brief Function for initializing the usage schedule, before the peer manager initializes FDS.
+ *
+ * @details Unlocks are counted per hour of the week in a histogram of one byte per hour, kept in
+ *          flash. Hours with at least USAGE_SCHEDULE_MIN_UNLOCKS unlocks and
+ *          USAGE_SCHEDULE_PEAK_RATIO times the mean of all hours are habitual arrival windows.
+ *          When an hour reaches 255 unlocks the whole histogram is halved, so old habits fade.
+ *
+ * @return NRF_SUCCESS on success, otherwise an error code.
+ */
+ret_code_t usage_schedule_init(void);
+
+
+/**@brief Function for recording a successful unlock at the current local time.
+ *
+ * @details Constant time: the hour is counted and the schedule marked stale, it is recomputed
+ *          on the next query. The histogram is written to flash in the background, every
+ *          USAGE_SCHEDULE_STORE_BATCH unlocks.
+ */
+void usage_schedule_unlock_record(void);
+
+
+/**@brief Function for checking if the current local time is in a habitual arrival window.
+ *
+ * @return True if it is, false if not or if the local time is not set.
+ */
+bool usage_schedule_is_habitual(void);
+
+
+/**@brief Function for getting the usage schedule counters. */
+const usage_schedule_stats_t* usage_schedule_stats_get(void);
+
+
+#ifdef __cplusplus
+}
+#endif